@@ -0,0 +1,263 @@
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include "dv8_binlog.h"
+#include "dv8_state.h"
+#include "dv8_topics.h"
+
+#define RING_MASK           (DV8_BINLOG_RING_WORDS - 1)
+#define RING_LAP(pos)       (((pos) / DV8_BINLOG_RING_WORDS) & 0xFF)
+#define HEADER(pos, id, n)  ((uint32_t)RING_LAP(pos) << 24 | (uint32_t)(id) << 16 | DV8_BINLOG_MAGIC << 8 | (n))
+#define HEADER_ID(h)        (((h) >> 16) & 0xFF)
+#define HEADER_WORDS(h)     ((h) & 0xFF)
+
+_Static_assert((DV8_BINLOG_RING_WORDS & RING_MASK) == 0, "DV8_BINLOG_RING_WORDS must be a power of two");
+_Static_assert(DV8_BINLOG_MESSAGE_COUNT <= 0x100, "message ids are 8 bits");
+
+#define DV8_BINLOG_MESSAGE(id, level, tag, format) [DV8_BINLOG_##id] = { level, tag, format },
+const dv8_binlog_message_t dv8_binlog_messages[DV8_BINLOG_MESSAGE_COUNT] = {
+    DV8_BINLOG_MESSAGES(DV8_BINLOG_MESSAGE)
+};
+#undef DV8_BINLOG_MESSAGE
+
+// Positions count words forever; producers reserve [head, head + n) with a CAS, the consumer
+// owns tail. Space before tail is free, but keeps the old records until it is reused.
+static _Atomic(uint32_t) ring[DV8_BINLOG_RING_WORDS];
+static _Atomic(uint32_t) head;
+static _Atomic(uint32_t) tail;
+
+static uint32_t (*clock_now_ms)(void) = NULL;
+
+static _Atomic(uint32_t) stat_written;
+static _Atomic(uint32_t) stat_dropped;
+static uint32_t stat_emitted;           // consumer only
+static uint32_t dropped_reported;       // consumer only
+
+
+void dv8_binlog_set_clock(uint32_t (*now_ms)(void))
+{
+    clock_now_ms = now_ms;
+}
+
+bool dv8_binlog_write(dv8_binlog_id_t id, const uint32_t *args, size_t nargs)
+{
+    if (nargs > DV8_BINLOG_MAX_ARGS) {
+        nargs = DV8_BINLOG_MAX_ARGS;
+    }
+    uint32_t n = 2 + (uint32_t)nargs;
+    uint32_t pos = atomic_load_explicit(&head, memory_order_relaxed);
+
+    do {
+        if (pos + n - atomic_load_explicit(&tail, memory_order_acquire) > DV8_BINLOG_RING_WORDS) {
+            atomic_fetch_add_explicit(&stat_dropped, 1, memory_order_relaxed);
+            return false;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&head, &pos, pos + n, memory_order_relaxed, memory_order_relaxed));
+
+    atomic_store_explicit(&ring[(pos + 1) & RING_MASK], clock_now_ms != NULL ? clock_now_ms() : 0, memory_order_relaxed);
+    for (uint32_t i = 0; i < nargs; i++) {
+        atomic_store_explicit(&ring[(pos + 2 + i) & RING_MASK], args[i], memory_order_relaxed);
+    }
+    // The header last: once the consumer sees it with this lap, the whole record is there
+    atomic_store_explicit(&ring[pos & RING_MASK], HEADER(pos, id, n), memory_order_release);
+    atomic_fetch_add_explicit(&stat_written, 1, memory_order_relaxed);
+    return true;
+}
+
+static void read_record(uint32_t pos, uint32_t header, dv8_binlog_record_t *record)
+{
+    record->id = HEADER_ID(header);
+    record->nargs = HEADER_WORDS(header) - 2;
+    record->time_ms = atomic_load_explicit(&ring[(pos + 1) & RING_MASK], memory_order_relaxed);
+    for (uint32_t i = 0; i < record->nargs; i++) {
+        record->args[i] = atomic_load_explicit(&ring[(pos + 2 + i) & RING_MASK], memory_order_relaxed);
+    }
+}
+
+uint32_t dv8_binlog_drain(void (*emit)(const dv8_binlog_record_t *record))
+{
+    uint32_t pos = atomic_load_explicit(&tail, memory_order_relaxed);
+    uint32_t end = atomic_load_explicit(&head, memory_order_relaxed);
+    uint32_t count = 0;
+
+    while (pos != end) {
+        uint32_t header = atomic_load_explicit(&ring[pos & RING_MASK], memory_order_acquire);
+        if (header != HEADER(pos, HEADER_ID(header), HEADER_WORDS(header))) {
+            break;          // reserved, but its producer hasn't finished writing it
+        }
+        dv8_binlog_record_t record;
+        read_record(pos, header, &record);
+        pos += HEADER_WORDS(header);
+        atomic_store_explicit(&tail, pos, memory_order_release);
+        emit(&record);
+        count++;
+    }
+    stat_emitted += count;
+
+    // Reported through the ring itself, so it shows up where the gap is
+    uint32_t dropped = atomic_load_explicit(&stat_dropped, memory_order_relaxed);
+    if (dropped != dropped_reported && DV8_BINLOG(LOG_DROPPED, dropped - dropped_reported)) {
+        dropped_reported = dropped;
+    }
+    return count;
+}
+
+void dv8_binlog_get_stats(dv8_binlog_stats_t *out)
+{
+    out->written = atomic_load_explicit(&stat_written, memory_order_relaxed);
+    out->dropped = atomic_load_explicit(&stat_dropped, memory_order_relaxed);
+    out->emitted = stat_emitted;
+}
+
+int dv8_binlog_format(char *out, size_t out_size, const dv8_binlog_record_t *record)
+{
+    const char *fmt = dv8_binlog_messages[record->id].format;
+    size_t len = 0;
+    unsigned arg = 0;
+
+// snprintf into what is left of `out`, counting the full length like snprintf does
+#define APPEND(...) do { \
+        int n_ = snprintf(out + (len < out_size ? len : out_size), len < out_size ? out_size - len : 0, __VA_ARGS__); \
+        len += n_ > 0 ? (size_t)n_ : 0; \
+    } while (0)
+
+    while (*fmt != '\0') {
+        const char *pct = strchr(fmt, '%');
+        if (pct == NULL) {
+            APPEND("%s", fmt);
+            break;
+        }
+        APPEND("%.*s", (int)(pct - fmt), fmt);
+        if (pct[1] == '%') {
+            APPEND("%%");
+            fmt = pct + 2;
+            continue;
+        }
+
+        // Flags, width and precision are passed on as they are
+        char spec[16];
+        size_t spec_len = strspn(pct + 1, "-+ #0123456789.") + 1;
+        char conv = pct[spec_len];
+        if (conv == '\0' || spec_len >= sizeof(spec)) {
+            break;
+        }
+        memcpy(spec, pct, spec_len + 1);
+        spec[spec_len + 1] = '\0';
+        fmt = pct + spec_len + 1;
+
+        if (arg >= record->nargs) {
+            APPEND("?");
+            continue;
+        }
+        uint32_t word = record->args[arg++];
+        switch (conv) {
+        case 'd':
+        case 'i':
+            APPEND(spec, (int)(int32_t)word);
+            break;
+        case 'u':
+        case 'x':
+        case 'X':
+            APPEND(spec, (unsigned)word);
+            break;
+        case 'f': {
+            union { uint32_t u; float f; } value = { .u = word };
+            APPEND(spec, (double)value.f);
+            break;
+        }
+        case 'T':
+            if (word < dv8_topic_count) {
+                APPEND("%s", dv8_topics[word].topic);
+            } else {
+                APPEND("topic %u", (unsigned)word);
+            }
+            break;
+        case 'F':
+            if (word < DV8_FIELD_COUNT) {
+                APPEND("%s", dv8_field_info[word].name);
+            } else {
+                APPEND("field %u", (unsigned)word);
+            }
+            break;
+        default:
+            APPEND("?");
+            break;
+        }
+    }
+#undef APPEND
+    return (int)len;
+}
+
+static void put_le32(uint8_t *out, uint32_t value)
+{
+    out[0] = value;
+    out[1] = value >> 8;
+    out[2] = value >> 16;
+    out[3] = value >> 24;
+}
+
+static uint32_t get_le32(const uint8_t *in)
+{
+    return in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16 | (uint32_t)in[3] << 24;
+}
+
+void dv8_binlog_dump(uint8_t out[DV8_BINLOG_DUMP_SIZE])
+{
+    memcpy(out, DV8_BINLOG_DUMP_MAGIC, 4);
+    put_le32(out + 4, atomic_load_explicit(&head, memory_order_acquire));
+    for (uint32_t i = 0; i < DV8_BINLOG_RING_WORDS; i++) {
+        put_le32(out + 8 + i * 4, atomic_load_explicit(&ring[i], memory_order_relaxed));
+    }
+}
+
+bool dv8_binlog_reader_init(dv8_binlog_reader_t *reader, const uint8_t *dump, size_t len)
+{
+    if (len != DV8_BINLOG_DUMP_SIZE || memcmp(dump, DV8_BINLOG_DUMP_MAGIC, 4) != 0) {
+        return false;
+    }
+    reader->dump = dump;
+    reader->head = get_le32(dump + 4);
+    reader->pos = reader->head > DV8_BINLOG_RING_WORDS ? reader->head - DV8_BINLOG_RING_WORDS : 0;
+    return true;
+}
+
+// Conversions in a message format, i.e. the args its records carry
+static unsigned format_args(const char *fmt)
+{
+    unsigned count = 0;
+    for (const char *pct = strchr(fmt, '%'); pct != NULL; pct = strchr(pct, '%')) {
+        if (pct[1] == '%') {
+            pct += 2;
+            continue;
+        }
+        count++;
+        pct++;
+    }
+    return count;
+}
+
+bool dv8_binlog_dump_next(dv8_binlog_reader_t *reader, dv8_binlog_record_t *record)
+{
+    // Only records of the last lap over the ring are whole; anything else is skipped word by
+    // word until a header of the right lap, id and length shows up
+    while (reader->pos < reader->head) {
+        uint32_t pos = reader->pos;
+        uint32_t header = get_le32(reader->dump + 8 + (pos & RING_MASK) * 4);
+        uint32_t id = HEADER_ID(header);
+        uint32_t n = HEADER_WORDS(header);
+
+        if (id < DV8_BINLOG_MESSAGE_COUNT && header == HEADER(pos, id, n) && pos + n <= reader->head &&
+            n == 2 + format_args(dv8_binlog_messages[id].format)) {
+            record->id = id;
+            record->nargs = n - 2;
+            record->time_ms = get_le32(reader->dump + 8 + ((pos + 1) & RING_MASK) * 4);
+            for (uint32_t i = 0; i < record->nargs; i++) {
+                record->args[i] = get_le32(reader->dump + 8 + ((pos + 2 + i) & RING_MASK) * 4);
+            }
+            reader->pos = pos + n;
+            return true;
+        }
+        reader->pos++;
+    }
+    return false;
+}
@@ -0,0 +1,117 @@
+#ifndef DV8_BINLOG_H
+#define DV8_BINLOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Deferred binary log. A producer only stores (time, message id, raw 32-bit args) into a
+ * lock-free ring; a low-priority task formats the records later with dv8_binlog_drain().
+ * Formatting, printf and the console UART are all off the MQTT and LVGL paths.
+ *
+ * Message formats live in DV8_BINLOG_MESSAGES below, so the firmware and the host decoder
+ * (simulator/dv8_binlog_dump) share them. Conversions take one 32-bit word each:
+ *   %d %i %u %x %X   integers, with the usual flags, width and precision
+ *   %f               a float passed through DV8_BINLOG_F()
+ *   %T               a dv8_topics index, printed as the topic
+ *   %F               a dv8_field_t, printed as the field name
+ *
+ * Ring words are records of 2 + nargs words: a header (lap, id, DV8_BINLOG_MAGIC, word count),
+ * the time in ms, then the args. The header is written last, and carries the lap of its
+ * position in the ring, which is how the consumer tells a finished record from an old one. The
+ * consumer never clears what it read, so the ring always holds the latest records and a dump
+ * of it (dv8_binlog_dump) can be decoded after the fact.
+ */
+
+#define DV8_BINLOG_RING_WORDS   1024        // power of two, 4 KiB
+#define DV8_BINLOG_MAX_ARGS     8
+#define DV8_BINLOG_MAGIC        0xB1
+#define DV8_BINLOG_DUMP_MAGIC   "DV8L"
+
+// X(id, level, tag, format): level is the ESP_LOGx letter
+#define DV8_BINLOG_MESSAGES(X) \
+    X(RECEIVED,     'D', "mqtt_example", "received %T, %u bytes") \
+    X(BAD_PAYLOAD,  'W', "mqtt_example", "%T: %u bytes didn't parse") \
+    X(STATE,        'I', "dv8_state",    "%F = %.2f (%u changes not logged)") \
+    X(FLEET,        'I', "example",      "Fleet: %u robots, %u messages, %u changed, %u rejected, %u rows redrawn") \
+    X(UI_UPDATES,   'I', "example",      "UI updates applied: %u, skipped: %u") \
+    X(CACHE_WRITES, 'I', "example",      "State cache writes: %u") \
+    X(UI_COMMANDS,  'I', "example",      "UI commands posted: %u, coalesced: %u, dropped: %u, queue depth %u (max %u)") \
+    X(FRAMES,       'I', "example",      "Frames rendered: %u, skipped: %u, dropped: %u, period %u ms, slowest %u us, %u rendered natively") \
+    X(SPI,          'I', "example",      "SPI: %u kB in %u ms busy, %u kB/s of %u kB/s (%u%%), %u windows, %u stripes merged") \
+    X(TOUCH,        'I', "example",      "Touch: %u interrupts, %u samples (%u reset unread), %u events, %u SPI transactions in %u ms, %u yielded to the LCD, slowest %u us to LVGL") \
+    X(SPRITES,      'I', "example",      "Sprites: %u draws copied, %u rendered (%u%% copied), %u captured, %u evicted, %u looks in %u of %u bytes") \
+    X(WAKEUPS,      'I', "example",      "LVGL wakeups: %u (%u.%02u/s)") \
+    X(LOG_DROPPED,  'W', "dv8_binlog",   "%u log records dropped, ring full")
+
+#define DV8_BINLOG_ID(id, level, tag, format) DV8_BINLOG_##id,
+typedef enum {
+    DV8_BINLOG_MESSAGES(DV8_BINLOG_ID)
+    DV8_BINLOG_MESSAGE_COUNT
+} dv8_binlog_id_t;
+#undef DV8_BINLOG_ID
+
+typedef struct {
+    char level;
+    const char *tag;
+    const char *format;
+} dv8_binlog_message_t;
+
+extern const dv8_binlog_message_t dv8_binlog_messages[DV8_BINLOG_MESSAGE_COUNT];
+
+typedef struct {
+    uint32_t time_ms;
+    dv8_binlog_id_t id;
+    uint8_t nargs;
+    uint32_t args[DV8_BINLOG_MAX_ARGS];
+} dv8_binlog_record_t;
+
+typedef struct {
+    uint32_t written;
+    uint32_t dropped;       // ring full
+    uint32_t emitted;
+} dv8_binlog_stats_t;
+
+// Float argument as the 32-bit word %f reads
+static inline uint32_t DV8_BINLOG_F(float value)
+{
+    union { float f; uint32_t u; } word = { .f = value };
+    return word.u;
+}
+
+// Log `id` with its args, e.g. DV8_BINLOG(UI_UPDATES, applied, skipped). Any task, never blocks.
+#define DV8_BINLOG(id, ...) \
+    dv8_binlog_write(DV8_BINLOG_##id, (const uint32_t[]) { __VA_ARGS__ }, \
+                     sizeof((const uint32_t[]) { __VA_ARGS__ }) / sizeof(uint32_t))
+
+// Millisecond clock for the record times, esp_timer_get_time() / 1000 on the panel
+extern void dv8_binlog_set_clock(uint32_t (*now_ms)(void));
+// Returns false if the record was dropped because the ring is full
+extern bool dv8_binlog_write(dv8_binlog_id_t id, const uint32_t *args, size_t nargs);
+// Consumer, one task: hand every finished record to `emit`, oldest first. Returns the count.
+extern uint32_t dv8_binlog_drain(void (*emit)(const dv8_binlog_record_t *record));
+extern void dv8_binlog_get_stats(dv8_binlog_stats_t *out);
+
+// Format a record's message like snprintf, without the level, time and tag
+extern int dv8_binlog_format(char *out, size_t out_size, const dv8_binlog_record_t *record);
+
+/*
+ * Ring dump: DV8_BINLOG_DUMP_MAGIC, the write position as little-endian uint32, then the
+ * DV8_BINLOG_RING_WORDS words, little-endian. dv8_binlog_dump() writes the live ring into
+ * `out` (DV8_BINLOG_DUMP_SIZE bytes); dv8_binlog_dump_next() walks the records of a dump, oldest
+ * first, skipping anything that isn't a whole record of the ring's last lap.
+ */
+#define DV8_BINLOG_DUMP_SIZE    (8 + DV8_BINLOG_RING_WORDS * 4)
+
+typedef struct {
+    const uint8_t *dump;
+    uint32_t head;
+    uint32_t pos;
+} dv8_binlog_reader_t;
+
+extern void dv8_binlog_dump(uint8_t out[DV8_BINLOG_DUMP_SIZE]);
+extern bool dv8_binlog_reader_init(dv8_binlog_reader_t *reader, const uint8_t *dump, size_t len);
+extern bool dv8_binlog_dump_next(dv8_binlog_reader_t *reader, dv8_binlog_record_t *record);
+
+#endif
@@ -0,0 +1,45 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "dv8_boot.h"
+
+static const char *TAG = "dv8_boot";
+
+static const char *const phase_names[DV8_BOOT_PHASE_COUNT] = {
+    [DV8_BOOT_PANEL] = "panel",
+    [DV8_BOOT_LVGL] = "lvgl",
+    [DV8_BOOT_UI] = "ui",
+    [DV8_BOOT_FIRST_FLUSH] = "first flush",
+    [DV8_BOOT_WIFI] = "wifi",
+    [DV8_BOOT_MQTT] = "mqtt",
+    [DV8_BOOT_FIRST_MESSAGE] = "first message",
+};
+
+// 0 until marked, each entry is only written by the task that marks its phase
+static int64_t phase_us[DV8_BOOT_PHASE_COUNT];
+
+
+void dv8_boot_mark(dv8_boot_phase_t phase)
+{
+    if (phase_us[phase] != 0) {
+        return;
+    }
+    phase_us[phase] = esp_timer_get_time();
+    ESP_LOGI(TAG, "%s at %" PRId64 " ms", phase_names[phase], phase_us[phase] / 1000);
+
+    if (phase != DV8_BOOT_FIRST_MESSAGE) {
+        return;
+    }
+    // "panel 212, lvgl 230, ..." in ms, phases that never happened as "-"
+    char line[160];
+    size_t len = 0;
+    for (int i = 0; i < DV8_BOOT_PHASE_COUNT && len < sizeof(line); i++) {
+        if (phase_us[i] != 0) {
+            len += snprintf(line + len, sizeof(line) - len, "%s%s %" PRId64, i ? ", " : "", phase_names[i], phase_us[i] / 1000);
+        } else {
+            len += snprintf(line + len, sizeof(line) - len, "%s%s -", i ? ", " : "", phase_names[i]);
+        }
+    }
+    ESP_LOGI(TAG, "boot phases (ms): %s", line);
+}
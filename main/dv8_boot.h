@@ -0,0 +1,25 @@
+#ifndef DV8_BOOT_H
+#define DV8_BOOT_H
+
+/*
+ * Boot-phase timestamps, esp_timer_get_time() since startup. Each phase is logged the first
+ * time it is marked, and once the first robot message arrives all of them are logged on one
+ * line, so startup regressions show up in every boot log.
+ *
+ * Every phase is marked from a single task, the first mark wins and later ones are no-ops.
+ */
+
+typedef enum {
+    DV8_BOOT_PANEL,             // SPI bus and LCD controller initialised
+    DV8_BOOT_LVGL,              // lv_init() and the display driver
+    DV8_BOOT_UI,                // widgets created, with the cached state if there was one
+    DV8_BOOT_FIRST_FLUSH,       // first area sent to the panel
+    DV8_BOOT_WIFI,              // example_connect() returned
+    DV8_BOOT_MQTT,              // connected to the broker
+    DV8_BOOT_FIRST_MESSAGE,     // first message from the robot
+    DV8_BOOT_PHASE_COUNT
+} dv8_boot_phase_t;
+
+extern void dv8_boot_mark(dv8_boot_phase_t phase);
+
+#endif
@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sdkconfig.h"
+#include "esp_console.h"
+#include "esp_err.h"
+#include "dv8_console.h"
+#include "dv8_latency.h"
+#include "lvgl_cmd.h"
+#include "dv8_binlog.h"
+
+#if CONFIG_DV8_CONSOLE
+
+/*
+ * latency        per-field message-to-photon latency, fields without samples are left out
+ * latency reset  start counting again (from the next frame)
+ */
+static int cmd_latency(int argc, char **argv)
+{
+    if (argc > 1) {
+        if (strcmp(argv[1], "reset") != 0) {
+            printf("usage: latency [reset]\n");
+            return 1;
+        }
+        dv8_latency_reset();
+        return 0;
+    }
+
+    bool any = false;
+    printf("%-20s %8s %8s %8s %8s %8s\n", "field (us)", "n", "min", "p50", "p99", "max");
+    for (int field = 0; field < DV8_FIELD_COUNT; field++) {
+        dv8_latency_summary_t s;
+        dv8_latency_get(field, &s);
+        if (s.count == 0) {
+            continue;
+        }
+        printf("%-20s %8lu %8lu %8lu %8lu %8lu\n", dv8_field_info[field].name, (unsigned long)s.count,
+               (unsigned long)s.min_us, (unsigned long)s.p50_us, (unsigned long)s.p99_us, (unsigned long)s.max_us);
+        any = true;
+    }
+    if (!any) {
+        printf("no state change has reached the panel yet\n");
+    }
+    return 0;
+}
+
+/*
+ * ui page status|trend     switch the page
+ * ui set <field> <value>   show a value on a field's button until the robot changes it,
+ *                          the battery in tenths of a percent
+ * Posted to the LVGL task through lvgl_cmd, so the console never waits for rendering.
+ */
+static int cmd_ui(int argc, char **argv)
+{
+    if (argc == 3 && strcmp(argv[1], "page") == 0) {
+        if (strcmp(argv[2], "status") != 0 && strcmp(argv[2], "trend") != 0) {
+            printf("unknown page \"%s\"\n", argv[2]);
+            return 1;
+        }
+        lvgl_cmd_post(LVGL_CMD_PAGE, 0, strcmp(argv[2], "trend") == 0);
+        return 0;
+    }
+    if (argc == 4 && strcmp(argv[1], "set") == 0) {
+        for (int field = 0; field < DV8_FIELD_COUNT; field++) {
+            if (strcmp(argv[2], dv8_field_info[field].name) == 0) {
+                if (!lvgl_cmd_post(LVGL_CMD_FIELD, field, strtol(argv[3], NULL, 10))) {
+                    printf("UI command queue full\n");
+                    return 1;
+                }
+                return 0;
+            }
+        }
+        printf("unknown field \"%s\"\n", argv[2]);
+        return 1;
+    }
+
+    lvgl_cmd_stats_t s;
+    lvgl_cmd_get_stats(&s);
+    printf("usage: ui page status|trend, ui set <field> <value>\n");
+    printf("commands posted %lu, coalesced %lu, dropped %lu, queue depth %lu (max %lu)\n", (unsigned long)s.posted,
+           (unsigned long)s.coalesced, (unsigned long)s.dropped, (unsigned long)s.depth, (unsigned long)s.max_depth);
+    return argc == 1 ? 0 : 1;
+}
+
+static int cmd_binlog(int argc, char **argv)
+{
+    if (argc == 2 && strcmp(argv[1], "dump") == 0) {
+        // Hex, 32 bytes a line, for simulator/dv8_binlog_dump. Static, the console stack is small.
+        static uint8_t dump[DV8_BINLOG_DUMP_SIZE];
+        dv8_binlog_dump(dump);
+        for (size_t i = 0; i < sizeof(dump); i++) {
+            printf("%02x%s", dump[i], (i % 32 == 31 || i == sizeof(dump) - 1) ? "\n" : "");
+        }
+        return 0;
+    }
+    dv8_binlog_stats_t s;
+    dv8_binlog_get_stats(&s);
+    printf("usage: binlog [dump]\n");
+    printf("records written %lu, dropped %lu, emitted %lu\n", (unsigned long)s.written, (unsigned long)s.dropped,
+           (unsigned long)s.emitted);
+    return argc == 1 ? 0 : 1;
+}
+
+void dv8_console_start(void)
+{
+    esp_console_repl_t *repl = NULL;
+    esp_console_repl_config_t repl_config = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
+    repl_config.prompt = "dv8>";
+
+#if CONFIG_ESP_CONSOLE_UART_DEFAULT || CONFIG_ESP_CONSOLE_UART_CUSTOM
+    esp_console_dev_uart_config_t hw_config = ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_console_new_repl_uart(&hw_config, &repl_config, &repl));
+#elif CONFIG_ESP_CONSOLE_USB_SERIAL_JTAG
+    esp_console_dev_usb_serial_jtag_config_t hw_config = ESP_CONSOLE_DEV_USB_SERIAL_JTAG_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_console_new_repl_usb_serial_jtag(&hw_config, &repl_config, &repl));
+#elif CONFIG_ESP_CONSOLE_USB_CDC
+    esp_console_dev_usb_cdc_config_t hw_config = ESP_CONSOLE_DEV_CDC_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_console_new_repl_usb_cdc(&hw_config, &repl_config, &repl));
+#endif
+
+    const esp_console_cmd_t latency_cmd = {
+        .command = "latency",
+        .help = "Message-to-photon latency per robot state field: min/p50/p99/max in us",
+        .hint = "[reset]",
+        .func = &cmd_latency,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&latency_cmd));
+    const esp_console_cmd_t ui_cmd = {
+        .command = "ui",
+        .help = "Drive the panel without a robot: switch pages, show values. Without arguments, queue stats",
+        .hint = "[page status|trend] [set <field> <value>]",
+        .func = &cmd_ui,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&ui_cmd));
+    const esp_console_cmd_t binlog_cmd = {
+        .command = "binlog",
+        .help = "Log ring stats, or the whole ring as hex for simulator/dv8_binlog_dump",
+        .hint = "[dump]",
+        .func = &cmd_binlog,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&binlog_cmd));
+    ESP_ERROR_CHECK(esp_console_register_help_command());
+
+    ESP_ERROR_CHECK(esp_console_start_repl(repl));
+}
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef DV8_CONSOLE_H
+#define DV8_CONSOLE_H
+
+// Diagnostic REPL on the console port (CONFIG_DV8_CONSOLE), see dv8_console.c for the commands
+extern void dv8_console_start(void);
+
+#endif
@@ -0,0 +1,179 @@
+#include "sdkconfig.h"
+#if CONFIG_DV8_FLEET_MODE
+
+#include <string.h>
+#include <stdatomic.h>
+#include "dv8_fleet.h"
+#include "dv8_seqlock.h"
+#include "dv8_topics.h"
+
+// Twice the capacity keeps linear probing runs short even with every robot present
+#define FLEET_SLOTS         (2 * DV8_FLEET_CAPACITY)
+#define FLEET_SLOT_EMPTY    0       // slots hold index + 1, so the table needs no init
+#define FLEET_CHANGED_WORDS ((DV8_FLEET_CAPACITY + 31) / 32)
+// Room for the prefix plus the longest topic below it
+#define FLEET_KEY_MAX       96
+
+_Static_assert(DV8_FLEET_CAPACITY > 0 && DV8_FLEET_CAPACITY <= UINT16_MAX - 1, "fleet index must fit the slot table");
+
+typedef struct {
+    char id[DV8_FLEET_ID_MAX + 1];
+    uint32_t hash;
+    dv8_seqlock_t seq;          // guards state
+    dv8_robot_state_t state;
+} fleet_robot_t;
+
+static fleet_robot_t robots[DV8_FLEET_CAPACITY];
+static uint16_t slots[FLEET_SLOTS];
+// Written after the robot it counts is complete, so readers never see a half-made entry
+static _Atomic(uint32_t) robot_count;
+static _Atomic(uint32_t) changed_bits[FLEET_CHANGED_WORDS];
+
+static _Atomic(uint32_t) stat_messages;
+static _Atomic(uint32_t) stat_changed;
+static _Atomic(uint32_t) stat_rejected;
+
+
+// FNV-1a, ids are short
+static uint32_t hash_id(const char *id, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t)id[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Index of robot `id`, adding it if there is room. -1 if the fleet is full.
+static int find_or_add(const char *id, size_t len)
+{
+    uint32_t hash = hash_id(id, len);
+    unsigned slot = hash % FLEET_SLOTS;
+
+    while (slots[slot] != FLEET_SLOT_EMPTY) {
+        fleet_robot_t *robot = &robots[slots[slot] - 1];
+        if (robot->hash == hash && strncmp(robot->id, id, len) == 0 && robot->id[len] == '\0') {
+            return slots[slot] - 1;
+        }
+        slot = (slot + 1) % FLEET_SLOTS;
+    }
+
+    uint32_t index = atomic_load_explicit(&robot_count, memory_order_relaxed);
+    if (index == DV8_FLEET_CAPACITY) {
+        return -1;
+    }
+    fleet_robot_t *robot = &robots[index];
+    memcpy(robot->id, id, len);
+    robot->id[len] = '\0';
+    robot->hash = hash;
+    slots[slot] = index + 1;
+    atomic_store_explicit(&robot_count, index + 1, memory_order_release);
+    return index;
+}
+
+dv8_message_result_t dv8_fleet_handle(const char *topic, size_t topic_len, const char *data, size_t data_len,
+                                      int64_t received_us, const dv8_topic_t **desc_out)
+{
+    static const char prefix[] = DV8_TOPIC_PREFIX "/";
+    const size_t prefix_len = sizeof(prefix) - 1;
+
+    atomic_fetch_add_explicit(&stat_messages, 1, memory_order_relaxed);
+    if (desc_out != NULL) {
+        *desc_out = NULL;
+    }
+
+    // <prefix>/<id>/<rest> is looked up as <prefix>/<rest> in the single robot topic table
+    if (topic_len <= prefix_len || memcmp(topic, prefix, prefix_len) != 0) {
+        return DV8_MESSAGE_UNKNOWN_TOPIC;
+    }
+    const char *id = topic + prefix_len;
+    const char *rest = memchr(id, '/', topic_len - prefix_len);
+    size_t id_len = rest != NULL ? (size_t)(rest - id) : 0;
+    size_t rest_len = rest != NULL ? (size_t)(topic + topic_len - rest) : 0;
+    if (id_len == 0 || id_len > DV8_FLEET_ID_MAX || prefix_len + rest_len > FLEET_KEY_MAX) {
+        return DV8_MESSAGE_UNKNOWN_TOPIC;
+    }
+
+    char key[FLEET_KEY_MAX];
+    memcpy(key, prefix, prefix_len - 1);
+    memcpy(key + prefix_len - 1, rest, rest_len);
+    const dv8_topic_t *desc = dv8_topic_lookup(key, prefix_len - 1 + rest_len);
+    if (desc_out != NULL) {
+        *desc_out = desc;
+    }
+    if (desc == NULL) {
+        return DV8_MESSAGE_UNKNOWN_TOPIC;
+    }
+
+    int index = find_or_add(id, id_len);
+    if (index < 0) {
+        atomic_fetch_add_explicit(&stat_rejected, 1, memory_order_relaxed);
+        return DV8_MESSAGE_FLEET_FULL;
+    }
+    fleet_robot_t *robot = &robots[index];
+
+    // Only the writer modifies robot->state, so it can decode into a copy without the seqlock
+    dv8_robot_state_t state = robot->state;
+    if (!dv8_message_decode(desc, data, data_len, &state)) {
+        return DV8_MESSAGE_BAD_PAYLOAD;
+    }
+    uint32_t changed = dv8_state_diff(&robot->state, &state);
+    if (changed == 0) {
+        return DV8_MESSAGE_UNCHANGED;
+    }
+    for (int field = 0; field < DV8_FIELD_COUNT; field++) {
+        if (changed & DV8_FIELD_BIT(field)) {
+            state.changed_us[field] = received_us;
+        }
+    }
+
+    uint32_t version = dv8_seqlock_write_begin(&robot->seq);
+    robot->state = state;
+    robot->state.version = version;
+    dv8_seqlock_write_end(&robot->seq);
+    atomic_fetch_or_explicit(&changed_bits[index / 32], 1UL << (index % 32), memory_order_release);
+    atomic_fetch_add_explicit(&stat_changed, 1, memory_order_relaxed);
+    return DV8_MESSAGE_CHANGED;
+}
+
+size_t dv8_fleet_count(void)
+{
+    return atomic_load_explicit(&robot_count, memory_order_acquire);
+}
+
+const char *dv8_fleet_id(size_t index)
+{
+    return robots[index].id;
+}
+
+uint32_t dv8_fleet_read(size_t index, dv8_robot_state_t *out)
+{
+    fleet_robot_t *robot = &robots[index];
+    uint32_t seq;
+
+    do {
+        seq = dv8_seqlock_read_begin(&robot->seq);
+        *out = robot->state;
+    } while (dv8_seqlock_read_retry(&robot->seq, seq));
+    return out->version;
+}
+
+bool dv8_fleet_take_changed(size_t index)
+{
+    uint32_t bit = 1UL << (index % 32);
+    if ((atomic_load_explicit(&changed_bits[index / 32], memory_order_relaxed) & bit) == 0) {
+        return false;
+    }
+    atomic_fetch_and_explicit(&changed_bits[index / 32], ~bit, memory_order_acquire);
+    return true;
+}
+
+void dv8_fleet_get_stats(dv8_fleet_stats_t *out)
+{
+    out->robots = dv8_fleet_count();
+    out->messages = atomic_load_explicit(&stat_messages, memory_order_relaxed);
+    out->changed = atomic_load_explicit(&stat_changed, memory_order_relaxed);
+    out->rejected = atomic_load_explicit(&stat_rejected, memory_order_relaxed);
+}
+
+#endif /* CONFIG_DV8_FLEET_MODE */
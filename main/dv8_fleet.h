@@ -0,0 +1,52 @@
+#ifndef DV8_FLEET_H
+#define DV8_FLEET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "dv8_message.h"
+#include "dv8_state.h"
+
+/*
+ * Fleet mode: many robots under one prefix, DV8_TOPIC_PREFIX "/<id>/state/e_stop" and so on,
+ * the same topics as a single robot with its id as an extra segment.
+ *
+ * Robots are kept in a fixed table in the order they were first heard from; an index never
+ * changes once assigned. Ids are found through an open-addressed hash table with linear probing
+ * sized at twice the capacity, so lookups stay short even with the table full. Robots are never
+ * removed.
+ *
+ * As with dv8_state, there is one writer (the MQTT task, through dv8_fleet_handle) and readers
+ * that never block it: each robot has its own seqlock (dv8_seqlock.h), and a changed bit per robot tells the UI
+ * which ones to look at again.
+ */
+
+#define DV8_FLEET_CAPACITY  CONFIG_DV8_FLEET_CAPACITY
+#define DV8_FLEET_ID_MAX    15      // longer ids are rejected
+
+typedef struct {
+    uint32_t robots;
+    uint32_t messages;      // all messages handed to dv8_fleet_handle()
+    uint32_t changed;       // ... that published a new snapshot
+    uint32_t rejected;      // ... for a robot that didn't fit (DV8_MESSAGE_FLEET_FULL)
+} dv8_fleet_stats_t;
+
+// Decode one message of any robot into its snapshot, the fleet counterpart of dv8_message_handle().
+// Returns CHANGED if the robot's snapshot was republished, and sets `desc` (if not NULL) to the
+// dv8_topics entry of <prefix>/<rest>, NULL if there is none. Only one task may call it, after
+// dv8_topics_init().
+extern dv8_message_result_t dv8_fleet_handle(const char *topic, size_t topic_len, const char *data, size_t data_len,
+                                             int64_t received_us, const dv8_topic_t **desc);
+
+// Robots known so far, indexes 0 .. count-1 are valid from any task
+extern size_t dv8_fleet_count(void);
+// NUL-terminated id of robot `index`
+extern const char *dv8_fleet_id(size_t index);
+// Consistent copy of robot `index`'s snapshot, returns its version
+extern uint32_t dv8_fleet_read(size_t index, dv8_robot_state_t *out);
+// True once per batch of changes to robot `index` since the last call (one reader only)
+extern bool dv8_fleet_take_changed(size_t index);
+extern void dv8_fleet_get_stats(dv8_fleet_stats_t *out);
+
+#endif
@@ -0,0 +1,163 @@
+#include <math.h>
+#include <stdatomic.h>
+#include "dv8_history.h"
+
+#define HISTORY_TRACKED     3
+
+typedef struct {
+    uint32_t time_ms;
+    float value;
+} history_sample_t;
+
+// Single producer (MQTT task), single consumer (LVGL side)
+typedef struct {
+    history_sample_t samples[DV8_HISTORY_SAMPLES];
+    _Atomic(uint32_t) head;     // next to write, producer only
+    _Atomic(uint32_t) tail;     // next to read, consumer only
+} history_ring_t;
+
+// Consumer side only
+typedef struct {
+    dv8_history_column_t columns[DV8_HISTORY_COLUMNS];
+    uint32_t closed;            // columns closed so far, the newest is at (closed - 1) % COLUMNS
+    dv8_history_column_t open;  // the column being filled
+    float last;                 // NAN before the first value
+} history_series_t;
+
+static const dv8_field_t tracked_fields[HISTORY_TRACKED] = {
+    DV8_FIELD_BATTERY_PERCENTAGE,
+    DV8_FIELD_LINEAR_X,
+    DV8_FIELD_ANGULAR_Z,
+};
+_Static_assert(DV8_HISTORY_FIELDS == (DV8_FIELD_BIT(DV8_FIELD_BATTERY_PERCENTAGE) | DV8_FIELD_BIT(DV8_FIELD_LINEAR_X)
+                                      | DV8_FIELD_BIT(DV8_FIELD_ANGULAR_Z)), "tracked_fields must match DV8_HISTORY_FIELDS");
+
+static history_ring_t rings[HISTORY_TRACKED];
+static history_series_t series[HISTORY_TRACKED];
+static _Atomic(uint32_t) dropped;
+
+// End of the open column, 0 until the first dv8_history_advance()
+static uint32_t column_end_ms = 0;
+
+
+static int tracked_index(dv8_field_t field)
+{
+    for (int i = 0; i < HISTORY_TRACKED; i++) {
+        if (tracked_fields[i] == field) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Wrap-safe "a is before b"
+static inline bool before(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b) < 0;
+}
+
+void dv8_history_add(dv8_field_t field, float value, int64_t received_us)
+{
+    int index = tracked_index(field);
+    if (index < 0) {
+        return;
+    }
+    history_ring_t *ring = &rings[index];
+
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    if (head - atomic_load_explicit(&ring->tail, memory_order_acquire) == DV8_HISTORY_SAMPLES) {
+        atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+        return;
+    }
+    ring->samples[head % DV8_HISTORY_SAMPLES] = (history_sample_t) {
+        .time_ms = (uint32_t)(received_us / 1000),
+        .value = value,
+    };
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+static void open_column(history_series_t *s)
+{
+    s->open.min = s->last;
+    s->open.max = s->last;
+}
+
+static void add_to_column(history_series_t *s, float value)
+{
+    if (isnan(s->open.min) || value < s->open.min) {
+        s->open.min = value;
+    }
+    if (isnan(s->open.max) || value > s->open.max) {
+        s->open.max = value;
+    }
+    s->last = value;
+}
+
+// Move the samples received before `end_ms` into the open column
+static void drain(int index, uint32_t end_ms)
+{
+    history_ring_t *ring = &rings[index];
+    history_series_t *s = &series[index];
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    for (; tail != head; tail++) {
+        const history_sample_t *sample = &ring->samples[tail % DV8_HISTORY_SAMPLES];
+        if (!before(sample->time_ms, end_ms)) {
+            break;
+        }
+        add_to_column(s, sample->value);
+    }
+    atomic_store_explicit(&ring->tail, tail, memory_order_release);
+}
+
+uint32_t dv8_history_advance(int64_t now_us)
+{
+    uint32_t now_ms = (uint32_t)(now_us / 1000);
+
+    if (column_end_ms == 0) {
+        for (int i = 0; i < HISTORY_TRACKED; i++) {
+            series[i].last = NAN;
+            open_column(&series[i]);
+        }
+        column_end_ms = now_ms + CONFIG_DV8_HISTORY_COLUMN_MS;
+        return 0;
+    }
+
+    uint32_t closed = 0;
+    while (!before(now_ms, column_end_ms)) {
+        for (int i = 0; i < HISTORY_TRACKED; i++) {
+            history_series_t *s = &series[i];
+            drain(i, column_end_ms);
+            s->columns[s->closed % DV8_HISTORY_COLUMNS] = s->open;
+            s->closed++;
+            open_column(s);
+        }
+        column_end_ms += CONFIG_DV8_HISTORY_COLUMN_MS;
+        // After a long stall the older columns would only be repeats, a screenful is enough
+        if (++closed == DV8_HISTORY_COLUMNS) {
+            column_end_ms = now_ms + CONFIG_DV8_HISTORY_COLUMN_MS;
+            break;
+        }
+    }
+    return closed;
+}
+
+bool dv8_history_get(dv8_field_t field, uint32_t age, dv8_history_column_t *out)
+{
+    int index = tracked_index(field);
+    if (index < 0) {
+        return false;
+    }
+    const history_series_t *s = &series[index];
+    if (age >= s->closed || age >= DV8_HISTORY_COLUMNS) {
+        return false;
+    }
+    *out = s->columns[(s->closed - 1 - age) % DV8_HISTORY_COLUMNS];
+    return !isnan(out->min);
+}
+
+uint32_t dv8_history_dropped(void)
+{
+    return atomic_load_explicit(&dropped, memory_order_relaxed);
+}
@@ -0,0 +1,45 @@
+#ifndef DV8_HISTORY_H
+#define DV8_HISTORY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "dv8_state.h"
+
+/*
+ * Recent history of the numeric robot state fields, for the trend charts in lvgl_trend.c.
+ *
+ * The MQTT task adds every new value with its receive stamp to a per-field ring of raw samples
+ * (dv8_history_add, from dv8_message_handle). The LVGL side drains those rings once per column
+ * of CONFIG_DV8_HISTORY_COLUMN_MS and decimates them to the min and max of each column, so a
+ * spike between two columns still shows. A column nothing arrived in repeats the last value.
+ * The last DV8_HISTORY_COLUMNS columns are kept, one per pixel of the chart.
+ *
+ * Memory is fixed: DV8_HISTORY_SAMPLES * 8 B of samples plus DV8_HISTORY_COLUMNS * 8 B of
+ * columns per field, 1.5 KB each for the three fields below, and nothing on the heap.
+ */
+
+#define DV8_HISTORY_SAMPLES     64      // per field, between two columns
+#define DV8_HISTORY_COLUMNS     120
+
+// Fields with a history
+#define DV8_HISTORY_FIELDS \
+    (DV8_FIELD_BIT(DV8_FIELD_BATTERY_PERCENTAGE) | DV8_FIELD_BIT(DV8_FIELD_LINEAR_X) | DV8_FIELD_BIT(DV8_FIELD_ANGULAR_Z))
+
+typedef struct {
+    float min;
+    float max;
+} dv8_history_column_t;
+
+// MQTT task: `field` took `value` at `received_us`. Ignored for fields outside DV8_HISTORY_FIELDS.
+extern void dv8_history_add(dv8_field_t field, float value, int64_t received_us);
+// LVGL side: close every column that ended by `now_us`, returns how many. The first call only
+// starts the clock.
+extern uint32_t dv8_history_advance(int64_t now_us);
+// Column `age` of `field`, 0 = the newest closed one. False if it is older than anything kept
+// or before the field's first value.
+extern bool dv8_history_get(dv8_field_t field, uint32_t age, dv8_history_column_t *out);
+// Samples lost because the LVGL side didn't drain a ring in time
+extern uint32_t dv8_history_dropped(void);
+
+#endif
@@ -0,0 +1,151 @@
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "dv8_json.h"
+
+// Same limit as cJSON's parse_number(), longer numbers are left to cJSON
+#define DV8_JSON_MAX_NUMBER_LEN 63
+
+
+typedef struct {
+    const char *pos;
+    const char *end;
+} json_cursor_t;
+
+// cJSON treats every control character and space as whitespace
+static void skip_whitespace(json_cursor_t *cur)
+{
+    while (cur->pos < cur->end && (uint8_t)*cur->pos <= 32) {
+        cur->pos++;
+    }
+}
+
+static bool parse_key(json_cursor_t *cur, const char **key, size_t *key_len)
+{
+    if (cur->pos >= cur->end || *cur->pos != '"') {
+        return false;
+    }
+    const char *start = ++cur->pos;
+    while (cur->pos < cur->end && *cur->pos != '"') {
+        if (*cur->pos == '\\') {
+            return false;    // escaped keys are not worth handling here
+        }
+        if (*cur->pos == '\0') {
+            return false;    // cJSON's copy of the key would end here, leave that to it
+        }
+        cur->pos++;
+    }
+    if (cur->pos >= cur->end) {
+        return false;
+    }
+    *key = start;
+    *key_len = cur->pos - start;
+    cur->pos++;
+    return true;
+}
+
+static bool parse_number(json_cursor_t *cur, double *value)
+{
+    char number[DV8_JSON_MAX_NUMBER_LEN + 1];
+    size_t len = 0;
+
+    if (cur->pos >= cur->end || (*cur->pos != '-' && !isdigit((uint8_t)*cur->pos))) {
+        return false;
+    }
+    while (cur->pos + len < cur->end && strchr("0123456789+-.eE", cur->pos[len]) != NULL && cur->pos[len] != '\0') {
+        if (len == DV8_JSON_MAX_NUMBER_LEN) {
+            return false;
+        }
+        number[len] = cur->pos[len];
+        len++;
+    }
+    number[len] = '\0';
+
+    char *number_end;
+    *value = strtod(number, &number_end);
+    if (number_end != number + len) {
+        return false;
+    }
+    cur->pos += len;
+    return true;
+}
+
+// Field in `fields` whose name matches the key, or DV8_FIELD_COUNT if none
+static dv8_field_t match_field(const char *key, size_t key_len, uint32_t fields)
+{
+    for (int field = 0; field < DV8_FIELD_COUNT; field++) {
+        if ((fields & DV8_FIELD_BIT(field)) == 0) {
+            continue;
+        }
+        const char *name = dv8_field_info[field].name;
+        if (strlen(name) == key_len && strncasecmp(name, key, key_len) == 0) {
+            return field;
+        }
+    }
+    return DV8_FIELD_COUNT;
+}
+
+bool dv8_json_decode(const char *data, size_t data_len, uint32_t fields, dv8_robot_state_t *state)
+{
+    json_cursor_t cur = { data, data + data_len };
+    double values[DV8_FIELD_COUNT];
+    uint32_t found = 0;
+
+    skip_whitespace(&cur);
+    if (cur.pos >= cur.end || *cur.pos != '{') {
+        return false;
+    }
+    cur.pos++;
+    skip_whitespace(&cur);
+
+    if (cur.pos < cur.end && *cur.pos == '}') {
+        return true;
+    }
+
+    while (1) {
+        const char *key;
+        size_t key_len;
+        double value;
+
+        skip_whitespace(&cur);
+        if (!parse_key(&cur, &key, &key_len)) {
+            return false;
+        }
+        skip_whitespace(&cur);
+        if (cur.pos >= cur.end || *cur.pos != ':') {
+            return false;
+        }
+        cur.pos++;
+        skip_whitespace(&cur);
+        if (!parse_number(&cur, &value)) {
+            return false;
+        }
+
+        dv8_field_t field = match_field(key, key_len, fields);
+        if (field != DV8_FIELD_COUNT && (found & DV8_FIELD_BIT(field)) == 0) {
+            values[field] = value;
+            found |= DV8_FIELD_BIT(field);
+        }
+
+        skip_whitespace(&cur);
+        if (cur.pos >= cur.end) {
+            return false;
+        }
+        if (*cur.pos == '}') {
+            break;
+        }
+        if (*cur.pos != ',') {
+            return false;
+        }
+        cur.pos++;
+    }
+
+    // Whole object is valid, only now commit the values
+    for (int field = 0; field < DV8_FIELD_COUNT; field++) {
+        if (found & DV8_FIELD_BIT(field)) {
+            dv8_state_set_field(state, field, values[field]);
+        }
+    }
+    return true;
+}
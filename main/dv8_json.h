@@ -0,0 +1,19 @@
+#ifndef DV8_JSON_H
+#define DV8_JSON_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "dv8_state.h"
+
+/*
+ * Decode a flat {"key": number, ...} payload without allocating. Keys named after a field
+ * in `fields` (DV8_FIELD_BIT mask) are written to `state`, matching cJSON_GetObjectItem()
+ * semantics: case-insensitive keys, first occurrence wins, other keys are ignored.
+ *
+ * Returns false without touching `state` if the payload has any other shape (nested values,
+ * strings, escapes, ...); the caller should then fall back to cJSON.
+ */
+extern bool dv8_json_decode(const char *data, size_t data_len, uint32_t fields, dv8_robot_state_t *state);
+
+#endif
@@ -0,0 +1,185 @@
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "dv8_latency.h"
+#include "dv8_seqlock.h"
+
+// Log-linear buckets over 32 us units: exact below 8 units, then 8 buckets per power of two up
+// to 2^18 units (8.4 s). Anything slower lands in the last bucket, max_us still has it exactly.
+#define LATENCY_UNIT_SHIFT      5
+#define LATENCY_SUB_BITS        3
+#define LATENCY_MAX_UNITS_LOG2  18
+#define LATENCY_BUCKET_COUNT    ((LATENCY_MAX_UNITS_LOG2 - LATENCY_SUB_BITS + 1) << LATENCY_SUB_BITS)
+
+typedef struct {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint32_t buckets[LATENCY_BUCKET_COUNT];
+} latency_hist_t;
+
+// Changed on screen but not flushed yet, oldest stamp per field (LVGL side)
+static int64_t pending_us[DV8_FIELD_COUNT];
+static uint32_t pending_fields = 0;
+
+// In the frame whose last area is on its way to the panel
+static int64_t flushing_us[DV8_FIELD_COUNT];
+static _Atomic(uint32_t) flushing_fields;
+
+// Guards hists, dv8_latency_frame_done() is its writer
+static dv8_seqlock_t hist_seq;
+static latency_hist_t hists[DV8_FIELD_COUNT];
+static atomic_bool reset_requested;
+
+
+static unsigned bucket_of(uint32_t units)
+{
+    if (units >= 1UL << LATENCY_MAX_UNITS_LOG2) {
+        return LATENCY_BUCKET_COUNT - 1;
+    }
+    if (units < 1U << LATENCY_SUB_BITS) {
+        return units;
+    }
+    unsigned msb = 31 - __builtin_clz(units);
+    unsigned sub = (units >> (msb - LATENCY_SUB_BITS)) & ((1U << LATENCY_SUB_BITS) - 1);
+    return ((msb - LATENCY_SUB_BITS + 1) << LATENCY_SUB_BITS) + sub;
+}
+
+// First value in us that no longer falls into `bucket`
+static uint32_t bucket_end_us(unsigned bucket)
+{
+    uint32_t end_units;
+    if (bucket < 1U << LATENCY_SUB_BITS) {
+        end_units = bucket + 1;
+    } else {
+        unsigned msb = (bucket >> LATENCY_SUB_BITS) + LATENCY_SUB_BITS - 1;
+        unsigned sub = bucket & ((1U << LATENCY_SUB_BITS) - 1);
+        end_units = ((1U << LATENCY_SUB_BITS) + sub + 1) << (msb - LATENCY_SUB_BITS);
+    }
+    return end_units << LATENCY_UNIT_SHIFT;
+}
+
+static void hist_add(latency_hist_t *hist, uint32_t latency_us)
+{
+    if (hist->count == 0 || latency_us < hist->min_us) {
+        hist->min_us = latency_us;
+    }
+    if (latency_us > hist->max_us) {
+        hist->max_us = latency_us;
+    }
+    hist->count++;
+    hist->buckets[bucket_of(latency_us >> LATENCY_UNIT_SHIFT)]++;
+}
+
+// Smallest bucket end that covers `permille` of the samples, never above the real max
+static uint32_t hist_percentile(const latency_hist_t *hist, uint32_t permille)
+{
+    uint64_t rank = ((uint64_t)hist->count * permille + 999) / 1000;
+    uint64_t seen = 0;
+
+    for (unsigned i = 0; i < LATENCY_BUCKET_COUNT; i++) {
+        seen += hist->buckets[i];
+        if (seen >= rank) {
+            uint32_t end_us = bucket_end_us(i) - 1;
+            return end_us < hist->max_us ? end_us : hist->max_us;
+        }
+    }
+    return hist->max_us;
+}
+
+void dv8_latency_mark(dv8_field_t field, int64_t changed_us)
+{
+    // Keep the oldest change, that's the one the glass is late for
+    if ((pending_fields & DV8_FIELD_BIT(field)) == 0) {
+        pending_us[field] = changed_us;
+        pending_fields |= DV8_FIELD_BIT(field);
+    }
+}
+
+void dv8_latency_frame_flushing(void)
+{
+    // LVGL waits for the previous area's transfer before flushing the next one, so the last frame
+    // is always done by now and flushing_us is free again
+    uint32_t fields = atomic_load_explicit(&flushing_fields, memory_order_relaxed) | pending_fields;
+    for (int field = 0; field < DV8_FIELD_COUNT; field++) {
+        if (pending_fields & DV8_FIELD_BIT(field)) {
+            flushing_us[field] = pending_us[field];
+        }
+    }
+    pending_fields = 0;
+    atomic_store_explicit(&flushing_fields, fields, memory_order_release);
+}
+
+void dv8_latency_frame_done(int64_t now_us)
+{
+    bool reset = atomic_exchange_explicit(&reset_requested, false, memory_order_relaxed);
+    uint32_t fields = atomic_load_explicit(&flushing_fields, memory_order_acquire);
+    if (fields == 0 && !reset) {
+        return;
+    }
+
+    dv8_seqlock_write_begin(&hist_seq);
+    if (reset) {
+        memset(hists, 0, sizeof(hists));
+    }
+    for (int field = 0; field < DV8_FIELD_COUNT; field++) {
+        if (fields & DV8_FIELD_BIT(field)) {
+            int64_t latency_us = now_us - flushing_us[field];
+            hist_add(&hists[field], latency_us < 0 ? 0 : latency_us > UINT32_MAX ? UINT32_MAX : latency_us);
+        }
+    }
+
+    dv8_seqlock_write_end(&hist_seq);
+    atomic_store_explicit(&flushing_fields, 0, memory_order_relaxed);
+}
+
+void dv8_latency_get(dv8_field_t field, dv8_latency_summary_t *out)
+{
+    latency_hist_t hist;
+    uint32_t seq;
+
+    do {
+        seq = dv8_seqlock_read_begin(&hist_seq);
+        hist = hists[field];
+    } while (dv8_seqlock_read_retry(&hist_seq, seq));
+
+    out->count = hist.count;
+    out->min_us = hist.min_us;
+    out->p50_us = hist_percentile(&hist, 500);
+    out->p99_us = hist_percentile(&hist, 990);
+    out->max_us = hist.max_us;
+}
+
+void dv8_latency_reset(void)
+{
+    atomic_store_explicit(&reset_requested, true, memory_order_relaxed);
+}
+
+int dv8_latency_format_json(char *buf, size_t size)
+{
+    int len = snprintf(buf, size, "{");
+    const char *sep = "";
+
+    for (int field = 0; field < DV8_FIELD_COUNT && len >= 0; field++) {
+        dv8_latency_summary_t s;
+        dv8_latency_get(field, &s);
+        if (s.count == 0) {
+            continue;
+        }
+        size_t used = (size_t)len < size ? (size_t)len : size;
+        int n = snprintf(buf + used, size - used,
+                         "%s\"%s\":{\"n\":%lu,\"min\":%lu,\"p50\":%lu,\"p99\":%lu,\"max\":%lu}",
+                         sep, dv8_field_info[field].name, (unsigned long)s.count, (unsigned long)s.min_us,
+                         (unsigned long)s.p50_us, (unsigned long)s.p99_us, (unsigned long)s.max_us);
+        len = n < 0 ? n : len + n;
+        sep = ",";
+    }
+    if (len < 0) {
+        return len;
+    }
+
+    size_t used = (size_t)len < size ? (size_t)len : size;
+    int n = snprintf(buf + used, size - used, "}");
+    return n < 0 ? n : len + n;
+}
@@ -0,0 +1,43 @@
+#ifndef DV8_LATENCY_H
+#define DV8_LATENCY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "dv8_state.h"
+
+/*
+ * Message-to-photon latency per robot state field: from the esp_timer_get_time() stamp taken in
+ * mqtt_event_handler (dv8_robot_state_t.changed_us) to the panel IO reporting that the last area
+ * of the first frame showing the change went out over SPI.
+ *
+ * Each step is called from one place, so the module needs no locks:
+ *   dv8_latency_mark()           lvgl_sync_robot_state(), lvgl_api_lock held
+ *   dv8_latency_frame_flushing() flush_cb of the last area of a frame, lvgl_api_lock held
+ *   dv8_latency_frame_done()     transfer-done callback of that area, may be an ISR
+ * The histograms have a single writer (dv8_latency_frame_done) and are read through a seqlock
+ * (dv8_seqlock.h) like dv8_state, so dv8_latency_get() works from any task.
+ */
+
+typedef struct {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t p50_us;        // percentiles are bucket upper bounds, within 1/8 of the real value
+    uint32_t p99_us;
+    uint32_t max_us;
+} dv8_latency_summary_t;
+
+// A field changed on screen, `changed_us` is the stamp of the message that changed it
+extern void dv8_latency_mark(dv8_field_t field, int64_t changed_us);
+// The last area of a frame is being flushed, everything marked so far is in it
+extern void dv8_latency_frame_flushing(void);
+// That area reached the panel at `now_us`
+extern void dv8_latency_frame_done(int64_t now_us);
+
+extern void dv8_latency_get(dv8_field_t field, dv8_latency_summary_t *out);
+// Cleared by the next dv8_latency_frame_done(), so the writer stays the only writer
+extern void dv8_latency_reset(void);
+// {"e_stop":{"n":..,"min":..,"p50":..,"p99":..,"max":..},...} for the fields with samples.
+// Returns the length like snprintf.
+extern int dv8_latency_format_json(char *buf, size_t size);
+
+#endif
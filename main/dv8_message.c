@@ -0,0 +1,100 @@
+#include "dv8_message.h"
+#include "dv8_state.h"
+#include "dv8_topics.h"
+#include "dv8_json.h"
+#include "dv8_packed.h"
+#include "dv8_stale.h"
+#include "dv8_history.h"
+#ifndef DV8_NO_CJSON
+#include <cJSON.h>
+#endif
+
+// Working copy owned by the calling task, published with dv8_state_publish()
+static dv8_robot_state_t robot_state;
+
+
+#ifndef DV8_NO_CJSON
+static void save_value(cJSON *json, dv8_field_t field, dv8_robot_state_t *state)
+{
+    cJSON *temp = cJSON_GetObjectItem(json,dv8_field_info[field].name);
+    if (temp) {
+        dv8_state_set_field(state,field,cJSON_GetNumberValue(temp));
+    }
+}
+
+static bool decode_with_cjson(const char *data, size_t data_len, uint32_t fields, dv8_robot_state_t *state)
+{
+    cJSON *json = cJSON_ParseWithLength(data, data_len);
+
+    if (json == NULL) {
+        return false;
+    }
+
+    for (int field = 0; field < DV8_FIELD_COUNT; field++) {
+        if (fields & DV8_FIELD_BIT(field)) {
+            save_value(json,field,state);
+        }
+    }
+    cJSON_Delete(json);
+    return true;
+}
+#endif
+
+bool dv8_message_decode(const dv8_topic_t *desc, const char *data, size_t data_len, dv8_robot_state_t *state)
+{
+    // Packed payloads are told apart by their first byte. Flat {"key": number} JSON decodes
+    // straight into the state, cJSON only for anything else.
+    if (dv8_packed_detect(data, data_len)) {
+        return dv8_packed_decode(data, data_len, desc->fields, state);
+    }
+    if (dv8_json_decode(data, data_len, desc->fields, state)) {
+        return true;
+    }
+#ifndef DV8_NO_CJSON
+    return decode_with_cjson(data, data_len, desc->fields, state);
+#else
+    return false;
+#endif
+}
+
+void dv8_message_restore(const dv8_robot_state_t *state)
+{
+    robot_state = *state;
+    dv8_state_publish(&robot_state);
+}
+
+dv8_message_result_t dv8_message_handle(const char *topic, size_t topic_len, const char *data, size_t data_len,
+                                        int64_t received_us, const dv8_topic_t **desc_out)
+{
+    // Resolve the topic in place before spending any time on the payload
+    const dv8_topic_t *desc = dv8_topic_lookup(topic, topic_len);
+    if (desc_out != NULL) {
+        *desc_out = desc;
+    }
+    if (desc == NULL) {
+        return DV8_MESSAGE_UNKNOWN_TOPIC;
+    }
+
+    dv8_robot_state_t before = robot_state;
+
+    if (!dv8_message_decode(desc, data, data_len, &robot_state)) {
+        return DV8_MESSAGE_BAD_PAYLOAD;
+    }
+
+    uint32_t changed = dv8_state_diff(&before, &robot_state);
+    for (int field = 0; field < DV8_FIELD_COUNT; field++) {
+        if (changed & DV8_FIELD_BIT(field)) {
+            robot_state.changed_us[field] = received_us;
+            if (DV8_HISTORY_FIELDS & DV8_FIELD_BIT(field)) {
+                dv8_history_add(field, dv8_state_get_field(&robot_state, field), received_us);
+            }
+        }
+    }
+
+    // Stamp the receipt before publishing, so the UI never revives a field from an older snapshot
+    uint32_t revived = dv8_stale_touch(desc->fields, received_us);
+    if (dv8_state_publish(&robot_state)) {
+        return DV8_MESSAGE_CHANGED;
+    }
+    return revived != 0 ? DV8_MESSAGE_REFRESHED : DV8_MESSAGE_UNCHANGED;
+}
@@ -0,0 +1,42 @@
+#ifndef DV8_MESSAGE_H
+#define DV8_MESSAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "dv8_state.h"
+#include "dv8_topics.h"
+
+typedef enum {
+    DV8_MESSAGE_UNCHANGED = 0,      // valid, but the robot state is the same as before
+    DV8_MESSAGE_CHANGED,            // a new snapshot was published
+    DV8_MESSAGE_REFRESHED,          // same values, but some of them had expired (dv8_stale)
+    DV8_MESSAGE_UNKNOWN_TOPIC,      // not one of dv8_topics, payload not looked at
+    DV8_MESSAGE_FLEET_FULL,         // fleet mode: a new robot id and no room left for it
+    DV8_MESSAGE_BAD_PAYLOAD,        // topic known but the payload didn't parse
+} dv8_message_result_t;
+
+/*
+ * Decode one MQTT message into the working copy of the robot state and publish it with
+ * dv8_state_publish(). Topic and payload don't need to be NUL-terminated. This is the whole
+ * receive path of mqtt_event_handler minus the ESP-IDF glue, so replays and the host
+ * simulator go through exactly the same code. Only one task may call it.
+ * `received_us` (esp_timer_get_time() on arrival) is stored as changed_us of every field the
+ * message changed, for the message-to-photon latency in dv8_latency. It is also the receive
+ * time of every field the topic carries for dv8_stale, and the time of each new value in
+ * dv8_history.
+ * `desc`, if not NULL, is set to the topic's dv8_topics entry, NULL for an unknown topic, so the
+ * caller can log the message without looking the topic up again.
+ */
+extern dv8_message_result_t dv8_message_handle(const char *topic, size_t topic_len, const char *data, size_t data_len,
+                                               int64_t received_us, const dv8_topic_t **desc);
+
+// Start the working copy from `state` (e.g. dv8_state_cache) instead of all zeros and publish it,
+// so the first messages only change what they carry. Before the first dv8_message_handle().
+extern void dv8_message_restore(const dv8_robot_state_t *state);
+
+// Decode a payload of topic `desc` into `state`, packed or JSON. Fields the payload doesn't
+// carry are left alone. Returns false if it didn't parse, `state` may be partly written then.
+extern bool dv8_message_decode(const dv8_topic_t *desc, const char *data, size_t data_len, dv8_robot_state_t *state);
+
+#endif
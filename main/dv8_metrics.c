@@ -0,0 +1,192 @@
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include "dv8_metrics.h"
+
+// Log-linear buckets over 64 us units: exact below 4 units, then 4 buckets per power of two up
+// to 2^12 units (262 ms). Anything slower lands in the last bucket, max_us still has it exactly.
+#define METRICS_UNIT_SHIFT      6
+#define METRICS_SUB_BITS        2
+#define METRICS_MAX_UNITS_LOG2  12
+#define METRICS_BUCKET_COUNT    ((METRICS_MAX_UNITS_LOG2 - METRICS_SUB_BITS + 1) << METRICS_SUB_BITS)
+
+#define METRICS_RESULT_COUNT    (DV8_MESSAGE_BAD_PAYLOAD + 1)
+
+typedef struct {
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t sum_us;
+    uint32_t buckets[METRICS_BUCKET_COUNT];
+} metrics_hist_t;
+
+static int64_t (*clock_now_us)(void);
+
+// LVGL task only
+static metrics_hist_t render_hist;
+static metrics_hist_t pass_hist;
+static int64_t last_report_us;
+static uint32_t last_report_cost_us;
+static dv8_metrics_sample_t last_sample;
+static uint32_t last_messages[METRICS_RESULT_COUNT];
+
+// MQTT task adds, the report reads
+static _Atomic(uint32_t) messages[METRICS_RESULT_COUNT];
+
+
+static unsigned bucket_of(uint32_t units)
+{
+    if (units >= 1UL << METRICS_MAX_UNITS_LOG2) {
+        return METRICS_BUCKET_COUNT - 1;
+    }
+    if (units < 1U << METRICS_SUB_BITS) {
+        return units;
+    }
+    unsigned msb = 31 - __builtin_clz(units);
+    unsigned sub = (units >> (msb - METRICS_SUB_BITS)) & ((1U << METRICS_SUB_BITS) - 1);
+    return ((msb - METRICS_SUB_BITS + 1) << METRICS_SUB_BITS) + sub;
+}
+
+// First value in us that no longer falls into `bucket`
+static uint32_t bucket_end_us(unsigned bucket)
+{
+    uint32_t end_units;
+    if (bucket < 1U << METRICS_SUB_BITS) {
+        end_units = bucket + 1;
+    } else {
+        unsigned msb = (bucket >> METRICS_SUB_BITS) + METRICS_SUB_BITS - 1;
+        unsigned sub = bucket & ((1U << METRICS_SUB_BITS) - 1);
+        end_units = ((1U << METRICS_SUB_BITS) + sub + 1) << (msb - METRICS_SUB_BITS);
+    }
+    return end_units << METRICS_UNIT_SHIFT;
+}
+
+static void hist_add(metrics_hist_t *hist, uint32_t us)
+{
+    hist->count++;
+    hist->sum_us += us;
+    if (us > hist->max_us) {
+        hist->max_us = us;
+    }
+    hist->buckets[bucket_of(us >> METRICS_UNIT_SHIFT)]++;
+}
+
+// Smallest bucket end that covers `permille` of the samples, never above the real max
+static uint32_t hist_percentile(const metrics_hist_t *hist, uint32_t permille)
+{
+    uint64_t rank = ((uint64_t)hist->count * permille + 999) / 1000;
+    uint64_t seen = 0;
+
+    for (unsigned i = 0; i < METRICS_BUCKET_COUNT; i++) {
+        seen += hist->buckets[i];
+        if (seen >= rank) {
+            uint32_t end_us = bucket_end_us(i) - 1;
+            return end_us < hist->max_us ? end_us : hist->max_us;
+        }
+    }
+    return hist->max_us;
+}
+
+void dv8_metrics_set_clock(int64_t (*now_us)(void))
+{
+    clock_now_us = now_us;
+    last_report_us = now_us();
+}
+
+void dv8_metrics_frame(uint32_t render_us)
+{
+    hist_add(&render_hist, render_us);
+}
+
+void dv8_metrics_pass(uint32_t busy_us)
+{
+    hist_add(&pass_hist, busy_us);
+}
+
+void dv8_metrics_message(dv8_message_result_t result)
+{
+    if ((unsigned)result < METRICS_RESULT_COUNT) {
+        atomic_fetch_add_explicit(&messages[result], 1, memory_order_relaxed);
+    }
+}
+
+// snprintf at the end of what's there so far, `len` keeps counting past `size` like snprintf does
+static void append(char *buf, size_t size, int *len, const char *format, ...)
+{
+    if (*len < 0) {
+        return;
+    }
+    size_t used = (size_t)*len < size ? (size_t)*len : size;
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buf + used, size - used, format, args);
+    va_end(args);
+    *len = n < 0 ? n : *len + n;
+}
+
+static void append_hist(char *buf, size_t size, int *len, const char *key, const metrics_hist_t *hist)
+{
+    append(buf, size, len, ",\"%s\":{\"n\":%lu,\"p50\":%lu,\"p99\":%lu,\"max\":%lu}", key, (unsigned long)hist->count,
+           (unsigned long)hist_percentile(hist, 500), (unsigned long)hist_percentile(hist, 990),
+           (unsigned long)hist->max_us);
+}
+
+/*
+ * Keys, counts and times over the "ms" since the previous report:
+ *   up      uptime, s                       fps     frames rendered per s
+ *   render  frame render+flush time, us     cpu     LVGL task busy, % of the period
+ *   pass    LVGL task work per wakeup, us   drop    frames lvgl_pacer dropped
+ *   heap    LVGL heap: size, free, biggest free block, peak use (bytes), frag (%)
+ *   spi     kB flushed, kB/s while transferring, busy (% of the period)
+ *   msg     MQTT messages by dv8_message_result_t
+ *   cmd_drop  lvgl_cmd posts dropped       cost    us the previous report took
+ * fps, cpu and spi busy have one decimal, everything else is an integer.
+ */
+int dv8_metrics_report(const dv8_metrics_sample_t *sample, char *buf, size_t size)
+{
+    int64_t start_us = clock_now_us();
+    uint32_t period_us = (uint32_t)(start_us - last_report_us);
+    period_us = period_us > 0 ? period_us : 1;
+
+    uint32_t msgs[METRICS_RESULT_COUNT], msg_total = 0;
+    for (int i = 0; i < METRICS_RESULT_COUNT; i++) {
+        uint32_t count = atomic_load_explicit(&messages[i], memory_order_relaxed);
+        msgs[i] = count - last_messages[i];
+        last_messages[i] = count;
+        msg_total += msgs[i];
+    }
+    uint32_t flush_bytes = sample->flush_bytes - last_sample.flush_bytes;
+    uint32_t flush_busy_us = sample->flush_busy_us - last_sample.flush_busy_us;
+
+    uint32_t fps_x10 = (uint32_t)((uint64_t)render_hist.count * 10000000 / period_us);
+    uint32_t cpu_x10 = (uint32_t)(pass_hist.sum_us * 1000 / period_us);
+    uint32_t spi_x10 = (uint32_t)((uint64_t)flush_busy_us * 1000 / period_us);
+
+    int len = 0;
+    append(buf, size, &len, "{\"up\":%lu,\"ms\":%lu,\"fps\":%lu.%lu", (unsigned long)(start_us / 1000000),
+           (unsigned long)(period_us / 1000), (unsigned long)(fps_x10 / 10), (unsigned long)(fps_x10 % 10));
+    append_hist(buf, size, &len, "render", &render_hist);
+    append(buf, size, &len, ",\"cpu\":%lu.%lu", (unsigned long)(cpu_x10 / 10), (unsigned long)(cpu_x10 % 10));
+    append_hist(buf, size, &len, "pass", &pass_hist);
+    append(buf, size, &len, ",\"drop\":%lu", (unsigned long)(sample->frames_dropped - last_sample.frames_dropped));
+    append(buf, size, &len, ",\"heap\":{\"size\":%lu,\"free\":%lu,\"big\":%lu,\"peak\":%lu,\"frag\":%u}",
+           (unsigned long)sample->heap_total, (unsigned long)sample->heap_free,
+           (unsigned long)sample->heap_biggest_free, (unsigned long)sample->heap_max_used, sample->heap_frag_pct);
+    append(buf, size, &len, ",\"spi\":{\"kB\":%lu,\"kBps\":%lu,\"busy\":%lu.%lu}", (unsigned long)(flush_bytes / 1000),
+           (unsigned long)(flush_busy_us ? (uint64_t)flush_bytes * 1000 / flush_busy_us : 0),
+           (unsigned long)(spi_x10 / 10), (unsigned long)(spi_x10 % 10));
+    append(buf, size, &len, ",\"msg\":{\"n\":%lu,\"chg\":%lu,\"same\":%lu,\"ref\":%lu,\"unk\":%lu,\"full\":%lu,\"bad\":%lu}",
+           (unsigned long)msg_total, (unsigned long)msgs[DV8_MESSAGE_CHANGED],
+           (unsigned long)msgs[DV8_MESSAGE_UNCHANGED], (unsigned long)msgs[DV8_MESSAGE_REFRESHED],
+           (unsigned long)msgs[DV8_MESSAGE_UNKNOWN_TOPIC], (unsigned long)msgs[DV8_MESSAGE_FLEET_FULL],
+           (unsigned long)msgs[DV8_MESSAGE_BAD_PAYLOAD]);
+    append(buf, size, &len, ",\"cmd_drop\":%lu,\"cost\":%lu}",
+           (unsigned long)(sample->cmds_dropped - last_sample.cmds_dropped), (unsigned long)last_report_cost_us);
+
+    memset(&render_hist, 0, sizeof(render_hist));
+    memset(&pass_hist, 0, sizeof(pass_hist));
+    last_sample = *sample;
+    last_report_us = start_us;
+    last_report_cost_us = (uint32_t)(clock_now_us() - start_us);
+    return len;
+}
@@ -0,0 +1,48 @@
+#ifndef DV8_METRICS_H
+#define DV8_METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "dv8_message.h"
+
+/*
+ * Panel performance telemetry, published as one JSON object on <prefix>/ui/metrics every
+ * CONFIG_DV8_METRICS_PUBLISH_PERIOD_MS.
+ *
+ * The hot paths only bump fixed-size counters and histogram buckets:
+ *   dv8_metrics_frame()      LVGL task, per rendered frame (lvgl_pacer)
+ *   dv8_metrics_pass()       LVGL task, per wakeup of the task, the work it did
+ *   dv8_metrics_message()    MQTT task, per message, an atomic add
+ * dv8_metrics_report() runs on the LVGL task too, so the histograms need no locks. It turns
+ * the counters into rates over the period since the previous report and clears the histograms.
+ * Whatever else it reports (LVGL heap, SPI, frames lvgl_pacer skipped) comes in a
+ * dv8_metrics_sample_t the caller fills from counters that already exist.
+ */
+
+typedef struct {
+    // lv_mem_monitor()
+    uint32_t heap_total;
+    uint32_t heap_free;
+    uint32_t heap_biggest_free;
+    uint32_t heap_max_used;
+    uint8_t heap_frag_pct;
+    // Since boot, the report takes the difference to the previous sample
+    uint32_t flush_bytes;
+    uint32_t flush_busy_us;
+    uint32_t frames_dropped;    // lvgl_pacer_stats_t.dropped
+    uint32_t cmds_dropped;      // lvgl_cmd_stats_t.dropped
+} dv8_metrics_sample_t;
+
+// Microsecond clock for the report periods and the report's own cost
+extern void dv8_metrics_set_clock(int64_t (*now_us)(void));
+// A frame was rendered and flushed in `render_us`
+extern void dv8_metrics_frame(uint32_t render_us);
+// The LVGL task was busy for `busy_us` before it went back to sleep
+extern void dv8_metrics_pass(uint32_t busy_us);
+extern void dv8_metrics_message(dv8_message_result_t result);
+
+// {"up":..,"ms":..,"fps":..,"render":{..},"cpu":..,...} into `buf`, see dv8_metrics.c for the keys.
+// Returns the length like snprintf; the histograms are cleared either way.
+extern int dv8_metrics_report(const dv8_metrics_sample_t *sample, char *buf, size_t size);
+
+#endif
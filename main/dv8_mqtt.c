@@ -3,36 +3,99 @@
 #include <string.h>
 #include <stdlib.h>
 #include <inttypes.h>
+#include <sys/lock.h>
 #include "esp_system.h"
 #include "nvs_flash.h"
 #include "esp_event.h"
 #include "esp_netif.h"
 #include "protocol_examples_common.h"
-#include <stdatomic.h>
-#include <cJSON.h>
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "mqtt_client.h"
 #include "dv8_mqtt.h"
+#include "dv8_topics.h"
+#include "dv8_message.h"
+#include "dv8_recorder.h"
+#include "dv8_latency.h"
+#include "dv8_metrics.h"
+#include "dv8_fleet.h"
+#include "dv8_boot.h"
+#include "dv8_binlog.h"
 
 static const char *TAG = "mqtt_example";
 
+// The panel's own diagnostics, which the <prefix>/# subscription delivers back to it
+#define DV8_UI_TOPIC_PREFIX DV8_TOPIC_PREFIX "/ui/"
+#define DV8_LATENCY_TOPIC DV8_UI_TOPIC_PREFIX "latency"
+#define DV8_METRICS_TOPIC DV8_UI_TOPIC_PREFIX "metrics"
+#define DV8_SUBSCRIBE_TOPIC DV8_TOPIC_PREFIX "/#"
 
+static esp_mqtt_client_handle_t mqtt_client = NULL;
+static bool mqtt_connected = false;
 
-static void save_value_float(cJSON *json, _Atomic(float) *parameter, char *parameter_name)
+// Reconnect-to-first-update timing, logged once per connection
+static int64_t connect_start_us = 0;
+static int64_t connected_us = 0;
+static bool awaiting_first_update = false;
+
+static dv8_state_changed_cb_t state_changed_cb = NULL;
+static void *state_changed_ctx = NULL;
+
+#if !CONFIG_DV8_FLEET_MODE
+// What the state log last printed, per field, and the changes seen since. The MQTT task and
+// mqtt_flush_state_log() both log, under the lock.
+static _lock_t state_log_lock;
+static dv8_robot_state_t logged_state;
+static uint32_t logged_ms[DV8_FIELD_COUNT];
+static uint32_t unlogged_changes[DV8_FIELD_COUNT];
+#endif
+
+
+#if !CONFIG_DV8_FLEET_MODE
+/*
+ * Log the fields that differ from what was logged last, each at most once per
+ * CONFIG_DV8_STATE_LOG_INTERVAL_MS. A field that changes faster gets its changes counted and
+ * its latest value logged once the interval is up, on the next message that changes anything
+ * or the next mqtt_flush_state_log(), whichever comes first.
+ */
+static void log_state_changes(void)
 {
-    cJSON *temp = cJSON_GetObjectItem(json,parameter_name);
-    if (temp) {
-	atomic_store(parameter,cJSON_GetNumberValue(temp));
-	//ESP_LOGI(TAG,"RECIEVE: %s: %f",parameter_name,parameter);
+    _lock_acquire(&state_log_lock);
+    // Read under the lock, so neither task logs older than what the other just did
+    dv8_robot_state_t state;
+    dv8_state_read(&state);
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    uint32_t changed = dv8_state_diff(&state, &logged_state);
+
+    for (int f = 0; f < DV8_FIELD_COUNT; f++) {
+        if (!(changed & DV8_FIELD_BIT(f))) {
+            continue;
+        }
+        if (state.changed_us[f] != logged_state.changed_us[f]) {
+            unlogged_changes[f]++;
+            logged_state.changed_us[f] = state.changed_us[f];
+        }
+        if (now_ms - logged_ms[f] < CONFIG_DV8_STATE_LOG_INTERVAL_MS) {
+            continue;
+        }
+        // The change being logged isn't one of the changes not logged
+        uint32_t skipped = unlogged_changes[f] > 0 ? unlogged_changes[f] - 1 : 0;
+        double value = dv8_state_get_field(&state, f);
+        if (DV8_BINLOG(STATE, f, DV8_BINLOG_F((float)value), skipped)) {
+            dv8_state_set_field(&logged_state, f, value);
+            logged_ms[f] = now_ms;
+            unlogged_changes[f] = 0;
+        }
     }
+    _lock_release(&state_log_lock);
 }
+#endif
 
-static void save_value_int(cJSON *json, _Atomic(int) *parameter, char *parameter_name)                                                              {
-    cJSON *temp = cJSON_GetObjectItem(json,parameter_name);
-    if (temp) {
-	atomic_store(parameter,cJSON_GetNumberValue(temp));
-	//ESP_LOGI(TAG,"RECIEVE: %s: %d",parameter_name,parameter);
-    }
+void mqtt_flush_state_log(void)
+{
+#if !CONFIG_DV8_FLEET_MODE
+    log_state_changes();
+#endif
 }
 
 // static void log_error_if_nonzero(const char *message, int error_code)
@@ -59,68 +122,81 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
     esp_mqtt_event_handle_t event = event_data;
     esp_mqtt_client_handle_t client = event->client;
     switch ((esp_mqtt_event_id_t)event_id) {
+	case MQTT_EVENT_BEFORE_CONNECT:
+	    connect_start_us = esp_timer_get_time();
+	    break;
 	case MQTT_EVENT_CONNECTED:
-	    esp_mqtt_client_subscribe(client, "/robot/control/cmd_vel", 0);
-	    esp_mqtt_client_subscribe(client, "/robot/state/battery_percentage", 0);
-	    esp_mqtt_client_subscribe(client, "/robot/state/battery_is_charging", 0);
-	    esp_mqtt_client_subscribe(client, "/robot/state/e_stop", 0);
-	    esp_mqtt_client_subscribe(client, "/robot/state/handbrake", 0);
-	    esp_mqtt_client_subscribe(client, "/robot/state/direct_status", 0);
-	    esp_mqtt_client_subscribe(client, "/robot/state/robot_mode", 0);
-	    esp_mqtt_client_subscribe(client, "/robot/control/brush_speed", 0);
-		esp_mqtt_client_subscribe(client, "/robot/state/safety_mode", 0);
-	    ESP_LOGI(TAG, "MQTT_EVENT_CONNECTED");
+	    connected_us = esp_timer_get_time();
+#if CONFIG_DV8_SUBSCRIBE_PER_TOPIC
+	    for (size_t i = 0; i < dv8_topic_count; i++) {
+		esp_mqtt_client_subscribe(client, dv8_topics[i].topic, 0);
+	    }
+#else
+	    // One round trip, dv8_topic_lookup() drops whatever else lives under the prefix
+	    esp_mqtt_client_subscribe(client, DV8_SUBSCRIBE_TOPIC, 0);
+#endif
+	    ESP_LOGI(TAG, "MQTT_EVENT_CONNECTED after %" PRId64 " ms", (connected_us - connect_start_us) / 1000);
+	    dv8_boot_mark(DV8_BOOT_MQTT);
+	    mqtt_connected = true;
+	    awaiting_first_update = true;
 	    break;
 	case MQTT_EVENT_DISCONNECTED:
 	    ESP_LOGI(TAG, "MQTT_EVENT_DISCONNECTED");
+	    mqtt_connected = false;
 	    break;
 	case MQTT_EVENT_DATA: 
 	    {
-		int topic_len = event->topic_len;
-		char topic[topic_len + 1];
-		int data_len = event->data_len;
-		char data[data_len + 1];
-
-		if (topic_len == 0 || data_len == 0) {
+		// Stamp first, recording the trace below is part of what the panel is late by
+		int64_t received_us = esp_timer_get_time();
+		if (event->topic_len == 0 || event->data_len == 0) {
+		    break;
+		}
+		// Our own reports coming back are neither robot traffic nor unknown topics
+		if (event->topic_len >= sizeof(DV8_UI_TOPIC_PREFIX) - 1
+		    && memcmp(event->topic, DV8_UI_TOPIC_PREFIX, sizeof(DV8_UI_TOPIC_PREFIX) - 1) == 0) {
 		    break;
 		}
 
-		strncpy(topic, event->topic, topic_len);
-		topic[topic_len] = '\0';
-		strncpy(data, event->data, data_len);
-		data[data_len] = '\0';	
+#if CONFIG_DV8_TRACE_RECORD
+		dv8_recorder_append(received_us, event->topic, event->topic_len, event->data, event->data_len);
+#endif
 
-		ESP_LOGI(TAG,"ON MQTT TOPIC: %s", topic);
+		const dv8_topic_t *desc;
+#if CONFIG_DV8_FLEET_MODE
+		dv8_message_result_t result = dv8_fleet_handle(event->topic, event->topic_len, event->data, event->data_len,
+							       received_us, &desc);
+#else
+		dv8_message_result_t result = dv8_message_handle(event->topic, event->topic_len, event->data, event->data_len,
+								 received_us, &desc);
+#endif
+		dv8_metrics_message(result);
+		// Unknown topics log as topic <dv8_topic_count>
+		uint32_t topic_index = desc != NULL ? (uint32_t)(desc - dv8_topics) : (uint32_t)dv8_topic_count;
+#if !CONFIG_DV8_FLEET_MODE
+		// A whole fleet would spend more time logging than decoding
+		DV8_BINLOG(RECEIVED, topic_index, event->data_len);
+#endif
+		if (result == DV8_MESSAGE_BAD_PAYLOAD) {
+		    DV8_BINLOG(BAD_PAYLOAD, topic_index, event->data_len);
+		}
 
-		cJSON *json = cJSON_Parse(data);
+		if (awaiting_first_update && (result == DV8_MESSAGE_CHANGED || result == DV8_MESSAGE_UNCHANGED || result == DV8_MESSAGE_REFRESHED)) {
+		    ESP_LOGI(TAG, "First update %" PRId64 " ms after connected, %" PRId64 " ms after connecting",
+			     (received_us - connected_us) / 1000, (received_us - connect_start_us) / 1000);
+		    awaiting_first_update = false;
+		    dv8_boot_mark(DV8_BOOT_FIRST_MESSAGE);
+		}
 
-		if (json == NULL) {
-		    ESP_LOGI(TAG,"RECIEVE ERROR DATA: %s", data);
-		    cJSON_Delete(json);
-		    break;		    
+#if !CONFIG_DV8_FLEET_MODE
+		if (result == DV8_MESSAGE_CHANGED) {
+		    log_state_changes();
 		}
+#endif
 
-		if (strcmp(topic,"/robot/control/cmd_vel") == 0) {
-		    save_value_float(json,&linear_x,"linear_x");
-		    save_value_float(json,&angular_z,"angular_z");
-		} else if (strcmp(topic,"/robot/state/battery_percentage") == 0) {
-		    save_value_float(json,&battery_percentage,"battery_percentage");    
-		} else if (strcmp(topic,"/robot/state/battery_is_charging") == 0) {
-		    save_value_int(json,&battery_is_charging,"battery_is_charging");
-		} else if (strcmp(topic,"/robot/state/e_stop") == 0) {
-		    save_value_int(json,&e_stop,"e_stop");    
-		} else if (strcmp(topic,"/robot/state/handbrake") == 0) {
-		    save_value_int(json,&handbrake,"handbrake");
-		} else if (strcmp(topic,"/robot/state/direct_status") == 0) {
-		    save_value_int(json,&direct_status,"direct_status");
-		} else if (strcmp(topic,"/robot/state/robot_mode") == 0) {
-		    save_value_int(json,&robot_mode,"robot_mode");
-		} else if (strcmp(topic,"/robot/control/brush_speed") == 0) {
-		    save_value_int(json,&brush_speed,"brush_speed");
-		} else if (strcmp(topic,"/robot/state/safety_mode") == 0) {
-			save_value_int(json,&safety_mode,"safety_mode");
+		// Wake the UI only when this message changed something or brought back an expired field
+		if ((result == DV8_MESSAGE_CHANGED || result == DV8_MESSAGE_REFRESHED) && state_changed_cb != NULL) {
+		    state_changed_cb(state_changed_ctx);
 		}
-		cJSON_Delete(json);
 		break;
 	    }
 	case MQTT_EVENT_ERROR:
@@ -189,6 +265,34 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
 //     }
 // }
 
+#if CONFIG_DV8_LATENCY_PUBLISH_PERIOD_MS > 0
+/* esp_timer callback: publish the message-to-photon latency summary for the diagnostics side */
+static void publish_latency(void *arg)
+{
+    static char payload[512];
+
+    if (!mqtt_connected) {
+        return;
+    }
+    int len = dv8_latency_format_json(payload, sizeof(payload));
+    if (len < 0 || (size_t)len >= sizeof(payload)) {
+        ESP_LOGW(TAG, "latency summary doesn't fit in %u bytes", (unsigned)sizeof(payload));
+        return;
+    }
+    // enqueue doesn't block the timer task on the network
+    esp_mqtt_client_enqueue(mqtt_client, DV8_LATENCY_TOPIC, payload, len, 0, 0, true);
+}
+#endif
+
+bool mqtt_publish_metrics(const char *payload, int len)
+{
+    if (!mqtt_connected) {
+        return false;
+    }
+    // Same as the latency summary: queued for the MQTT task, never blocks on the network
+    return esp_mqtt_client_enqueue(mqtt_client, DV8_METRICS_TOPIC, payload, len, 0, 0, true) >= 0;
+}
+
 static void mqtt_app_start(void)
 {
     esp_mqtt_client_config_t mqtt_cfg = {
@@ -220,10 +324,32 @@ static void mqtt_app_start(void)
     }
 #endif /* CONFIG_BROKER_URL_FROM_STDIN */
 
+    dv8_topics_init();
+#if CONFIG_DV8_TRACE_RECORD
+    dv8_recorder_start();
+#endif
+
     esp_mqtt_client_handle_t client = esp_mqtt_client_init(&mqtt_cfg);
+    mqtt_client = client;
     /* The last argument may be used to pass data to the event handler, in this example mqtt_event_handler */
     esp_mqtt_client_register_event(client, ESP_EVENT_ANY_ID, mqtt_event_handler, NULL);
     esp_mqtt_client_start(client);
+
+#if CONFIG_DV8_LATENCY_PUBLISH_PERIOD_MS > 0
+    const esp_timer_create_args_t latency_timer_args = {
+        .callback = &publish_latency,
+        .name = "dv8_latency"
+    };
+    esp_timer_handle_t latency_timer = NULL;
+    ESP_ERROR_CHECK(esp_timer_create(&latency_timer_args, &latency_timer));
+    ESP_ERROR_CHECK(esp_timer_start_periodic(latency_timer, CONFIG_DV8_LATENCY_PUBLISH_PERIOD_MS * 1000ULL));
+#endif
+}
+
+void mqtt_set_state_changed_cb(dv8_state_changed_cb_t cb, void *user_ctx)
+{
+    state_changed_ctx = user_ctx;
+    state_changed_cb = cb;
 }
 
 void mqtt_module_start(void)
@@ -233,13 +359,8 @@ void mqtt_module_start(void)
     ESP_LOGI(TAG, "[APP] Free memory: %" PRIu32 " bytes", esp_get_free_heap_size());
     ESP_LOGI(TAG, "[APP] IDF version: %s", esp_get_idf_version());
 
+    // Received topics are binlog records at debug level, set mqtt_example to ESP_LOG_DEBUG to see them
     esp_log_level_set("*", ESP_LOG_INFO);
-    esp_log_level_set("mqtt_client", ESP_LOG_VERBOSE);
-    esp_log_level_set("mqtt_example", ESP_LOG_VERBOSE);
-    esp_log_level_set("transport_base", ESP_LOG_VERBOSE);
-    esp_log_level_set("esp-tls", ESP_LOG_VERBOSE);
-    esp_log_level_set("transport", ESP_LOG_VERBOSE);
-    esp_log_level_set("outbox", ESP_LOG_VERBOSE);
     esp_log_level_set("mqtt_esp", ESP_LOG_ERROR);
 
     //ESP_ERROR_CHECK(nvs_flash_init());
@@ -1,17 +1,19 @@
 #ifndef DV8_MQTT_H
 #define DV8_MQTT_H
 
-extern _Atomic(float) linear_x;
-extern _Atomic(float) angular_z;
-extern _Atomic(float) battery_percentage;
-extern _Atomic(int) brush_speed;
-extern _Atomic(int) battery_is_charging;
-extern _Atomic(int) e_stop;
-extern _Atomic(int) handbrake;
-extern _Atomic(int) direct_status;
-extern _Atomic(int) robot_mode;
-extern _Atomic(int) safety_mode;
+#include "dv8_state.h"
+
+// Called from the MQTT task after a message published a new robot state snapshot
+typedef void (*dv8_state_changed_cb_t)(void *user_ctx);
 
 extern void mqtt_module_start(void);
+extern void mqtt_set_state_changed_cb(dv8_state_changed_cb_t cb, void *user_ctx);
+// Queue a dv8_metrics report for <prefix>/ui/metrics. False while disconnected or if the
+// client's outbox refused it.
+extern bool mqtt_publish_metrics(const char *payload, int len);
+// Log the latest value of state fields whose changes the rate limit held back, once their
+// interval is up, so the last change of a field that went quiet isn't left unlogged. Any task,
+// called periodically from a low-priority one.
+extern void mqtt_flush_state_log(void);
 
 #endif
@@ -0,0 +1,82 @@
+#include <string.h>
+#include "dv8_packed.h"
+
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void put_le32(uint8_t *p, uint32_t value)
+{
+    p[0] = value;
+    p[1] = value >> 8;
+    p[2] = value >> 16;
+    p[3] = value >> 24;
+}
+
+bool dv8_packed_decode(const char *data, size_t data_len, uint32_t fields, dv8_robot_state_t *state)
+{
+    const uint8_t *p = (const uint8_t *)data;
+
+    if (data_len < DV8_PACKED_HEADER_SIZE || p[0] != DV8_PACKED_MAGIC || p[1] != DV8_PACKED_VERSION) {
+        return false;
+    }
+    uint32_t mask = p[2] | (uint32_t)p[3] << 8;
+    if (mask >> DV8_FIELD_COUNT != 0 ||
+        data_len != DV8_PACKED_HEADER_SIZE + DV8_PACKED_VALUE_SIZE * (size_t)__builtin_popcount(mask)) {
+        return false;
+    }
+
+    // The size is right, so nothing below can fail and values go straight into `state`
+    p += DV8_PACKED_HEADER_SIZE;
+    for (int field = 0; field < DV8_FIELD_COUNT; field++) {
+        if ((mask & DV8_FIELD_BIT(field)) == 0) {
+            continue;
+        }
+        if (fields & DV8_FIELD_BIT(field)) {
+            uint32_t raw = get_le32(p);
+            char *member = (char *)state + dv8_field_info[field].offset;
+            if (dv8_field_info[field].type == DV8_VALUE_FLOAT) {
+                float value;
+                memcpy(&value, &raw, sizeof(value));
+                *(float *)member = value;
+            } else {
+                *(int *)member = (int32_t)raw;
+            }
+        }
+        p += DV8_PACKED_VALUE_SIZE;
+    }
+    return true;
+}
+
+size_t dv8_packed_encode(const dv8_robot_state_t *state, uint32_t fields, uint8_t *out, size_t out_size)
+{
+    fields &= DV8_FIELD_BIT(DV8_FIELD_COUNT) - 1;
+    size_t size = DV8_PACKED_HEADER_SIZE + DV8_PACKED_VALUE_SIZE * (size_t)__builtin_popcount(fields);
+    if (size > out_size) {
+        return 0;
+    }
+
+    out[0] = DV8_PACKED_MAGIC;
+    out[1] = DV8_PACKED_VERSION;
+    out[2] = fields;
+    out[3] = fields >> 8;
+
+    uint8_t *p = out + DV8_PACKED_HEADER_SIZE;
+    for (int field = 0; field < DV8_FIELD_COUNT; field++) {
+        if ((fields & DV8_FIELD_BIT(field)) == 0) {
+            continue;
+        }
+        const char *member = (const char *)state + dv8_field_info[field].offset;
+        uint32_t raw;
+        if (dv8_field_info[field].type == DV8_VALUE_FLOAT) {
+            memcpy(&raw, member, sizeof(raw));
+        } else {
+            raw = (uint32_t)*(const int *)member;
+        }
+        put_le32(p, raw);
+        p += DV8_PACKED_VALUE_SIZE;
+    }
+    return size;
+}
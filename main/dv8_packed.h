@@ -0,0 +1,41 @@
+#ifndef DV8_PACKED_H
+#define DV8_PACKED_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "dv8_state.h"
+
+/*
+ * Packed binary alternative to the JSON payloads, accepted on every robot topic:
+ *   u8   DV8_PACKED_MAGIC, which can't start JSON text, so the format is detected per message
+ *   u8   DV8_PACKED_VERSION
+ *   u16  field mask, little-endian, DV8_FIELD_BIT of each value that follows
+ *   then for every set bit in field order a little-endian 32-bit value: IEEE float for
+ *   DV8_VALUE_FLOAT fields, two's complement int otherwise
+ * "{\"e_stop\": 1}" is 13 bytes, the same update packed is 8.
+ */
+
+#define DV8_PACKED_MAGIC        0xD8
+#define DV8_PACKED_VERSION      1
+#define DV8_PACKED_HEADER_SIZE  4
+#define DV8_PACKED_VALUE_SIZE   4
+#define DV8_PACKED_MAX_SIZE     (DV8_PACKED_HEADER_SIZE + DV8_PACKED_VALUE_SIZE * DV8_FIELD_COUNT)
+
+_Static_assert(DV8_FIELD_COUNT <= 16, "the field mask is 16 bits");
+
+static inline bool dv8_packed_detect(const char *data, size_t data_len)
+{
+    return data_len > 0 && (uint8_t)data[0] == DV8_PACKED_MAGIC;
+}
+
+/*
+ * Values for fields in `fields` (DV8_FIELD_BIT mask) are written to `state`, others are skipped
+ * like unrelated JSON keys. Returns false without touching `state` on a wrong version, a size
+ * that doesn't match the mask, or unknown mask bits.
+ */
+extern bool dv8_packed_decode(const char *data, size_t data_len, uint32_t fields, dv8_robot_state_t *state);
+// Encode the `fields` of `state`, returns the size or 0 if `out_size` is too small
+extern size_t dv8_packed_encode(const dv8_robot_state_t *state, uint32_t fields, uint8_t *out, size_t out_size);
+
+#endif
@@ -0,0 +1,84 @@
+#include "sdkconfig.h"
+#if CONFIG_DV8_TRACE_RECORD
+
+#include <inttypes.h>
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include "dv8_recorder.h"
+#include "dv8_trace.h"
+
+#define DV8_RECORDER_MAX_RECORD 1024
+
+static const char *TAG = "dv8_recorder";
+
+static const esp_partition_t *trace_partition = NULL;
+static size_t write_offset = 0;     // next free byte in the partition
+static int64_t last_record_us = 0;
+static uint32_t dropped = 0;
+static uint8_t record_buf[DV8_RECORDER_MAX_RECORD];
+
+
+// Erase the block that `offset` falls in, returns false if past the end of the partition
+static bool erase_block_at(size_t offset)
+{
+    if (offset + DV8_TRACE_BLOCK_SIZE > trace_partition->size) {
+        return false;
+    }
+    return esp_partition_erase_range(trace_partition, offset, DV8_TRACE_BLOCK_SIZE) == ESP_OK;
+}
+
+void dv8_recorder_start(void)
+{
+    trace_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "dv8trace");
+    if (trace_partition == NULL) {
+        ESP_LOGW(TAG, "no \"dv8trace\" partition, MQTT traffic is not recorded");
+        return;
+    }
+
+    uint8_t header[DV8_TRACE_HEADER_SIZE];
+    dv8_trace_write_header(header);
+    if (!erase_block_at(0) || esp_partition_write(trace_partition, 0, header, sizeof(header)) != ESP_OK) {
+        ESP_LOGE(TAG, "failed to start trace");
+        trace_partition = NULL;
+        return;
+    }
+    write_offset = sizeof(header);
+    last_record_us = esp_timer_get_time();
+    ESP_LOGI(TAG, "recording MQTT traffic to \"dv8trace\" (%" PRIu32 " bytes)", trace_partition->size);
+}
+
+void dv8_recorder_append(int64_t now_us, const char *topic, size_t topic_len, const char *data, size_t data_len)
+{
+    if (trace_partition == NULL) {
+        return;
+    }
+
+    size_t len = dv8_trace_encode(record_buf, sizeof(record_buf), now_us - last_record_us,
+                                  topic, topic_len, data, data_len);
+    if (len == 0) {
+        dropped++;
+        return;
+    }
+
+    // Records never straddle an erase block; the erased tail of the old block reads as padding
+    size_t block_end = (write_offset / DV8_TRACE_BLOCK_SIZE + 1) * DV8_TRACE_BLOCK_SIZE;
+    if (write_offset + len > block_end) {
+        if (!erase_block_at(block_end)) {
+            ESP_LOGW(TAG, "trace partition full, %" PRIu32 " oversized records dropped", dropped);
+            trace_partition = NULL;
+            return;
+        }
+        write_offset = block_end;
+    }
+
+    // Only writes bytes that are still erased, so appending to a block needs no erase
+    if (esp_partition_write(trace_partition, write_offset, record_buf, len) != ESP_OK) {
+        dropped++;
+        return;
+    }
+    write_offset += len;
+    last_record_us = now_us;
+}
+
+#endif /* CONFIG_DV8_TRACE_RECORD */
@@ -0,0 +1,19 @@
+#ifndef DV8_RECORDER_H
+#define DV8_RECORDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Records received MQTT messages as a dv8_trace into the "dv8trace" data partition
+ * (CONFIG_DV8_TRACE_RECORD). Each boot starts a new trace at the beginning of the partition,
+ * recording stops silently once it is full. Read it out with
+ *   parttool.py read_partition --partition-name dv8trace --output trace.dv8t
+ * and play it back with simulator/dv8_replay.
+ */
+
+extern void dv8_recorder_start(void);
+// Called from the MQTT task for every MQTT_EVENT_DATA, `now_us` from esp_timer_get_time()
+extern void dv8_recorder_append(int64_t now_us, const char *topic, size_t topic_len, const char *data, size_t data_len);
+
+#endif
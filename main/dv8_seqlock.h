@@ -0,0 +1,64 @@
+#ifndef DV8_SEQLOCK_H
+#define DV8_SEQLOCK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+/*
+ * Sequence lock for data with one writer and readers that must never block it: dv8_state's
+ * snapshot, each fleet robot's snapshot, the dv8_latency histograms.
+ *
+ * The writer makes the sequence odd, rewrites the data and makes it even again; a reader copies
+ * the data between two loads of the sequence and keeps the copy only if both were the same even
+ * value. Ordering, with the data itself accessed non-atomically on both sides:
+ *   - write_begin: the odd store is relaxed, the release fence after it keeps every data store
+ *     of the write after it.
+ *   - write_end: the release store of the even value keeps every data store before it.
+ *   - read_begin: the acquire load keeps the copy after it, so an even value read here means the
+ *     copy starts after the write that stored it finished.
+ *   - read_retry: the acquire fence keeps the copy before the second load, so an unchanged value
+ *     there means no write started during the copy.
+ * A copy that overlapped a write may be torn, and is thrown away; it must not be acted on (no
+ * following pointers out of it) before read_retry() said it is good.
+ *
+ * A reader spins while a write is in progress, so on a single core it must not run at a higher
+ * priority than the writer.
+ */
+
+typedef _Atomic(uint32_t) dv8_seqlock_t;
+
+// Writer: start rewriting the data. Returns the version this write publishes, 1 for the first one.
+static inline uint32_t dv8_seqlock_write_begin(dv8_seqlock_t *lock)
+{
+    uint32_t seq = atomic_load_explicit(lock, memory_order_relaxed);
+    atomic_store_explicit(lock, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    return seq / 2 + 1;
+}
+
+// Writer: the data is consistent again
+static inline void dv8_seqlock_write_end(dv8_seqlock_t *lock)
+{
+    uint32_t seq = atomic_load_explicit(lock, memory_order_relaxed);
+    atomic_store_explicit(lock, seq + 1, memory_order_release);
+}
+
+// Reader, the whole loop: do { seq = dv8_seqlock_read_begin(&lock); copy; } while (dv8_seqlock_read_retry(&lock, seq));
+static inline uint32_t dv8_seqlock_read_begin(dv8_seqlock_t *lock)
+{
+    uint32_t seq;
+    while ((seq = atomic_load_explicit(lock, memory_order_acquire)) & 1) {
+        // write in progress
+    }
+    return seq;
+}
+
+// Reader: true if the copy made since dv8_seqlock_read_begin() returned `seq` may be torn
+static inline bool dv8_seqlock_read_retry(dv8_seqlock_t *lock, uint32_t seq)
+{
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(lock, memory_order_relaxed) != seq;
+}
+
+#endif
@@ -0,0 +1,185 @@
+#include <stdatomic.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "dv8_stale.h"
+
+// 64 slots of DV8_STALE_TICK_MS cover 16 s in one turn, longer timeouts wait out extra turns
+#define STALE_WHEEL_SLOTS   64
+#define STALE_NONE          (-1)
+
+// 0 = never expires. Everything the panel shows is published by the robot at least once a second,
+// except the battery level, which only changes slowly.
+static const uint32_t field_timeout_ms[DV8_FIELD_COUNT] = {
+    [DV8_FIELD_BATTERY_PERCENTAGE]  = CONFIG_DV8_STALE_BATTERY_TIMEOUT_MS,
+    [DV8_FIELD_BATTERY_IS_CHARGING] = CONFIG_DV8_STALE_STATE_TIMEOUT_MS,
+    [DV8_FIELD_E_STOP]              = CONFIG_DV8_STALE_STATE_TIMEOUT_MS,
+    [DV8_FIELD_HANDBRAKE]           = CONFIG_DV8_STALE_STATE_TIMEOUT_MS,
+    [DV8_FIELD_DIRECT_STATUS]       = CONFIG_DV8_STALE_STATE_TIMEOUT_MS,
+    [DV8_FIELD_ROBOT_MODE]          = CONFIG_DV8_STALE_STATE_TIMEOUT_MS,
+    [DV8_FIELD_SAFETY_MODE]         = CONFIG_DV8_STALE_STATE_TIMEOUT_MS,
+};
+
+// Written by the MQTT task, milliseconds so they fit a lock-free atomic on a 32-bit core
+static _Atomic(uint32_t) received_ms[DV8_FIELD_COUNT];
+static _Atomic(uint32_t) stale_fields;
+
+// Wheel, LVGL side only. A field is linked into exactly one slot while it is tracked.
+static int8_t wheel_slots[STALE_WHEEL_SLOTS];
+static int8_t wheel_next[DV8_FIELD_COUNT];
+static uint32_t wheel_deadline_ms[DV8_FIELD_COUNT];
+static uint32_t wheel_time_ms;      // start of the next slot to visit
+
+
+static inline uint32_t to_ms(int64_t us)
+{
+    return (uint32_t)(us / 1000);
+}
+
+// Wrap-safe "a is later than b"
+static inline bool after(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b) > 0;
+}
+
+static void wheel_insert(dv8_field_t field, uint32_t deadline_ms)
+{
+    // A deadline the wheel already went past goes into the next slot it visits
+    uint32_t slot_ms = after(deadline_ms, wheel_time_ms) ? deadline_ms : wheel_time_ms;
+    unsigned slot = (slot_ms / DV8_STALE_TICK_MS) % STALE_WHEEL_SLOTS;
+
+    wheel_deadline_ms[field] = deadline_ms;
+    wheel_next[field] = wheel_slots[slot];
+    wheel_slots[slot] = field;
+}
+
+void dv8_stale_init(int64_t now_us, uint32_t expired)
+{
+    uint32_t now_ms = to_ms(now_us);
+
+    for (unsigned i = 0; i < STALE_WHEEL_SLOTS; i++) {
+        wheel_slots[i] = STALE_NONE;
+    }
+    wheel_time_ms = now_ms;
+    atomic_store(&stale_fields, 0);
+
+    for (int field = 0; field < DV8_FIELD_COUNT; field++) {
+        if (field_timeout_ms[field] == 0) {
+            atomic_store(&received_ms[field], now_ms);
+        } else if (expired & DV8_FIELD_BIT(field)) {
+            // Due right now, so only a receipt after this revives it; not in the wheel meanwhile
+            atomic_store(&received_ms[field], now_ms - field_timeout_ms[field]);
+            atomic_fetch_or(&stale_fields, DV8_FIELD_BIT(field));
+        } else {
+            atomic_store(&received_ms[field], now_ms);
+            wheel_insert(field, now_ms + field_timeout_ms[field]);
+        }
+    }
+}
+
+uint32_t dv8_stale_touch(uint32_t fields, int64_t received_us)
+{
+    uint32_t now_ms = to_ms(received_us);
+
+    for (int field = 0; field < DV8_FIELD_COUNT; field++) {
+        if (fields & DV8_FIELD_BIT(field)) {
+            atomic_store(&received_ms[field], now_ms);
+        }
+    }
+    // Pairs with dv8_stale_expire() setting the bit before its last look at received_ms: either
+    // it sees this receipt, or this load sees its bit
+    return atomic_load(&stale_fields) & fields;
+}
+
+uint32_t dv8_stale_expire(int64_t now_us)
+{
+    uint32_t now_ms = to_ms(now_us);
+    uint32_t expired = 0;
+
+    // Visit every slot whose start has passed, but each at most once per call
+    for (unsigned n = 0; n < STALE_WHEEL_SLOTS && !after(wheel_time_ms, now_ms); n++) {
+        unsigned slot = (wheel_time_ms / DV8_STALE_TICK_MS) % STALE_WHEEL_SLOTS;
+        int8_t field = wheel_slots[slot];
+        wheel_slots[slot] = STALE_NONE;
+        wheel_time_ms += DV8_STALE_TICK_MS;
+
+        while (field != STALE_NONE) {
+            int8_t next = wheel_next[field];
+            uint32_t deadline_ms = atomic_load(&received_ms[field]) + field_timeout_ms[field];
+
+            if (after(wheel_deadline_ms[field], now_ms) || after(deadline_ms, now_ms)) {
+                // A later turn of the wheel, or received again since it was scheduled
+                wheel_insert(field, after(deadline_ms, wheel_deadline_ms[field]) ? deadline_ms : wheel_deadline_ms[field]);
+            } else {
+                atomic_fetch_or(&stale_fields, DV8_FIELD_BIT(field));
+                deadline_ms = atomic_load(&received_ms[field]) + field_timeout_ms[field];
+                if (after(deadline_ms, now_ms)) {
+                    // Lost the race against dv8_stale_touch(), keep tracking it
+                    atomic_fetch_and(&stale_fields, ~DV8_FIELD_BIT(field));
+                    wheel_insert(field, deadline_ms);
+                } else {
+                    expired |= DV8_FIELD_BIT(field);
+                }
+            }
+            field = next;
+        }
+    }
+
+    // Idle for more than a whole turn: everything due has been seen, catch up
+    if (!after(wheel_time_ms, now_ms)) {
+        wheel_time_ms = now_ms - now_ms % DV8_STALE_TICK_MS + DV8_STALE_TICK_MS;
+    }
+    return expired;
+}
+
+uint32_t dv8_stale_revive(int64_t now_us)
+{
+    uint32_t now_ms = to_ms(now_us);
+    uint32_t stale = atomic_load(&stale_fields);
+    uint32_t revived = 0;
+
+    for (int field = 0; stale != 0 && field < DV8_FIELD_COUNT; field++) {
+        if ((stale & DV8_FIELD_BIT(field)) == 0) {
+            continue;
+        }
+        uint32_t deadline_ms = atomic_load(&received_ms[field]) + field_timeout_ms[field];
+        if (after(deadline_ms, now_ms)) {
+            atomic_fetch_and(&stale_fields, ~DV8_FIELD_BIT(field));
+            wheel_insert(field, deadline_ms);
+            revived |= DV8_FIELD_BIT(field);
+        }
+    }
+    return revived;
+}
+
+int32_t dv8_stale_next_ms(int64_t now_us)
+{
+    uint32_t now_ms = to_ms(now_us);
+
+    // Slots are visited in order from wheel_time_ms, the first one holding anything is the next
+    for (unsigned n = 0; n < STALE_WHEEL_SLOTS; n++) {
+        uint32_t slot_ms = wheel_time_ms + n * DV8_STALE_TICK_MS;
+        int8_t field = wheel_slots[(slot_ms / DV8_STALE_TICK_MS) % STALE_WHEEL_SLOTS];
+        if (field == STALE_NONE) {
+            continue;
+        }
+
+        // Visiting the slot at its start would only move a deadline later in it to the next
+        // slot, so wait for the earliest one. Deadlines of a later turn are moved on at the start.
+        uint32_t due_ms = slot_ms + DV8_STALE_TICK_MS;
+        for (; field != STALE_NONE; field = wheel_next[field]) {
+            uint32_t deadline_ms = wheel_deadline_ms[field];
+            bool in_slot = after(deadline_ms, slot_ms) && after(slot_ms + DV8_STALE_TICK_MS, deadline_ms);
+            uint32_t field_due_ms = in_slot ? deadline_ms : slot_ms;
+            if (after(due_ms, field_due_ms)) {
+                due_ms = field_due_ms;
+            }
+        }
+        return after(due_ms, now_ms) ? (int32_t)(due_ms - now_ms) : 0;
+    }
+    return -1;
+}
+
+uint32_t dv8_stale_fields(void)
+{
+    return atomic_load(&stale_fields);
+}
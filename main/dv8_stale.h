@@ -0,0 +1,39 @@
+#ifndef DV8_STALE_H
+#define DV8_STALE_H
+
+#include <stdint.h>
+#include "dv8_state.h"
+
+/*
+ * Per-field staleness: a field that hasn't been received for its timeout (dv8_stale.c, from
+ * Kconfig) expires until the next message carrying it. Fields with a timeout of 0 never do.
+ *
+ * The MQTT task only stamps receipts (dv8_stale_touch). Deadlines live in a hashed timer wheel
+ * owned by the LVGL side, which dv8_stale_expire() advances from one lv_timer: it only visits the
+ * entries that are due, so a tick costs O(expired), not O(fields). An entry that was refreshed in
+ * the meantime is simply moved to its new slot. The timer sleeps until the next slot holding a
+ * deadline (dv8_stale_next_ms), not DV8_STALE_TICK_MS at a time, and not at all while nothing is
+ * tracked.
+ *
+ * Times are esp_timer_get_time() microseconds on the panel, any monotonic clock on the host.
+ */
+
+#define DV8_STALE_TICK_MS 250
+
+// LVGL side, before anything else: every tracked field counts as received at `now_us`, except
+// the `expired` ones, which start out expired until their first receipt (values from a cache)
+extern void dv8_stale_init(int64_t now_us, uint32_t expired);
+// MQTT task: the fields a message carried arrived at `received_us`. Returns the ones among them
+// that are currently expired, so the caller can wake the UI even if no value changed.
+extern uint32_t dv8_stale_touch(uint32_t fields, int64_t received_us);
+// LVGL side: advance the wheel, returns the fields that expired since the last call
+extern uint32_t dv8_stale_expire(int64_t now_us);
+// LVGL side: expired fields that have been received again, they are tracked again from here on
+extern uint32_t dv8_stale_revive(int64_t now_us);
+// LVGL side: ms until dv8_stale_expire() has a deadline to look at, -1 while no field is tracked.
+// Changes after dv8_stale_init(), dv8_stale_expire() and a dv8_stale_revive() that revived any.
+extern int32_t dv8_stale_next_ms(int64_t now_us);
+// Currently expired fields, from any task
+extern uint32_t dv8_stale_fields(void);
+
+#endif
@@ -0,0 +1,84 @@
+#include <stddef.h>
+#include "dv8_state.h"
+#include "dv8_seqlock.h"
+
+#define DV8_FIELD_INFO(member, value_type) \
+    { #member, offsetof(dv8_robot_state_t, member), value_type }
+
+const dv8_field_info_t dv8_field_info[DV8_FIELD_COUNT] = {
+    [DV8_FIELD_LINEAR_X]            = DV8_FIELD_INFO(linear_x, DV8_VALUE_FLOAT),
+    [DV8_FIELD_ANGULAR_Z]           = DV8_FIELD_INFO(angular_z, DV8_VALUE_FLOAT),
+    [DV8_FIELD_BATTERY_PERCENTAGE]  = DV8_FIELD_INFO(battery_percentage, DV8_VALUE_FLOAT),
+    [DV8_FIELD_BRUSH_SPEED]         = DV8_FIELD_INFO(brush_speed, DV8_VALUE_INT),
+    [DV8_FIELD_BATTERY_IS_CHARGING] = DV8_FIELD_INFO(battery_is_charging, DV8_VALUE_INT),
+    [DV8_FIELD_E_STOP]              = DV8_FIELD_INFO(e_stop, DV8_VALUE_INT),
+    [DV8_FIELD_HANDBRAKE]           = DV8_FIELD_INFO(handbrake, DV8_VALUE_INT),
+    [DV8_FIELD_DIRECT_STATUS]       = DV8_FIELD_INFO(direct_status, DV8_VALUE_INT),
+    [DV8_FIELD_ROBOT_MODE]          = DV8_FIELD_INFO(robot_mode, DV8_VALUE_INT),
+    [DV8_FIELD_SAFETY_MODE]         = DV8_FIELD_INFO(safety_mode, DV8_VALUE_INT),
+};
+
+// Guards state_buf, dv8_state_publish() is its writer
+static dv8_seqlock_t state_seq;
+static dv8_robot_state_t state_buf;
+
+
+bool dv8_state_publish(const dv8_robot_state_t *state)
+{
+    // Only the writer modifies state_buf, so it can compare against it without the seqlock
+    if (dv8_state_diff(&state_buf, state) == 0) {
+        return false;
+    }
+
+    uint32_t version = dv8_seqlock_write_begin(&state_seq);
+    state_buf = *state;
+    state_buf.version = version;
+    dv8_seqlock_write_end(&state_seq);
+    return true;
+}
+
+uint32_t dv8_state_read(dv8_robot_state_t *out)
+{
+    uint32_t seq;
+
+    do {
+        seq = dv8_seqlock_read_begin(&state_seq);
+        *out = state_buf;
+    } while (dv8_seqlock_read_retry(&state_seq, seq));
+    return out->version;
+}
+
+double dv8_state_get_field(const dv8_robot_state_t *state, dv8_field_t field)
+{
+    const dv8_field_info_t *info = &dv8_field_info[field];
+    const char *member = (const char *)state + info->offset;
+
+    if (info->type == DV8_VALUE_FLOAT) {
+        return *(const float *)member;
+    }
+    return *(const int *)member;
+}
+
+void dv8_state_set_field(dv8_robot_state_t *state, dv8_field_t field, double value)
+{
+    const dv8_field_info_t *info = &dv8_field_info[field];
+    char *member = (char *)state + info->offset;
+
+    if (info->type == DV8_VALUE_FLOAT) {
+        *(float *)member = value;
+    } else {
+        *(int *)member = value;
+    }
+}
+
+uint32_t dv8_state_diff(const dv8_robot_state_t *a, const dv8_robot_state_t *b)
+{
+    uint32_t changed = 0;
+
+    for (int field = 0; field < DV8_FIELD_COUNT; field++) {
+        if (dv8_state_get_field(a, field) != dv8_state_get_field(b, field)) {
+            changed |= DV8_FIELD_BIT(field);
+        }
+    }
+    return changed;
+}
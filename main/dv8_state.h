@@ -0,0 +1,71 @@
+#ifndef DV8_STATE_H
+#define DV8_STATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// One bit per robot state field, see dv8_state_diff()
+typedef enum {
+    DV8_FIELD_LINEAR_X = 0,
+    DV8_FIELD_ANGULAR_Z,
+    DV8_FIELD_BATTERY_PERCENTAGE,
+    DV8_FIELD_BRUSH_SPEED,
+    DV8_FIELD_BATTERY_IS_CHARGING,
+    DV8_FIELD_E_STOP,
+    DV8_FIELD_HANDBRAKE,
+    DV8_FIELD_DIRECT_STATUS,
+    DV8_FIELD_ROBOT_MODE,
+    DV8_FIELD_SAFETY_MODE,
+    DV8_FIELD_COUNT
+} dv8_field_t;
+
+#define DV8_FIELD_BIT(field) (1UL << (field))
+
+// Last known state of the robot, as reported over MQTT
+typedef struct {
+    uint32_t version;       // bumped on every publish that changed a field
+    float linear_x;
+    float angular_z;
+    float battery_percentage;
+    int brush_speed;
+    int battery_is_charging;
+    int e_stop;
+    int handbrake;
+    int direct_status;      // 0 or 1 for autonomous
+    int robot_mode;         // 1-Idle, 2-Coverage, 3-Litter Picking, 4-Switching
+    int safety_mode;
+    // esp_timer_get_time() of the message that last changed each field, not part of the diff
+    int64_t changed_us[DV8_FIELD_COUNT];
+} dv8_robot_state_t;
+
+typedef enum {
+    DV8_VALUE_FLOAT,
+    DV8_VALUE_INT,
+} dv8_value_type_t;
+
+// Where each field lives in dv8_robot_state_t; `name` is also its JSON key
+typedef struct {
+    const char *name;
+    uint16_t offset;
+    dv8_value_type_t type;
+} dv8_field_info_t;
+
+extern const dv8_field_info_t dv8_field_info[DV8_FIELD_COUNT];
+
+/*
+ * The shared snapshot is guarded by a seqlock (dv8_seqlock.h): there is a single writer (the
+ * MQTT task) and any number of readers that never block it. A reader retries while a publish is
+ * in progress, so on a single core it must not run at a higher priority than the writer.
+ */
+
+// Copy `state` into the shared snapshot if any field differs. Returns true if it was published.
+extern bool dv8_state_publish(const dv8_robot_state_t *state);
+// Take a consistent copy of the shared snapshot and return its version
+extern uint32_t dv8_state_read(dv8_robot_state_t *out);
+// Read or write one field by id, converting to/from double like cJSON_GetNumberValue()
+extern double dv8_state_get_field(const dv8_robot_state_t *state, dv8_field_t field);
+extern void dv8_state_set_field(dv8_robot_state_t *state, dv8_field_t field, double value);
+// Returns the DV8_FIELD_BIT mask of fields that differ between `a` and `b`, version excluded
+extern uint32_t dv8_state_diff(const dv8_robot_state_t *a, const dv8_robot_state_t *b);
+
+#endif
@@ -0,0 +1,136 @@
+#include "sdkconfig.h"
+#if CONFIG_DV8_STATE_CACHE
+
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "nvs.h"
+#include "dv8_state_cache.h"
+
+#define CACHE_NAMESPACE     "dv8"
+#define CACHE_KEY           "last_state"
+#define CACHE_FORMAT        1
+
+// Below the MQTT task: dv8_state_read() spins while the writer is in the middle of a publish, and
+// must never preempt it on the single core. Low enough that the flash write waits for the UI.
+#define CACHE_TASK_PRIORITY     1
+#define CACHE_TASK_STACK_SIZE   (3 * 1024)
+
+static const char *TAG = "dv8_state_cache";
+
+// Stored by value per field, so reordering dv8_robot_state_t doesn't invalidate old caches
+typedef struct {
+    uint8_t format;         // CACHE_FORMAT
+    uint8_t field_count;    // DV8_FIELD_COUNT when written
+    uint16_t fields;        // DV8_FIELD_BIT mask of the valid values
+    float values[DV8_FIELD_COUNT];
+} cache_record_t;
+
+// Cache task only, after dv8_state_cache_start()
+static cache_record_t saved;
+static cache_record_t pending;
+static bool pending_valid = false;
+static uint32_t writes = 0;
+
+
+// Fields the robot has sent since boot, plus whatever came from the cache, never the defaults of
+// fields nobody reported
+static void record_from_state(const dv8_robot_state_t *state, cache_record_t *record)
+{
+    memset(record, 0, sizeof(*record));
+    record->format = CACHE_FORMAT;
+    record->field_count = DV8_FIELD_COUNT;
+    record->fields = saved.fields;
+    for (int field = 0; field < DV8_FIELD_COUNT; field++) {
+        if (state->changed_us[field] != 0) {
+            record->fields |= DV8_FIELD_BIT(field);
+        }
+    }
+    record->fields &= DV8_STATE_CACHE_FIELDS;
+
+    for (int field = 0; field < DV8_FIELD_COUNT; field++) {
+        if (record->fields & DV8_FIELD_BIT(field)) {
+            float value = (float)dv8_state_get_field(state, field);
+            // Whole percent, tenths would make a draining battery a change every period
+            record->values[field] = field == DV8_FIELD_BATTERY_PERCENTAGE ? roundf(value) : value;
+        }
+    }
+}
+
+uint32_t dv8_state_cache_load(dv8_robot_state_t *state)
+{
+    nvs_handle_t nvs;
+    if (nvs_open(CACHE_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return 0;
+    }
+    size_t len = sizeof(saved);
+    esp_err_t err = nvs_get_blob(nvs, CACHE_KEY, &saved, &len);
+    nvs_close(nvs);
+
+    if (err != ESP_OK || len != sizeof(saved) || saved.format != CACHE_FORMAT || saved.field_count != DV8_FIELD_COUNT) {
+        memset(&saved, 0, sizeof(saved));
+        return 0;
+    }
+    uint32_t fields = saved.fields & DV8_STATE_CACHE_FIELDS;
+    for (int field = 0; field < DV8_FIELD_COUNT; field++) {
+        if (fields & DV8_FIELD_BIT(field)) {
+            dv8_state_set_field(state, field, saved.values[field]);
+        }
+    }
+    return fields;
+}
+
+static void save_if_settled(void)
+{
+    dv8_robot_state_t state;
+    cache_record_t current;
+    dv8_state_read(&state);
+    record_from_state(&state, &current);
+
+    // Wait for the state to settle for a period, then write it once
+    bool settled = pending_valid && memcmp(&current, &pending, sizeof(current)) == 0;
+    pending = current;
+    pending_valid = true;
+    if (!settled || current.fields == 0 || memcmp(&current, &saved, sizeof(current)) == 0) {
+        return;
+    }
+
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(CACHE_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(nvs, CACHE_KEY, &current, sizeof(current));
+        if (err == ESP_OK) {
+            err = nvs_commit(nvs);
+        }
+        nvs_close(nvs);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "saving the robot state failed: %s", esp_err_to_name(err));
+        return;
+    }
+    saved = current;
+    writes++;
+}
+
+static void cache_task(void *arg)
+{
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_DV8_STATE_CACHE_PERIOD_MS));
+        save_if_settled();
+    }
+}
+
+void dv8_state_cache_start(void)
+{
+    xTaskCreate(cache_task, "dv8_state_cache", CACHE_TASK_STACK_SIZE, NULL, CACHE_TASK_PRIORITY, NULL);
+}
+
+uint32_t dv8_state_cache_writes(void)
+{
+    return writes;
+}
+
+#endif /* CONFIG_DV8_STATE_CACHE */
@@ -0,0 +1,34 @@
+#ifndef DV8_STATE_CACHE_H
+#define DV8_STATE_CACHE_H
+
+#include <stdint.h>
+#include "dv8_state.h"
+
+/*
+ * Last known robot state in NVS (CONFIG_DV8_STATE_CACHE), so the panel has something to show
+ * at boot before Wi-Fi and MQTT are up.
+ *
+ * Only the fields the status page shows are kept, see DV8_STATE_CACHE_FIELDS. Saving is batched
+ * on a low-priority task of its own, below the MQTT task that writes dv8_state and off the
+ * esp_timer task, every CONFIG_DV8_STATE_CACHE_PERIOD_MS: a snapshot is written only when it
+ * differs from the saved one and has stayed the same for a whole period, with the battery level
+ * compared in whole percent. Bursts of changes and a slowly draining battery thus cost one write
+ * at most per period, and a robot that sits still costs none.
+ *
+ * Needs nvs_flash_init().
+ */
+
+#define DV8_STATE_CACHE_FIELDS (DV8_FIELD_BIT(DV8_FIELD_BATTERY_PERCENTAGE) | DV8_FIELD_BIT(DV8_FIELD_BATTERY_IS_CHARGING) | \
+                                DV8_FIELD_BIT(DV8_FIELD_E_STOP) | DV8_FIELD_BIT(DV8_FIELD_HANDBRAKE) | \
+                                DV8_FIELD_BIT(DV8_FIELD_DIRECT_STATUS) | DV8_FIELD_BIT(DV8_FIELD_ROBOT_MODE) | \
+                                DV8_FIELD_BIT(DV8_FIELD_SAFETY_MODE))
+
+// Fill the cached fields of `state`, leaving the others alone. Returns their DV8_FIELD_BIT mask,
+// 0 if nothing was cached.
+extern uint32_t dv8_state_cache_load(dv8_robot_state_t *state);
+// Start saving the dv8_state snapshot
+extern void dv8_state_cache_start(void);
+// NVS writes since boot
+extern uint32_t dv8_state_cache_writes(void);
+
+#endif
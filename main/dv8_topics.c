@@ -0,0 +1,125 @@
+#include <assert.h>
+#include <string.h>
+#include "dv8_topics.h"
+
+#define DV8_TOPIC(name, field_mask) { name, sizeof(name) - 1, field_mask }
+
+const dv8_topic_t dv8_topics[] = {
+    DV8_TOPIC(DV8_TOPIC_PREFIX "/control/cmd_vel", DV8_FIELD_BIT(DV8_FIELD_LINEAR_X) | DV8_FIELD_BIT(DV8_FIELD_ANGULAR_Z)),
+    DV8_TOPIC(DV8_TOPIC_PREFIX "/state/battery_percentage", DV8_FIELD_BIT(DV8_FIELD_BATTERY_PERCENTAGE)),
+    DV8_TOPIC(DV8_TOPIC_PREFIX "/state/battery_is_charging", DV8_FIELD_BIT(DV8_FIELD_BATTERY_IS_CHARGING)),
+    DV8_TOPIC(DV8_TOPIC_PREFIX "/state/e_stop", DV8_FIELD_BIT(DV8_FIELD_E_STOP)),
+    DV8_TOPIC(DV8_TOPIC_PREFIX "/state/handbrake", DV8_FIELD_BIT(DV8_FIELD_HANDBRAKE)),
+    DV8_TOPIC(DV8_TOPIC_PREFIX "/state/direct_status", DV8_FIELD_BIT(DV8_FIELD_DIRECT_STATUS)),
+    DV8_TOPIC(DV8_TOPIC_PREFIX "/state/robot_mode", DV8_FIELD_BIT(DV8_FIELD_ROBOT_MODE)),
+    DV8_TOPIC(DV8_TOPIC_PREFIX "/control/brush_speed", DV8_FIELD_BIT(DV8_FIELD_BRUSH_SPEED)),
+    DV8_TOPIC(DV8_TOPIC_PREFIX "/state/safety_mode", DV8_FIELD_BIT(DV8_FIELD_SAFETY_MODE)),
+};
+
+const size_t dv8_topic_count = sizeof(dv8_topics) / sizeof(dv8_topics[0]);
+
+/*
+ * Prefix trie over the '/'-separated segments of dv8_topics, compiled once by dv8_topics_init().
+ * The children of a node sit next to each other in trie_nodes, so resolving a topic is one short
+ * scan per segment and a topic that leaves the tree is dropped at the first unknown segment.
+ */
+#define DV8_TRIE_MAX_NODES 32
+
+typedef struct {
+    const char *segment;    // points into the dv8_topics string
+    uint8_t segment_len;
+    uint8_t first_child;    // index into trie_nodes, 0 = leaf (the root is never a child)
+    uint8_t child_count;
+    uint8_t topic;          // dv8_topics index + 1, 0 = not a topic on its own
+} trie_node_t;
+
+static trie_node_t trie_nodes[DV8_TRIE_MAX_NODES];
+static uint8_t trie_node_count;
+
+// Length of the segment starting at `topic`, up to the next '/' or `end`
+static size_t segment_length(const char *topic, const char *end)
+{
+    const char *slash = memchr(topic, '/', end - topic);
+    return (slash != NULL ? slash : end) - topic;
+}
+
+static const trie_node_t *find_child(const trie_node_t *node, const char *segment, size_t segment_len)
+{
+    const trie_node_t *child = &trie_nodes[node->first_child];
+    for (uint8_t i = 0; i < node->child_count; i++, child++) {
+        if (child->segment_len == segment_len && memcmp(child->segment, segment, segment_len) == 0) {
+            return child;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * All children of a node are appended as one block before recursing into them. A topic ending in
+ * the middle of another one (a/b next to a/b/c) just gets its index on the inner node.
+ */
+static void build_children(uint8_t node_index, size_t depth)
+{
+    trie_nodes[node_index].first_child = trie_node_count;
+
+    for (size_t i = 0; i < dv8_topic_count; i++) {
+        const char *pos = dv8_topics[i].topic;
+        const char *end = pos + dv8_topics[i].topic_len;
+
+        // Walk down to this node's depth, only topics sharing its path contribute children
+        const trie_node_t *node = &trie_nodes[0];
+        size_t d = 0;
+        while (d < depth && node != NULL && pos <= end) {
+            size_t len = segment_length(pos, end);
+            node = find_child(node, pos, len);
+            pos += len + 1;
+            d++;
+        }
+        if (node != &trie_nodes[node_index] || pos > end) {
+            continue;
+        }
+
+        size_t len = segment_length(pos, end);
+        trie_node_t *child = (trie_node_t *)find_child(node, pos, len);
+        if (child == NULL) {
+            assert(trie_node_count < DV8_TRIE_MAX_NODES);
+            child = &trie_nodes[trie_node_count++];
+            *child = (trie_node_t) { .segment = pos, .segment_len = len };
+            trie_nodes[node_index].child_count++;
+        }
+        if (pos + len == end) {
+            child->topic = i + 1;
+        }
+    }
+
+    uint8_t first = trie_nodes[node_index].first_child;
+    uint8_t count = trie_nodes[node_index].child_count;
+    for (uint8_t i = 0; i < count; i++) {
+        build_children(first + i, depth + 1);
+    }
+}
+void dv8_topics_init(void)
+{
+    memset(trie_nodes, 0, sizeof(trie_nodes));
+    trie_node_count = 1;
+    build_children(0, 0);
+}
+
+const dv8_topic_t *dv8_topic_lookup(const char *topic, size_t topic_len)
+{
+    const char *end = topic + topic_len;
+    const trie_node_t *node = &trie_nodes[0];
+
+    while (1) {
+        size_t len = segment_length(topic, end);
+        node = find_child(node, topic, len);
+        if (node == NULL) {
+            return NULL;
+        }
+        topic += len;
+        if (topic == end) {
+            return node->topic != 0 ? &dv8_topics[node->topic - 1] : NULL;
+        }
+        topic++;    // the '/'
+    }
+}
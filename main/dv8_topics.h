@@ -0,0 +1,27 @@
+#ifndef DV8_TOPICS_H
+#define DV8_TOPICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "dv8_state.h"
+
+// Every DV8 topic lives under this prefix, the client subscribes to DV8_TOPIC_PREFIX "/#"
+#define DV8_TOPIC_PREFIX CONFIG_DV8_TOPIC_PREFIX
+
+// One subscribed MQTT topic and the state fields its JSON payload carries
+typedef struct {
+    const char *topic;
+    uint8_t topic_len;
+    uint32_t fields;        // DV8_FIELD_BIT mask
+} dv8_topic_t;
+
+extern const dv8_topic_t dv8_topics[];
+extern const size_t dv8_topic_count;
+
+// Compile the topic trie, must be called once before dv8_topic_lookup()
+extern void dv8_topics_init(void);
+// Resolve a topic that is not NUL-terminated in O(segments), returns NULL for topics we don't handle
+extern const dv8_topic_t *dv8_topic_lookup(const char *topic, size_t topic_len);
+
+#endif
@@ -0,0 +1,311 @@
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include "dv8_touch.h"
+
+// STMPE610 registers and bits, as in esp_lcd_touch_stmpe610.c
+#define STMPE_REG_CHIP_ID       0x00
+#define STMPE_REG_SYS_CTRL1     0x03
+#define STMPE_REG_SYS_CTRL2     0x04
+#define STMPE_REG_INT_CTRL      0x09
+#define STMPE_REG_INT_EN        0x0A
+#define STMPE_REG_INT_STA       0x0B
+#define STMPE_REG_ADC_CTRL1     0x20
+#define STMPE_REG_ADC_CTRL2     0x21
+#define STMPE_REG_TSC_CTRL      0x40
+#define STMPE_REG_TSC_CFG       0x41
+#define STMPE_REG_FIFO_TH       0x4A
+#define STMPE_REG_FIFO_STA      0x4B
+#define STMPE_REG_FIFO_SIZE     0x4C
+#define STMPE_REG_TSC_FRACTION_Z 0x56
+#define STMPE_REG_TSC_DATA      0x57
+#define STMPE_REG_TSC_I_DRIVE   0x58
+
+#define STMPE_CHIP_ID           0x0811
+#define STMPE_SYS_CTRL1_RESET   0x02
+#define STMPE_INT_TOUCH_DET     0x01
+#define STMPE_INT_FIFO_TH       0x02
+#define STMPE_INT_CTRL_EDGE     0x02    // edge triggered, polarity bit clear is active low
+#define STMPE_INT_CTRL_ENABLE   0x01
+#define STMPE_TSC_CTRL_EN       0x01    // XYZ
+#define STMPE_TSC_CTRL_STA      0x80    // touch currently detected
+#define STMPE_FIFO_STA_RESET    0x01
+
+// Interrupt passes per service: a status bit raised while the last one ran has no edge of its own
+#define TOUCH_SERVICE_PASSES    4
+
+// Two first samples this close (raw counts, per axis) place the press; otherwise it waits for
+// the third and the median. A single sample can't be told from a spike.
+#define TOUCH_PRESS_AGREE       48
+
+// Raw ADC range of the panel, the same the vendored driver maps from
+#define TOUCH_RAW_MIN           150
+#define TOUCH_RAW_MAX           3800
+
+#define TOUCH_QUEUE_MASK        (DV8_TOUCH_QUEUE_SIZE - 1)
+
+_Static_assert((DV8_TOUCH_QUEUE_SIZE & TOUCH_QUEUE_MASK) == 0, "DV8_TOUCH_QUEUE_SIZE must be a power of two");
+
+// Latest state as one word, so the LVGL task never sees half of it: x | y << 12 | pressed << 31
+#define PACK(x, y, pressed)     ((uint32_t)(x) | (uint32_t)(y) << 12 | (uint32_t)(pressed) << 31)
+
+static dv8_touch_bus_t bus;
+static int64_t (*clock_now_us)(void);
+static uint16_t res_x, res_y;
+
+// Touch task only
+static bool pressed;
+static uint16_t window_x[3], window_y[3];
+static unsigned window_len;
+static int32_t filter_x, filter_y;      // raw, Q4
+static uint16_t last_x, last_y;         // pixel of the last queued event
+
+// Single producer (touch task), single consumer (LVGL task)
+static dv8_touch_event_t queue[DV8_TOUCH_QUEUE_SIZE];
+static _Atomic(uint32_t) queue_head;
+static _Atomic(uint32_t) queue_tail;
+static _Atomic(uint32_t) latest;
+
+static dv8_touch_stats_t stats;
+
+
+// Between bus_begin() and bus_end()
+static bool holding;
+static int64_t hold_start_us;
+
+static void bus_begin(void)
+{
+    hold_start_us = clock_now_us();
+    if (bus.begin != NULL) {
+        bus.begin(bus.ctx);
+    }
+    holding = true;
+}
+
+static void bus_end(void)
+{
+    holding = false;
+    if (bus.end != NULL) {
+        bus.end(bus.ctx);
+    }
+    stats.bus_us += (uint32_t)(clock_now_us() - hold_start_us);
+}
+
+// Let a waiting LCD stripe go ahead of the rest of the burst, so it waits one transaction at most
+static void bus_yield(void)
+{
+    if (holding && bus.contended != NULL && bus.contended(bus.ctx)) {
+        bus_end();
+        bus_begin();
+        stats.yields++;
+    }
+}
+
+static bool reg_read(uint8_t reg, uint8_t *value)
+{
+    bus_yield();
+    stats.transactions++;
+    return bus.read(bus.ctx, reg, value) == 0;
+}
+
+static bool reg_write(uint8_t reg, uint8_t value)
+{
+    bus_yield();
+    stats.transactions++;
+    return bus.write(bus.ctx, reg, value) == 0;
+}
+
+static uint16_t median3(const uint16_t v[3])
+{
+    uint16_t lo = v[0] < v[1] ? v[0] : v[1];
+    uint16_t hi = v[0] < v[1] ? v[1] : v[0];
+    return v[2] < lo ? lo : v[2] > hi ? hi : v[2];
+}
+
+static void filter_reset(void)
+{
+    window_len = 0;
+}
+
+static void filter_add(uint16_t raw_x, uint16_t raw_y)
+{
+    window_x[window_len % 3] = raw_x;
+    window_y[window_len % 3] = raw_y;
+    window_len++;
+
+    // Until the window is full there is nothing to take the median of, nor to smooth
+    int32_t x = (window_len >= 3 ? median3(window_x) : raw_x) << 4;
+    int32_t y = (window_len >= 3 ? median3(window_y) : raw_y) << 4;
+    if (window_len <= 3) {
+        filter_x = x;
+        filter_y = y;
+    } else {
+        filter_x += (x - filter_x) / 2;
+        filter_y += (y - filter_y) / 2;
+    }
+}
+
+static bool filter_settled(void)
+{
+    return window_len >= 3 ||
+           (window_len == 2 && abs(window_x[0] - window_x[1]) <= TOUCH_PRESS_AGREE &&
+            abs(window_y[0] - window_y[1]) <= TOUCH_PRESS_AGREE);
+}
+
+static uint16_t to_pixels(int32_t raw_q4, uint16_t res)
+{
+    int32_t min = TOUCH_RAW_MIN << 4, max = TOUCH_RAW_MAX << 4;
+    raw_q4 = raw_q4 < min ? min : raw_q4 > max ? max : raw_q4;
+    return (uint16_t)((raw_q4 - min) * (res - 1) / (max - min));
+}
+
+static bool queue_event(uint16_t x, uint16_t y, bool down, int64_t irq_us)
+{
+    atomic_store_explicit(&latest, PACK(x, y, down), memory_order_release);
+    last_x = x;
+    last_y = y;
+
+    uint32_t head = atomic_load_explicit(&queue_head, memory_order_relaxed);
+    if (head - atomic_load_explicit(&queue_tail, memory_order_acquire) == DV8_TOUCH_QUEUE_SIZE) {
+        stats.overflows++;
+        return false;
+    }
+    queue[head & TOUCH_QUEUE_MASK] = (dv8_touch_event_t) { .x = x, .y = y, .pressed = down, .irq_us = irq_us };
+    atomic_store_explicit(&queue_head, head + 1, memory_order_release);
+    stats.events++;
+    return true;
+}
+
+void dv8_touch_init(const dv8_touch_bus_t *touch_bus, uint16_t h_res, uint16_t v_res, int64_t (*now_us)(void))
+{
+    bus = *touch_bus;
+    res_x = h_res;
+    res_y = v_res;
+    clock_now_us = now_us;
+}
+
+bool dv8_touch_configure(void)
+{
+    uint8_t id_hi = 0, id_lo = 0;
+    bus_begin();
+    bool ok = reg_write(STMPE_REG_SYS_CTRL1, STMPE_SYS_CTRL1_RESET) &&
+              reg_write(STMPE_REG_SYS_CTRL2, 0x00) &&                      // all clocks on
+              reg_write(STMPE_REG_TSC_CTRL, STMPE_TSC_CTRL_EN) &&
+              reg_write(STMPE_REG_INT_EN, STMPE_INT_TOUCH_DET | STMPE_INT_FIFO_TH) &&
+              reg_write(STMPE_REG_ADC_CTRL1, 0x6 << 4) &&                  // 10 bit, 96 clocks per conversion
+              reg_write(STMPE_REG_ADC_CTRL2, 0x02) &&                      // 6.5 MHz
+              reg_write(STMPE_REG_TSC_CFG, 0x80 | 0x20 | 0x04) &&          // 4 sample average, 1 ms delay, 5 ms settle
+              reg_write(STMPE_REG_TSC_FRACTION_Z, 0x06) &&
+              reg_write(STMPE_REG_FIFO_TH, 1) &&
+              reg_write(STMPE_REG_FIFO_STA, STMPE_FIFO_STA_RESET) &&
+              reg_write(STMPE_REG_FIFO_STA, 0) &&
+              reg_write(STMPE_REG_TSC_I_DRIVE, 0x01) &&                    // 50 mA
+              reg_write(STMPE_REG_INT_STA, 0xFF) &&
+              reg_write(STMPE_REG_INT_CTRL, STMPE_INT_CTRL_EDGE | STMPE_INT_CTRL_ENABLE) &&
+              reg_read(STMPE_REG_CHIP_ID, &id_hi) && reg_read(STMPE_REG_CHIP_ID + 1, &id_lo);
+    bus_end();
+    return ok && (id_hi << 8 | id_lo) == STMPE_CHIP_ID;
+}
+
+// One pass over the interrupt status and the FIFO, bus held unless the LCD wants it. Returns false on a bus error, or
+// once INT_STA reads clear on a later pass.
+static bool service_pass(int64_t irq_us, bool first, bool *queued)
+{
+    uint8_t int_sta, tsc_ctrl, fifo_size;
+
+    // Clear first: a sample that comes in while the FIFO is drained sets it again
+    if (!reg_read(STMPE_REG_INT_STA, &int_sta) || (int_sta != 0 && !reg_write(STMPE_REG_INT_STA, int_sta))) {
+        return false;
+    }
+    if (int_sta == 0 && !first) {
+        return false;
+    }
+    if (!reg_read(STMPE_REG_TSC_CTRL, &tsc_ctrl) || !reg_read(STMPE_REG_FIFO_SIZE, &fifo_size)) {
+        return false;
+    }
+    bool down = tsc_ctrl & STMPE_TSC_CTRL_STA;
+
+    if (fifo_size > DV8_TOUCH_MAX_BACKLOG) {
+        reg_write(STMPE_REG_FIFO_STA, STMPE_FIFO_STA_RESET);
+        reg_write(STMPE_REG_FIFO_STA, 0);
+        stats.discarded += fifo_size;
+        fifo_size = 0;
+    }
+    for (unsigned i = 0; i < fifo_size; i++) {
+        // One byte per transaction, a longer read of the data register returns garbage
+        uint8_t buf[4];
+        for (unsigned b = 0; b < sizeof(buf); b++) {
+            if (!reg_read(STMPE_REG_TSC_DATA, &buf[b])) {
+                return false;
+            }
+        }
+        stats.samples++;
+        filter_add((uint16_t)(buf[0] << 4 | buf[1] >> 4), (uint16_t)((buf[1] & 0x0F) << 8 | buf[2]));
+    }
+
+    uint16_t x = window_len > 0 ? to_pixels(filter_x, res_x) : last_x;
+    uint16_t y = window_len > 0 ? to_pixels(filter_y, res_y) : last_y;
+
+    if (!pressed && (filter_settled() || (!down && window_len > 0))) {
+        // A tap too quick to settle still presses, where it was
+        pressed = true;
+        *queued |= queue_event(x, y, true, irq_us);
+    } else if (pressed && down && (x != last_x || y != last_y)) {
+        *queued |= queue_event(x, y, true, irq_us);
+    }
+    if (pressed && !down) {
+        pressed = false;
+        *queued |= queue_event(x, y, false, irq_us);
+        filter_reset();
+    }
+    return true;
+}
+
+bool dv8_touch_service(int64_t irq_us)
+{
+    bool queued = false;
+
+    stats.irqs++;
+    bus_begin();
+    for (int pass = 0; pass < TOUCH_SERVICE_PASSES; pass++) {
+        if (!service_pass(irq_us, pass == 0, &queued)) {
+            break;
+        }
+    }
+    bus_end();
+    return queued;
+}
+
+bool dv8_touch_pressed(void)
+{
+    return pressed;
+}
+
+bool dv8_touch_pop(dv8_touch_event_t *out)
+{
+    uint32_t tail = atomic_load_explicit(&queue_tail, memory_order_relaxed);
+    if (tail == atomic_load_explicit(&queue_head, memory_order_acquire)) {
+        uint32_t state = atomic_load_explicit(&latest, memory_order_acquire);
+        *out = (dv8_touch_event_t) { .x = state & 0xFFF, .y = (state >> 12) & 0xFFF, .pressed = state >> 31 };
+        return false;
+    }
+    *out = queue[tail & TOUCH_QUEUE_MASK];
+    atomic_store_explicit(&queue_tail, tail + 1, memory_order_release);
+
+    uint32_t latency_us = (uint32_t)(clock_now_us() - out->irq_us);
+    if (latency_us > stats.max_latency_us) {
+        stats.max_latency_us = latency_us;
+    }
+    return true;
+}
+
+bool dv8_touch_pending(void)
+{
+    return atomic_load_explicit(&queue_tail, memory_order_relaxed) !=
+           atomic_load_explicit(&queue_head, memory_order_acquire);
+}
+
+void dv8_touch_get_stats(dv8_touch_stats_t *out)
+{
+    *out = stats;
+}
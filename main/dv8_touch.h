@@ -0,0 +1,81 @@
+#ifndef DV8_TOUCH_H
+#define DV8_TOUCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Interrupt-driven STMPE610 touch input, the part without ESP-IDF.
+ *
+ * The controller samples on its own and raises its interrupt on touch/release (TOUCH_DET) and
+ * whenever its FIFO holds a sample (FIFO_TH). The touch task then calls dv8_touch_service(),
+ * which clears the interrupt, drains the FIFO and queues press/move/release events for the
+ * LVGL task. Nothing touches the SPI bus while the panel is idle, unlike the polled
+ * esp_lcd_touch path that reads the FIFO status every LVGL input period.
+ *
+ * The bus is shared with the panel. The STMPE610 can't stream its data register, so a sample is
+ * four one-byte transactions; one at a time, each would wait for the LCD stripe on the wire,
+ * and an interrupt would take as long as a dozen stripes. The service holds the bus for its
+ * burst instead (bus.begin/end), but only while the LCD has nothing waiting: before each
+ * transaction it asks bus.contended, and if a stripe is queued it lets the stripe go and takes
+ * the bus back after it. A stripe waits for one touch transaction at most, as on the polled
+ * path; the burst waits for the stripes. A FIFO backlog deeper than DV8_TOUCH_MAX_BACKLOG means
+ * we came late; it is reset instead of read, and the next sample is a few ms away.
+ *
+ * Samples go through a median of 3 per axis, against single-sample spikes, and a 1/2 IIR
+ * in Q4 fixed point against jitter, reset on every press. The press waits for a second sample
+ * that agrees with the first, or for the third: it picks the object LVGL presses, and a spike
+ * there is a tap on the wrong button. Moves are only queued when the filtered point lands on
+ * another pixel.
+ */
+
+#define DV8_TOUCH_QUEUE_SIZE    8       // power of two
+#define DV8_TOUCH_MAX_BACKLOG   8       // FIFO samples worth reading over the bus
+
+// Register access over the panel bus, one byte, returns 0 on success. `reg` without the read bit.
+// begin/end, if set, hold the bus between them; contended, if set, says whether anyone else
+// (the LCD) is waiting for it, and the hold is given up for them in between transactions.
+typedef struct {
+    int (*read)(void *ctx, uint8_t reg, uint8_t *value);
+    int (*write)(void *ctx, uint8_t reg, uint8_t value);
+    void (*begin)(void *ctx);
+    void (*end)(void *ctx);
+    bool (*contended)(void *ctx);
+    void *ctx;
+} dv8_touch_bus_t;
+
+typedef struct {
+    uint16_t x, y;          // panel pixels, unrotated
+    bool pressed;
+    int64_t irq_us;         // interrupt this came from, 0 for dv8_touch_pop()'s latest state
+} dv8_touch_event_t;
+
+typedef struct {
+    uint32_t irqs;          // dv8_touch_service() calls
+    uint32_t samples;       // read from the FIFO
+    uint32_t discarded;     // FIFO backlog reset unread
+    uint32_t events;        // queued for LVGL
+    uint32_t overflows;     // queue full, the event only survives as the latest state
+    uint32_t transactions;  // register reads and writes
+    uint32_t yields;        // holds given up in the middle of a burst for the LCD
+    uint32_t bus_us;        // time the touch task held the bus, waiting for it included
+    uint32_t max_latency_us;    // interrupt to dv8_touch_pop()
+} dv8_touch_stats_t;
+
+// Before the first interrupt. Screen size in pixels, `now_us` a microsecond clock.
+extern void dv8_touch_init(const dv8_touch_bus_t *bus, uint16_t h_res, uint16_t v_res, int64_t (*now_us)(void));
+// Reset the controller and set it up like esp_lcd_touch_stmpe610 does, but interrupting on FIFO
+// samples as well as on touch/release. Returns false on a bus error or if it isn't an STMPE610.
+extern bool dv8_touch_configure(void);
+// Touch task, after the interrupt at `irq_us`. Returns true if events were queued.
+extern bool dv8_touch_service(int64_t irq_us);
+// Still held down as of the last dv8_touch_service()
+extern bool dv8_touch_pressed(void);
+
+// LVGL task: the oldest queued event. With nothing queued, returns false and the latest state.
+extern bool dv8_touch_pop(dv8_touch_event_t *out);
+extern bool dv8_touch_pending(void);
+// Counters, read without synchronisation like lvgl_get_update_stats()
+extern void dv8_touch_get_stats(dv8_touch_stats_t *out);
+
+#endif
@@ -0,0 +1,119 @@
+#include <string.h>
+#include "dv8_trace.h"
+#include "dv8_topics.h"
+
+
+static size_t put_varint(uint8_t *out, uint64_t value)
+{
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (uint8_t)value | 0x80;
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+static bool get_varint(dv8_trace_reader_t *reader, uint64_t *value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (reader->pos >= reader->len) {
+            return false;
+        }
+        uint8_t byte = reader->buf[reader->pos++];
+        *value |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void dv8_trace_write_header(uint8_t header[DV8_TRACE_HEADER_SIZE])
+{
+    memset(header, 0, DV8_TRACE_HEADER_SIZE);
+    memcpy(header, DV8_TRACE_MAGIC, 4);
+    header[4] = DV8_TRACE_VERSION;
+}
+
+size_t dv8_trace_encode(uint8_t *out, size_t out_size, uint64_t delta_us,
+                        const char *topic, size_t topic_len, const char *data, size_t data_len)
+{
+    const dv8_topic_t *desc = dv8_topic_lookup(topic, topic_len);
+    // tag + three varints of at most 10 bytes + optional topic length
+    size_t worst = 1 + 10 + 10 + 10 + data_len + (desc == NULL ? 10 + topic_len : 0);
+    if (worst > out_size) {
+        return 0;
+    }
+
+    size_t n = 0;
+    out[n++] = DV8_TRACE_RECORD_TAG;
+    n += put_varint(out + n, delta_us);
+    if (desc != NULL) {
+        n += put_varint(out + n, (desc - dv8_topics) + 1);
+    } else {
+        n += put_varint(out + n, 0);
+        n += put_varint(out + n, topic_len);
+        memcpy(out + n, topic, topic_len);
+        n += topic_len;
+    }
+    n += put_varint(out + n, data_len);
+    memcpy(out + n, data, data_len);
+    n += data_len;
+    return n;
+}
+
+bool dv8_trace_reader_init(dv8_trace_reader_t *reader, const uint8_t *buf, size_t len)
+{
+    memset(reader, 0, sizeof(*reader));
+    if (len < DV8_TRACE_HEADER_SIZE || memcmp(buf, DV8_TRACE_MAGIC, 4) != 0 || buf[4] != DV8_TRACE_VERSION) {
+        return false;
+    }
+    reader->buf = buf;
+    reader->len = len;
+    reader->pos = DV8_TRACE_HEADER_SIZE;
+    return true;
+}
+
+bool dv8_trace_next(dv8_trace_reader_t *reader, dv8_trace_record_t *record)
+{
+    // Skip block padding
+    while (reader->pos < reader->len && reader->buf[reader->pos] == 0xFF) {
+        reader->pos = (reader->pos / DV8_TRACE_BLOCK_SIZE + 1) * DV8_TRACE_BLOCK_SIZE;
+    }
+    if (reader->pos >= reader->len || reader->buf[reader->pos] != DV8_TRACE_RECORD_TAG) {
+        return false;
+    }
+    reader->pos++;
+
+    uint64_t delta_us, topic_ref, topic_len, data_len;
+    if (!get_varint(reader, &delta_us) || !get_varint(reader, &topic_ref)) {
+        return false;
+    }
+    if (topic_ref > dv8_topic_count) {
+        return false;
+    }
+    if (topic_ref != 0) {
+        record->topic = dv8_topics[topic_ref - 1].topic;
+        record->topic_len = dv8_topics[topic_ref - 1].topic_len;
+    } else {
+        if (!get_varint(reader, &topic_len) || topic_len > reader->len - reader->pos) {
+            return false;
+        }
+        record->topic = (const char *)reader->buf + reader->pos;
+        record->topic_len = topic_len;
+        reader->pos += topic_len;
+    }
+    if (!get_varint(reader, &data_len) || data_len > reader->len - reader->pos) {
+        return false;
+    }
+    record->data = (const char *)reader->buf + reader->pos;
+    record->data_len = data_len;
+    reader->pos += data_len;
+
+    // The first record's delta is relative to when recording started
+    reader->time_us += delta_us;
+    record->time_us = reader->time_us;
+    return true;
+}
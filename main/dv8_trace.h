@@ -0,0 +1,52 @@
+#ifndef DV8_TRACE_H
+#define DV8_TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Compact binary log of received MQTT messages, for replaying field traffic off-target.
+ *
+ * A trace is an 8 byte header ("DV8T", version, 3 reserved bytes) followed by records:
+ *   tag 0xA5, varint delta_us since the previous record, varint topic_ref,
+ *   [varint topic_len, topic bytes if topic_ref == 0], varint data_len, data bytes
+ * topic_ref n > 0 refers to dv8_topics[n - 1], so known topics cost one byte.
+ *
+ * A 0xFF byte where a record should start means "skip to the next DV8_TRACE_BLOCK_SIZE
+ * boundary" (counted from the start of the trace), which lets the flash recorder keep
+ * records inside erase blocks. Erased flash after the last record reads as the end.
+ */
+
+#define DV8_TRACE_MAGIC         "DV8T"
+#define DV8_TRACE_VERSION       1
+#define DV8_TRACE_HEADER_SIZE   8
+#define DV8_TRACE_BLOCK_SIZE    4096
+#define DV8_TRACE_RECORD_TAG    0xA5
+
+typedef struct {
+    uint64_t time_us;       // since recording started
+    const char *topic;
+    size_t topic_len;
+    const char *data;
+    size_t data_len;
+} dv8_trace_record_t;
+
+typedef struct {
+    const uint8_t *buf;
+    size_t len;
+    size_t pos;
+    uint64_t time_us;
+} dv8_trace_reader_t;
+
+extern void dv8_trace_write_header(uint8_t header[DV8_TRACE_HEADER_SIZE]);
+// Encode one record into `out`, returns its size or 0 if it doesn't fit in `out_size`
+extern size_t dv8_trace_encode(uint8_t *out, size_t out_size, uint64_t delta_us,
+                               const char *topic, size_t topic_len, const char *data, size_t data_len);
+
+// Read a whole trace held in memory, returns false if the header is wrong
+extern bool dv8_trace_reader_init(dv8_trace_reader_t *reader, const uint8_t *buf, size_t len);
+// Records point into the reader's buffer. Returns false at the end or on a corrupt record.
+extern bool dv8_trace_next(dv8_trace_reader_t *reader, dv8_trace_record_t *record);
+
+#endif
@@ -0,0 +1,41 @@
+#include "lvgl_blink.h"
+
+
+// Only called when the step path flips the value, so each toggle invalidates the object once
+static void blink_exec_cb(void *var, int32_t value)
+{
+    lv_obj_set_state(var, LVGL_BLINK_STATE, value != 0);
+}
+
+void lvgl_blink_start(lv_obj_t *obj, uint32_t period_ms)
+{
+    if (lvgl_blink_is_running(obj)) {
+        return;
+    }
+
+    // 1 -> 0 with a step path and playback: off for half a period, then on, forever
+    lv_anim_t a;
+    lv_anim_init(&a);
+    lv_anim_set_var(&a, obj);
+    lv_anim_set_exec_cb(&a, blink_exec_cb);
+    lv_anim_set_values(&a, 1, 0);
+    lv_anim_set_path_cb(&a, lv_anim_path_step);
+    lv_anim_set_duration(&a, period_ms / 2);
+    lv_anim_set_playback_duration(&a, period_ms / 2);
+    lv_anim_set_repeat_count(&a, LV_ANIM_REPEAT_INFINITE);
+    lv_anim_start(&a);
+}
+
+void lvgl_blink_stop(lv_obj_t *obj)
+{
+    if (!lv_anim_delete(obj, blink_exec_cb)) {
+        return;
+    }
+
+    lv_obj_remove_state(obj, LVGL_BLINK_STATE);
+}
+
+bool lvgl_blink_is_running(lv_obj_t *obj)
+{
+    return lv_anim_get(obj, blink_exec_cb) != NULL;
+}
@@ -0,0 +1,23 @@
+#ifndef LVGL_BLINK_H
+#define LVGL_BLINK_H
+
+#include <stdbool.h>
+#include "lvgl.h"
+
+// Object state that is set during the "off" half of a blink. Attach the off look with
+// lv_obj_add_style(obj, style, LV_PART_MAIN | LVGL_BLINK_STATE). It is the highest user
+// state, so it wins over styles selected by LV_STATE_USER_1..3.
+#define LVGL_BLINK_STATE LV_STATE_USER_4
+
+/*
+ * Blink an object between its normal styles and its LVGL_BLINK_STATE styles every `period_ms`,
+ * starting with the off phase. Runs as an lv_anim inside lv_timer_handler, so no extra task is
+ * needed and any number of objects can blink at once. Starting an object that already blinks
+ * is a no-op. Must be called with lvgl_api_lock held.
+ */
+extern void lvgl_blink_start(lv_obj_t *obj, uint32_t period_ms);
+// Stop blinking and leave the object in its normal styles, safe to call when not blinking
+extern void lvgl_blink_stop(lv_obj_t *obj);
+extern bool lvgl_blink_is_running(lv_obj_t *obj);
+
+#endif
@@ -0,0 +1,142 @@
+#include <stdatomic.h>
+#include <stddef.h>
+#include "lvgl_cmd.h"
+
+#define CMD_KEY_COUNT   (LVGL_CMD_TYPE_COUNT * LVGL_CMD_MAX_TARGETS)
+#define CMD_QUEUE_MASK  (LVGL_CMD_QUEUE_SIZE - 1)
+
+_Static_assert((LVGL_CMD_QUEUE_SIZE & CMD_QUEUE_MASK) == 0, "LVGL_CMD_QUEUE_SIZE must be a power of two");
+_Static_assert(CMD_KEY_COUNT <= LVGL_CMD_QUEUE_SIZE, "a key per cell, or a full ring can drop");
+
+// Latest value per key, and whether the key is in the ring. The consumer clears `queued`
+// before it reads the value, so a post that lands in between queues the key again.
+typedef struct {
+    _Atomic(int32_t) value;
+    atomic_bool queued;
+} cmd_slot_t;
+
+// Bounded MPSC ring (Vyukov). Sequence numbers count laps, relative to the cell's index, so the
+// zeroed ring is valid: a cell is free for position p when its seq is lap(p), and holds the key
+// for p when it is lap(p) + 1
+#define CMD_LAP(pos)    ((pos) & ~(uint32_t)CMD_QUEUE_MASK)
+
+typedef struct {
+    _Atomic(uint32_t) seq;
+    uint16_t key;
+} cmd_cell_t;
+
+static cmd_slot_t slots[CMD_KEY_COUNT];
+static cmd_cell_t cells[LVGL_CMD_QUEUE_SIZE];
+static _Atomic(uint32_t) enqueue_pos;
+static uint32_t dequeue_pos;        // consumer only
+
+static void (*wake_cb)(void *arg) = NULL;
+static void *wake_arg = NULL;
+
+static _Atomic(uint32_t) stat_posted;
+static _Atomic(uint32_t) stat_coalesced;
+static _Atomic(uint32_t) stat_dropped;
+static uint32_t stat_max_depth;     // consumer only
+
+
+static bool ring_push(uint16_t key)
+{
+    uint32_t pos = atomic_load_explicit(&enqueue_pos, memory_order_relaxed);
+
+    for (;;) {
+        cmd_cell_t *cell = &cells[pos & CMD_QUEUE_MASK];
+        uint32_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        int32_t dif = (int32_t)(seq - CMD_LAP(pos));
+
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(&enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                cell->key = key;
+                atomic_store_explicit(&cell->seq, CMD_LAP(pos) + 1, memory_order_release);
+                return true;
+            }
+            // pos was reloaded by the failed exchange
+        } else if (dif < 0) {
+            return false;   // the consumer hasn't freed this cell yet: full
+        } else {
+            pos = atomic_load_explicit(&enqueue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+static bool ring_pop(uint16_t *key)
+{
+    cmd_cell_t *cell = &cells[dequeue_pos & CMD_QUEUE_MASK];
+    uint32_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+
+    if (seq != CMD_LAP(dequeue_pos) + 1) {
+        return false;       // empty, or the producer that owns it hasn't written the key yet
+    }
+    *key = cell->key;
+    atomic_store_explicit(&cell->seq, CMD_LAP(dequeue_pos) + LVGL_CMD_QUEUE_SIZE, memory_order_release);
+    dequeue_pos++;
+    return true;
+}
+
+bool lvgl_cmd_post(lvgl_cmd_type_t type, uint32_t target, int32_t value)
+{
+    if ((unsigned)type >= LVGL_CMD_TYPE_COUNT || target >= LVGL_CMD_MAX_TARGETS) {
+        return false;
+    }
+    uint16_t key = (uint16_t)(type * LVGL_CMD_MAX_TARGETS + target);
+    cmd_slot_t *slot = &slots[key];
+
+    atomic_fetch_add_explicit(&stat_posted, 1, memory_order_relaxed);
+    atomic_store_explicit(&slot->value, value, memory_order_relaxed);
+    // The release orders the value before the flag; the consumer's acquire exchange pairs with it
+    if (atomic_exchange_explicit(&slot->queued, true, memory_order_acq_rel)) {
+        atomic_fetch_add_explicit(&stat_coalesced, 1, memory_order_relaxed);
+        return true;
+    }
+    if (!ring_push(key)) {
+        atomic_store_explicit(&slot->queued, false, memory_order_release);
+        atomic_fetch_add_explicit(&stat_dropped, 1, memory_order_relaxed);
+        return false;
+    }
+    if (wake_cb != NULL) {
+        wake_cb(wake_arg);
+    }
+    return true;
+}
+
+void lvgl_cmd_set_wake_cb(void (*cb)(void *arg), void *arg)
+{
+    wake_arg = arg;
+    wake_cb = cb;
+}
+
+uint32_t lvgl_cmd_drain(lvgl_cmd_apply_cb_t apply)
+{
+    // Only what is there now, so producers posting faster than this applies can't keep it here
+    uint32_t end = atomic_load_explicit(&enqueue_pos, memory_order_acquire);
+    uint32_t depth = end - dequeue_pos;
+    if (depth > stat_max_depth) {
+        stat_max_depth = depth;
+    }
+
+    uint32_t applied = 0;
+    uint16_t key;
+    while ((int32_t)(end - dequeue_pos) > 0 && ring_pop(&key)) {
+        cmd_slot_t *slot = &slots[key];
+        // Acquire pairs with the post that set the flag, so its value (or a later one) is seen
+        atomic_exchange_explicit(&slot->queued, false, memory_order_acq_rel);
+        int32_t value = atomic_load_explicit(&slot->value, memory_order_relaxed);
+        apply((lvgl_cmd_type_t)(key / LVGL_CMD_MAX_TARGETS), key % LVGL_CMD_MAX_TARGETS, value);
+        applied++;
+    }
+    return applied;
+}
+
+void lvgl_cmd_get_stats(lvgl_cmd_stats_t *out)
+{
+    out->posted = atomic_load_explicit(&stat_posted, memory_order_relaxed);
+    out->coalesced = atomic_load_explicit(&stat_coalesced, memory_order_relaxed);
+    out->dropped = atomic_load_explicit(&stat_dropped, memory_order_relaxed);
+    out->depth = atomic_load_explicit(&enqueue_pos, memory_order_relaxed) - dequeue_pos;
+    out->max_depth = stat_max_depth;
+}
@@ -0,0 +1,48 @@
+#ifndef LVGL_CMD_H
+#define LVGL_CMD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * UI commands from any task to the LVGL task, without lvgl_api_lock.
+ *
+ * A command is a type, a target within the type (a field, ...) and an int32 value. Only the
+ * latest value per type and target matters: posting again before the LVGL task got to it just
+ * replaces the value, and the command keeps its place in the queue. Producers never block and
+ * never take a lock; the queue is a bounded ring of type/target keys with one slot per key for
+ * the value, so it only drops with more keys pending than LVGL_CMD_QUEUE_SIZE, never at its
+ * current size.
+ *
+ * The LVGL task drains it with lvgl_cmd_drain() before each lv_timer_handler().
+ */
+
+typedef enum {
+    LVGL_CMD_PAGE = 0,      // target 0, value 0 status buttons, 1 trends
+    LVGL_CMD_FIELD,         // target dv8_field_t, value as its widget takes it (lvgl_show_field)
+    LVGL_CMD_TOUCH,         // target 0, value unused: dv8_touch queued events (lvgl_touch_read)
+    LVGL_CMD_TYPE_COUNT
+} lvgl_cmd_type_t;
+
+#define LVGL_CMD_MAX_TARGETS    16
+#define LVGL_CMD_QUEUE_SIZE     64      // power of two, one cell per type/target never drops
+
+typedef struct {
+    uint32_t posted;
+    uint32_t coalesced;     // posted while the same type/target was still pending
+    uint32_t dropped;       // queue full
+    uint32_t depth;         // pending right now
+    uint32_t max_depth;
+} lvgl_cmd_stats_t;
+
+typedef void (*lvgl_cmd_apply_cb_t)(lvgl_cmd_type_t type, uint32_t target, int32_t value);
+
+// Any task, not from an ISR (the wake callback notifies a task). Returns false if the command was dropped (queue full or no such target).
+extern bool lvgl_cmd_post(lvgl_cmd_type_t type, uint32_t target, int32_t value);
+// Called after a post that queued a new command, to wake the consumer
+extern void lvgl_cmd_set_wake_cb(void (*cb)(void *arg), void *arg);
+// LVGL task: apply what was pending when the call started, oldest first. Returns the count.
+extern uint32_t lvgl_cmd_drain(lvgl_cmd_apply_cb_t apply);
+extern void lvgl_cmd_get_stats(lvgl_cmd_stats_t *out);
+
+#endif
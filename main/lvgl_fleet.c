@@ -0,0 +1,235 @@
+#include "sdkconfig.h"
+#if CONFIG_DV8_FLEET_MODE
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "dv8_fleet.h"
+#include "lvgl_fleet.h"
+
+#define FLEET_MAX_ROWS      16
+#define FLEET_FONT          (&lv_font_montserrat_12)
+
+typedef enum {
+    ROW_UNKNOWN = 0,        // no state received yet
+    ROW_NORMAL,
+    ROW_WARNING,
+    ROW_BLUE,
+} row_visual_t;
+
+static const lv_state_t row_states[] = {
+    [ROW_UNKNOWN] = LV_STATE_DEFAULT,
+    [ROW_NORMAL] = LV_STATE_USER_1,
+    [ROW_WARNING] = LV_STATE_USER_2,
+    [ROW_BLUE] = LV_STATE_USER_3,
+};
+
+// A row label and what it last showed
+typedef struct {
+    lv_obj_t *lbl;
+    int robot;              // dv8_fleet index, -1 for an empty row
+    row_visual_t visual;
+    char text[32];
+} fleet_row_t;
+
+static lv_style_t style_row;
+static lv_style_t style_normal;
+static lv_style_t style_warning;
+static lv_style_t style_blue;
+
+static lv_obj_t *header_lbl;
+static fleet_row_t rows[FLEET_MAX_ROWS];
+static unsigned row_count = 0;
+static unsigned page = 0;
+static size_t shown_robots = 0;
+static uint32_t rows_redrawn = 0;
+
+
+static const char *mode_name(int robot_mode)
+{
+    switch (robot_mode) {
+    case 1:
+    case 6:
+        return "Idle";
+    case 2:
+        return "Cover";
+    case 3:
+        return "Litter";
+    case 4:
+        return "Switch";
+    case 7:
+        return "Error";
+    default:
+        return "?";
+    }
+}
+
+static row_visual_t row_visual(const dv8_robot_state_t *state)
+{
+    if (state->version == 0) {
+        return ROW_UNKNOWN;
+    }
+    if (state->e_stop == 1 || state->handbrake == 1 || state->safety_mode == 0 || state->robot_mode == 7) {
+        return ROW_WARNING;
+    }
+    if (state->direct_status == 1) {
+        return ROW_BLUE;
+    }
+    return ROW_NORMAL;
+}
+
+// Apply only what differs from what the row shows
+static void row_show(fleet_row_t *row, row_visual_t visual, const char *text)
+{
+    bool redrawn = false;
+
+    if (row->visual != visual) {
+        lv_obj_remove_state(row->lbl, row_states[row->visual]);
+        lv_obj_add_state(row->lbl, row_states[visual]);
+        row->visual = visual;
+        redrawn = true;
+    }
+    if (strcmp(row->text, text) != 0) {
+        // The label shows row->text in place, set_text_static only tells it to re-layout
+        snprintf(row->text, sizeof(row->text), "%s", text);
+        lv_label_set_text_static(row->lbl, row->text);
+        redrawn = true;
+    }
+    if (redrawn) {
+        rows_redrawn++;
+    }
+}
+
+static void row_render(fleet_row_t *row)
+{
+    if (row->robot < 0) {
+        row_show(row, ROW_UNKNOWN, "");
+        return;
+    }
+
+    dv8_robot_state_t state;
+    dv8_fleet_read(row->robot, &state);
+
+    char text[sizeof(row->text)];
+    if (state.version == 0) {
+        snprintf(text, sizeof(text), "%s", dv8_fleet_id(row->robot));
+    } else {
+        snprintf(text, sizeof(text), "%-8s %-6s %3ld%%%s", dv8_fleet_id(row->robot), mode_name(state.robot_mode),
+                 lroundf(state.battery_percentage), state.battery_is_charging == 1 ? "+" : "");
+    }
+    row_show(row, row_visual(&state), text);
+}
+
+static void header_render(void)
+{
+    unsigned pages = shown_robots > 0 ? (shown_robots + row_count - 1) / row_count : 1;
+    lv_label_set_text_fmt(header_lbl, "Fleet: %u  page %u/%u", (unsigned)shown_robots, page + 1, pages);
+}
+
+// Point every row at its robot on the current page and draw it from scratch
+static void page_render(void)
+{
+    for (unsigned i = 0; i < row_count; i++) {
+        size_t robot = (size_t)page * row_count + i;
+        rows[i].robot = robot < shown_robots ? (int)robot : -1;
+        if (rows[i].robot >= 0) {
+            dv8_fleet_take_changed(rows[i].robot);
+        }
+        row_render(&rows[i]);
+    }
+    header_render();
+}
+
+static void page_timer_cb(lv_timer_t *timer)
+{
+    unsigned pages = (shown_robots + row_count - 1) / row_count;
+    if (pages > 1) {
+        page = (page + 1) % pages;
+        page_render();
+    }
+}
+
+void lvgl_fleet_ui(lv_display_t *disp)
+{
+    lv_obj_t *scr = lv_display_get_screen_active(disp);
+    int32_t width = lv_display_get_horizontal_resolution(disp);
+    int32_t row_height = lv_font_get_line_height(FLEET_FONT) + 2;
+
+    lv_style_init(&style_row);
+    lv_style_set_text_font(&style_row, FLEET_FONT);
+    lv_style_set_bg_opa(&style_row, LV_OPA_COVER);
+    lv_style_set_bg_color(&style_row, lv_color_make(75,80,70));     //BGR, same as the buttons
+    lv_style_set_pad_hor(&style_row, 2);
+
+    lv_style_init(&style_normal);
+    lv_style_set_bg_color(&style_normal, lv_color_make(100, 180, 30));
+    lv_style_init(&style_warning);
+    lv_style_set_bg_color(&style_warning, lv_color_make(0,0,255));
+    lv_style_init(&style_blue);
+    lv_style_set_bg_color(&style_blue, lv_color_make(200, 170, 60));
+
+    header_lbl = lv_label_create(scr);
+    lv_obj_set_style_text_font(header_lbl, FLEET_FONT, 0);
+    lv_obj_align(header_lbl, LV_ALIGN_TOP_LEFT, 2, 0);
+
+    row_count = (lv_display_get_vertical_resolution(disp) - row_height) / row_height;
+    if (row_count > FLEET_MAX_ROWS) {
+        row_count = FLEET_MAX_ROWS;
+    }
+
+    for (unsigned i = 0; i < row_count; i++) {
+        fleet_row_t *row = &rows[i];
+        row->lbl = lv_label_create(scr);
+        row->robot = -1;
+        row->visual = ROW_UNKNOWN;
+        row->text[0] = '\0';
+        lv_label_set_text_static(row->lbl, row->text);
+        lv_label_set_long_mode(row->lbl, LV_LABEL_LONG_CLIP);
+        lv_obj_set_size(row->lbl, width, row_height - 1);
+        lv_obj_set_pos(row->lbl, 0, (i + 1) * row_height);
+
+        lv_obj_add_style(row->lbl, &style_row, LV_PART_MAIN);
+        lv_obj_add_style(row->lbl, &style_normal, LV_PART_MAIN | row_states[ROW_NORMAL]);
+        lv_obj_add_style(row->lbl, &style_warning, LV_PART_MAIN | row_states[ROW_WARNING]);
+        lv_obj_add_style(row->lbl, &style_blue, LV_PART_MAIN | row_states[ROW_BLUE]);
+    }
+
+    shown_robots = dv8_fleet_count();
+    page_render();
+    lv_timer_create(page_timer_cb, CONFIG_DV8_FLEET_PAGE_MS, NULL);
+}
+
+bool lvgl_fleet_sync(void)
+{
+    uint32_t before = rows_redrawn;
+
+    // New robots only matter if they land on the visible page
+    size_t robots = dv8_fleet_count();
+    if (robots != shown_robots) {
+        size_t first = (size_t)page * row_count;
+        shown_robots = robots;
+        for (unsigned i = 0; i < row_count; i++) {
+            if (rows[i].robot < 0 && first + i < robots) {
+                rows[i].robot = first + i;
+                dv8_fleet_take_changed(rows[i].robot);
+                row_render(&rows[i]);
+            }
+        }
+        header_render();
+    }
+
+    // Robots on other pages keep their changed bit until their page comes up
+    for (unsigned i = 0; i < row_count; i++) {
+        if (rows[i].robot >= 0 && dv8_fleet_take_changed(rows[i].robot)) {
+            row_render(&rows[i]);
+        }
+    }
+    return rows_redrawn != before;
+}
+
+uint32_t lvgl_fleet_rows_redrawn(void)
+{
+    return rows_redrawn;
+}
+
+#endif /* CONFIG_DV8_FLEET_MODE */
@@ -0,0 +1,23 @@
+#ifndef LVGL_FLEET_H
+#define LVGL_FLEET_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "lvgl.h"
+
+/*
+ * Fleet overview: one line per robot from dv8_fleet, id, mode and battery, colored like the
+ * single robot buttons (red for e-stop, handbrake, safety off or error, blue for manual
+ * control). Only a screenful of row labels exists; with more robots than rows the view pages
+ * through them every CONFIG_DV8_FLEET_PAGE_MS, so the LVGL heap doesn't grow with the fleet.
+ */
+
+// Create the overview on the active screen of `disp`, instead of example_lvgl_demo_ui()
+extern void lvgl_fleet_ui(lv_display_t *disp);
+// Redraw the visible rows whose robot changed since the last call. Returns true if any did.
+// Must be called with lvgl_api_lock held.
+extern bool lvgl_fleet_sync(void);
+// Row redraws so far, vs. the fleet changes in dv8_fleet_stats_t
+extern uint32_t lvgl_fleet_rows_redrawn(void);
+
+#endif
@@ -0,0 +1,126 @@
+#include <string.h>
+#include "lvgl_numlabel.h"
+
+static size_t append(char *buf, size_t size, size_t len, const char *s, size_t n)
+{
+    if (len < size) {
+        size_t room = size - 1 - len;
+        memcpy(buf + len, s, n < room ? n : room);
+    }
+    return len + n;
+}
+
+size_t lvgl_numlabel_format(char *buf, size_t size, const char *prefix, int32_t value, uint8_t decimals,
+                            const char *suffix)
+{
+    // Digits right to left, widest case "-2147483648" plus the point
+    char digits[16];
+    size_t pos = sizeof(digits);
+    uint32_t magnitude = value < 0 ? 0U - (uint32_t)value : (uint32_t)value;
+    unsigned written = 0;
+
+    do {
+        if (written == decimals && decimals > 0) {
+            digits[--pos] = '.';
+        }
+        digits[--pos] = '0' + magnitude % 10;
+        magnitude /= 10;
+        written++;
+    } while (magnitude > 0 || written <= decimals);
+    if (value < 0) {
+        digits[--pos] = '-';
+    }
+
+    size_t len = 0;
+    len = append(buf, size, len, prefix, strlen(prefix));
+    len = append(buf, size, len, &digits[pos], sizeof(digits) - pos);
+    len = append(buf, size, len, suffix, strlen(suffix));
+    if (size > 0) {
+        buf[len < size ? len : size - 1] = '\0';
+    }
+    return len;
+}
+
+void lvgl_numlabel_init(lvgl_numlabel_t *num, lv_obj_t *lbl, const char *prefix, uint8_t decimals, const char *suffix)
+{
+    num->lbl = lbl;
+    num->prefix = prefix;
+    num->suffix = suffix;
+    num->decimals = decimals;
+    num->width = -1;
+    num->text[0] = '\0';
+}
+
+static int32_t text_width(lv_obj_t *lbl, const char *text)
+{
+    return lv_text_get_width(text, strlen(text), lv_obj_get_style_text_font(lbl, LV_PART_MAIN),
+                             lv_obj_get_style_text_letter_space(lbl, LV_PART_MAIN));
+}
+
+// Letter index of byte `byte_id`, the prefix or suffix may be UTF-8
+static uint32_t char_id(const char *text, size_t byte_id)
+{
+    uint32_t id = 0;
+    for (size_t i = 0; i < byte_id; i++) {
+        if (((uint8_t)text[i] & 0xC0) != 0x80) {
+            id++;
+        }
+    }
+    return id;
+}
+
+// Screen area of the glyphs [first, end) of what the label shows now, false if they span lines
+static bool glyph_area(lvgl_numlabel_t *num, size_t first, size_t end, lv_area_t *area)
+{
+    lv_point_t from, to;
+    lv_label_get_letter_pos(num->lbl, char_id(num->text, first), &from);
+    lv_label_get_letter_pos(num->lbl, char_id(num->text, end), &to);
+    if (from.y != to.y) {
+        return false;
+    }
+
+    lv_area_t content;
+    lv_obj_get_content_coords(num->lbl, &content);
+    const lv_font_t *font = lv_obj_get_style_text_font(num->lbl, LV_PART_MAIN);
+    // A pixel of slack either side for glyphs that overhang their advance
+    area->x1 = content.x1 + from.x - 1;
+    area->x2 = content.x1 + to.x;
+    area->y1 = content.y1 + from.y;
+    area->y2 = area->y1 + lv_font_get_line_height(font) - 1;
+    return true;
+}
+
+bool lvgl_numlabel_set(lvgl_numlabel_t *num, int32_t value)
+{
+    char next[LVGL_NUMLABEL_MAX];
+    lvgl_numlabel_format(next, sizeof(next), num->prefix, value, num->decimals, num->suffix);
+
+    bool showing = lv_label_get_text(num->lbl) == num->text;
+    if (showing && strcmp(next, num->text) == 0) {
+        return false;
+    }
+
+    size_t len = strlen(next);
+    if (showing && len == strlen(num->text) && text_width(num->lbl, next) == num->width) {
+        size_t first = 0, end = len;
+        while (next[first] == num->text[first]) {
+            first++;
+        }
+        while (next[end - 1] == num->text[end - 1]) {
+            end--;
+        }
+
+        // Same width and same text either side, so nothing outside [first, end) moves
+        lv_area_t area;
+        if (glyph_area(num, first, end, &area)) {
+            memcpy(num->text + first, next + first, end - first);
+            lv_obj_invalidate_area(num->lbl, &area);
+            return true;
+        }
+    }
+
+    memcpy(num->text, next, len + 1);
+    lv_label_set_text_static(num->lbl, num->text);
+    num->width = text_width(num->lbl, num->text);
+    return true;
+}
@@ -0,0 +1,41 @@
+#ifndef LVGL_NUMLABEL_H
+#define LVGL_NUMLABEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "lvgl.h"
+
+/*
+ * Numeric readout on an lv_label: "<prefix><value><suffix>" with the value as fixed point,
+ * e.g. 825 with 1 decimal is "82.5". Formatting is integer only, no float printf.
+ *
+ * The label shows the text in place from the readout's own buffer. Setting the same value
+ * again does nothing. When only some characters change and the text keeps its width, just the
+ * box of those glyphs is invalidated, without re-measuring the label, so a tenths digit
+ * ticking over redraws a few pixels rather than the whole button. Anything else (another length
+ * or width, or the label showing some other text meanwhile) falls back to lv_label_set_text_static.
+ */
+
+#define LVGL_NUMLABEL_MAX 32
+
+typedef struct {
+    lv_obj_t *lbl;
+    const char *prefix;     // static strings
+    const char *suffix;
+    uint8_t decimals;       // 0 to 9
+    int32_t width;          // of text as last laid out by the label
+    char text[LVGL_NUMLABEL_MAX];
+} lvgl_numlabel_t;
+
+// Bind a readout to `lbl`, the label is left alone until the first lvgl_numlabel_set()
+extern void lvgl_numlabel_init(lvgl_numlabel_t *num, lv_obj_t *lbl, const char *prefix, uint8_t decimals,
+                               const char *suffix);
+// Show `value` (in units of 10^-decimals). Returns false if the label already showed it.
+// Must be called with lvgl_api_lock held.
+extern bool lvgl_numlabel_set(lvgl_numlabel_t *num, int32_t value);
+// The formatter on its own, truncates like snprintf and returns the length it wanted
+extern size_t lvgl_numlabel_format(char *buf, size_t size, const char *prefix, int32_t value, uint8_t decimals,
+                                   const char *suffix);
+
+#endif
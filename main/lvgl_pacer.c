@@ -0,0 +1,103 @@
+#include "lvgl_pacer.h"
+#include "dv8_metrics.h"
+#include "sdkconfig.h"
+
+// Stretch the period once frames use more than 3/4 of it
+#define PACER_BUDGET_NUM    3
+#define PACER_BUDGET_DEN    4
+
+static lv_timer_t *refr_timer;
+static int64_t (*clock_now_us)(void);
+
+static int64_t frame_start_us;
+static int64_t prev_start_us;
+static int64_t requested_us;        // first refresh request since the last refresh, 0 if none
+static bool frame_rendered;
+static uint32_t avg_cost_us;
+static uint32_t period_ms = LV_DEF_REFR_PERIOD;
+static lvgl_pacer_stats_t stats = { .period_ms = LV_DEF_REFR_PERIOD };
+
+
+static void pacer_set_period(uint32_t ms)
+{
+    ms = LV_CLAMP(LV_DEF_REFR_PERIOD, ms, CONFIG_DV8_REFR_MAX_PERIOD_MS);
+    if (ms != period_ms) {
+        period_ms = ms;
+        lv_timer_set_period(refr_timer, ms);
+        stats.period_ms = ms;
+    }
+}
+
+// LVGL itself resumes the refresh timer on this event, just note when the first one came
+static void pacer_refr_request_cb(lv_event_t *e)
+{
+    if (requested_us == 0) {
+        requested_us = clock_now_us();
+    }
+}
+
+static void pacer_refr_start_cb(lv_event_t *e)
+{
+    frame_start_us = clock_now_us();
+    frame_rendered = false;
+
+    // The frame was due one period after the previous one, or at the request if that came later.
+    // Every whole period it started after that is a frame the panel didn't get.
+    int64_t due_us = LV_MAX(requested_us, prev_start_us + (int64_t)period_ms * 1000);
+    if (requested_us != 0 && frame_start_us - due_us >= (int64_t)period_ms * 1000) {
+        stats.dropped += (uint32_t)((frame_start_us - due_us) / ((int64_t)period_ms * 1000));
+    }
+    prev_start_us = frame_start_us;
+}
+
+static void pacer_render_ready_cb(lv_event_t *e)
+{
+    frame_rendered = true;
+}
+
+static void pacer_refr_ready_cb(lv_event_t *e)
+{
+    // lv_display_refr_timer() has cleared the invalid areas by now, so sleep after every refresh;
+    // the next lv_inv_area resumes the timer with LV_EVENT_REFR_REQUEST
+    lv_timer_pause(refr_timer);
+    requested_us = 0;
+
+    if (!frame_rendered) {
+        stats.skipped++;
+        return;
+    }
+    stats.rendered++;
+
+    uint32_t cost_us = (uint32_t)(clock_now_us() - frame_start_us);
+    stats.max_cost_us = LV_MAX(stats.max_cost_us, cost_us);
+    dv8_metrics_frame(cost_us);
+    avg_cost_us = avg_cost_us ? (avg_cost_us * 3 + cost_us) / 4 : cost_us;
+
+    // Only animations need a steady frame rate, one-off updates keep the short period for latency
+    if (lv_anim_count_running() == 0) {
+        pacer_set_period(LV_DEF_REFR_PERIOD);
+        return;
+    }
+    // Animation steps due while this frame was still being drawn never make it to the panel
+    stats.dropped += cost_us / (period_ms * 1000);
+    uint32_t needed_ms = (avg_cost_us * PACER_BUDGET_DEN / PACER_BUDGET_NUM + 999) / 1000;
+    pacer_set_period(needed_ms);
+}
+
+void lvgl_pacer_attach(lv_display_t *disp, int64_t (*now_us)(void))
+{
+    clock_now_us = now_us;
+    refr_timer = lv_display_get_refr_timer(disp);
+    period_ms = LV_DEF_REFR_PERIOD;
+    lv_timer_set_period(refr_timer, period_ms);
+
+    lv_display_add_event_cb(disp, pacer_refr_request_cb, LV_EVENT_REFR_REQUEST, NULL);
+    lv_display_add_event_cb(disp, pacer_refr_start_cb, LV_EVENT_REFR_START, NULL);
+    lv_display_add_event_cb(disp, pacer_render_ready_cb, LV_EVENT_RENDER_READY, NULL);
+    lv_display_add_event_cb(disp, pacer_refr_ready_cb, LV_EVENT_REFR_READY, NULL);
+}
+
+void lvgl_pacer_get_stats(lvgl_pacer_stats_t *out)
+{
+    *out = stats;
+}
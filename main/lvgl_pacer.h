@@ -0,0 +1,34 @@
+#ifndef LVGL_PACER_H
+#define LVGL_PACER_H
+
+#include <stdint.h>
+#include "lvgl.h"
+
+/*
+ * Adaptive refresh for one display.
+ *
+ * The refresh timer is paused after every refresh and only resumed by LVGL's own refresh
+ * request when an area gets invalidated, so an idle screen costs no refresh wakeups at all. A
+ * resumed timer runs as soon as its period since the previous refresh has passed.
+ *
+ * While animations run, the period follows the measured frame cost (refresh start to last flush
+ * done): frames that need more than 3/4 of the period stretch it, up to
+ * CONFIG_DV8_REFR_MAX_PERIOD_MS, so animations step less often instead of missing frames. Once
+ * frames are cheap again or nothing animates, the period goes back to LV_DEF_REFR_PERIOD.
+ */
+
+typedef struct {
+    uint32_t rendered;      // refreshes that drew at least one area
+    uint32_t skipped;       // refreshes that found nothing to draw
+    uint32_t dropped;       // periods an animated frame overran, or a request waited past its slot
+    uint32_t period_ms;     // current refresh period
+    uint32_t max_cost_us;   // most expensive rendered frame so far
+} lvgl_pacer_stats_t;
+
+// Take over the refresh timer of `disp`. `now_us` is a microsecond clock to measure frames with.
+// Must be called with lvgl_api_lock held.
+extern void lvgl_pacer_attach(lv_display_t *disp, int64_t (*now_us)(void));
+// Counters since lvgl_pacer_attach(), read without the lock like lvgl_get_update_stats()
+extern void lvgl_pacer_get_stats(lvgl_pacer_stats_t *stats);
+
+#endif
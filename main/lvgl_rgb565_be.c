@@ -0,0 +1,159 @@
+#include "lvgl_rgb565_be.h"
+#include "lvgl.h"
+#include "src/core/lv_obj_private.h"
+#include "src/core/lv_obj_draw_private.h"
+#include "src/display/lv_display_private.h"
+#include "src/misc/lv_area_private.h"
+
+static uint32_t fallbacks;
+
+#if LV_USE_DRAW_SW_ASM == LV_DRAW_SW_ASM_CUSTOM
+bool lvgl_rgb565_be_active = true;
+static bool enabled = true;
+
+
+// RGB565 pixels the hooks would take for big-endian ones. Other formats are converted on the way
+// in and fine, and so are symbols, which are font glyphs.
+static bool image_src_is_rgb565(const void *src)
+{
+    lv_image_header_t header;
+
+    switch (lv_image_src_get_type(src)) {
+    case LV_IMAGE_SRC_VARIABLE:
+        header = ((const lv_image_dsc_t *)src)->header;
+        break;
+    case LV_IMAGE_SRC_FILE:
+        if (lv_image_decoder_get_info(src, &header) != LV_RESULT_OK) {
+            return false;
+        }
+        break;
+    default:
+        return false;
+    }
+    return header.cf == LV_COLOR_FORMAT_RGB565 || header.cf == LV_COLOR_FORMAT_RGB565A8;
+}
+
+// Whether this refresh draws anything of `obj`, the same test lv_refr uses to skip it
+static bool obj_in_refresh(lv_display_t *disp, lv_obj_t *obj, lv_layer_type_t layer_type)
+{
+    lv_area_t area;
+    lv_obj_get_coords(obj, &area);
+    int32_t ext = lv_obj_get_ext_draw_size(obj);
+    lv_area_increase(&area, ext, ext);
+    if (layer_type == LV_LAYER_TYPE_TRANSFORM) {
+        lv_obj_get_transformed_area(obj, &area, LV_OBJ_POINT_TRANSFORM_FLAG_NONE);
+    }
+
+    for (uint32_t i = 0; i < disp->inv_p; i++) {
+        lv_area_t common;
+        if (!disp->inv_area_joined[i] && lv_area_intersect(&common, &area, &disp->inv_areas[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Whether `obj` or a child of it draws through a path the hooks don't cover
+static bool obj_needs_native(lv_display_t *disp, lv_obj_t *obj)
+{
+    if (lv_obj_has_flag(obj, LV_OBJ_FLAG_HIDDEN)) {
+        return false;
+    }
+    // The layer type is cached on the object, blend mode and transform make one
+    lv_layer_type_t layer_type = lv_obj_get_layer_type(obj);
+    if (obj_in_refresh(disp, obj, layer_type)) {
+        if (layer_type == LV_LAYER_TYPE_TRANSFORM) {
+            return true;
+        }
+        if (layer_type == LV_LAYER_TYPE_SIMPLE && lv_obj_get_style_blend_mode(obj, LV_PART_MAIN) != LV_BLEND_MODE_NORMAL) {
+            return true;
+        }
+        if (image_src_is_rgb565(lv_obj_get_style_bg_image_src(obj, LV_PART_MAIN))) {
+            return true;
+        }
+#if LV_USE_IMAGE
+        // An image's own blend mode goes to its draw, not to a layer
+        if (lv_obj_has_class(obj, &lv_image_class) &&
+                (lv_image_get_blend_mode(obj) != LV_BLEND_MODE_NORMAL || image_src_is_rgb565(lv_image_get_src(obj)))) {
+            return true;
+        }
+#endif
+    } else if (!lv_obj_has_flag(obj, LV_OBJ_FLAG_OVERFLOW_VISIBLE)) {
+        return false;    // children are clipped to it
+    }
+
+    uint32_t count = lv_obj_get_child_count(obj);
+    for (uint32_t i = 0; i < count; i++) {
+        if (obj_needs_native(disp, lv_obj_get_child(obj, i))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The screens lv_refr draws, bottom to top
+static bool display_needs_native(lv_display_t *disp)
+{
+    lv_obj_t *screens[] = {
+        lv_display_get_layer_bottom(disp),
+        lv_display_get_screen_prev(disp),
+        lv_display_get_screen_active(disp),
+        lv_display_get_layer_top(disp),
+        lv_display_get_layer_sys(disp),
+    };
+
+    for (size_t i = 0; i < sizeof(screens) / sizeof(screens[0]); i++) {
+        if (screens[i] != NULL && obj_needs_native(disp, screens[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void render_start_cb(lv_event_t *e)
+{
+    lv_display_t *disp = lv_event_get_target(e);
+    lvgl_rgb565_be_active = enabled && !display_needs_native(disp);
+    if (enabled && !lvgl_rgb565_be_active) {
+        fallbacks++;
+    }
+}
+
+// Outside a refresh (lvgl_sprite's captures) the hooks render as configured
+static void render_ready_cb(lv_event_t *e)
+{
+    LV_UNUSED(e);
+    lvgl_rgb565_be_active = enabled;
+}
+
+void lvgl_rgb565_be_attach(lv_display_t *disp)
+{
+    lv_display_add_event_cb(disp, render_start_cb, LV_EVENT_RENDER_START, NULL);
+    lv_display_add_event_cb(disp, render_ready_cb, LV_EVENT_RENDER_READY, NULL);
+}
+
+void lvgl_rgb565_be_set_enabled(bool enable)
+{
+    enabled = enable;
+    lvgl_rgb565_be_active = enable;
+}
+
+#else
+// Without the hooks LVGL always renders natively
+bool lvgl_rgb565_be_active = false;
+
+void lvgl_rgb565_be_attach(lv_display_t *disp)
+{
+    LV_UNUSED(disp);
+}
+
+void lvgl_rgb565_be_set_enabled(bool enable)
+{
+    LV_UNUSED(enable);
+}
+#endif
+
+uint32_t lvgl_rgb565_be_get_fallbacks(void)
+{
+    return fallbacks;
+}
@@ -0,0 +1,317 @@
+#ifndef LVGL_RGB565_BE_H
+#define LVGL_RGB565_BE_H
+
+/*
+ * Big-endian RGB565 rendering for the SPI panel. LVGL includes this file into its software
+ * blenders as LV_DRAW_SW_ASM_CUSTOM_INCLUDE (see sdkconfig.defaults), and the hooks below take
+ * over every normal-mode blend into an RGB565 target: they read and write the target with its
+ * bytes swapped, so the draw buffer is already in the panel's byte order and flush_cb can hand
+ * it to the SPI DMA as it is, without lv_draw_sw_rgb565_swap().
+ *
+ * The arithmetic is LVGL's own (lv_draw_sw_blend_to_rgb565.c) with the swap on load and store,
+ * so every pixel matches the native render followed by the swap. RGB565 sources are taken to be
+ * big-endian as well, which holds for the LV_COLOR_FORMAT_NATIVE layers LVGL renders through
+ * these hooks and for lvgl_sprite's captures.
+ *
+ * Some paths never reach a hook and would read the big-endian target or source as native:
+ * RGB565 images (assets, canvases), additive and the other non-normal blend modes, and
+ * transformed layers, whose pixels lv_draw_sw_transform() interpolates. Before each refresh
+ * lvgl_rgb565_be_attach()'s check looks for them among the objects being redrawn; if one is
+ * there, the hooks stand aside for that refresh (lvgl_rgb565_be_active is false), LVGL renders
+ * natively and flush_cb swaps the areas as without this file.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "src/display/lv_display.h"
+
+// Whether the hooks render big-endian right now, flush_cb swaps the area if not. False in
+// builds without the hooks.
+extern bool lvgl_rgb565_be_active;
+
+// Check every refresh of `disp` for paths the hooks don't cover, before it renders anything
+extern void lvgl_rgb565_be_attach(lv_display_t *disp);
+// Render natively and swap in flush_cb while disabled, for comparing the two. Enabled by default.
+extern void lvgl_rgb565_be_set_enabled(bool enabled);
+// Refreshes rendered natively since boot because they needed an uncovered path
+extern uint32_t lvgl_rgb565_be_get_fallbacks(void);
+
+#include "src/draw/sw/blend/lv_draw_sw_blend_private.h"
+#include "src/misc/lv_color.h"
+#include "src/stdlib/lv_string.h"
+
+#if LV_USE_DRAW_SW && LV_DRAW_SW_SUPPORT_RGB565
+
+static inline uint16_t lvgl_rgb565_be_swap(uint16_t c)
+{
+    return (uint16_t)((c >> 8) | (c << 8));
+}
+
+static inline uint16_t lvgl_rgb565_be_from_l8(uint8_t c1)
+{
+    return ((c1 & 0xF8) << 8) + ((c1 & 0xFC) << 3) + ((c1 & 0xF8) >> 3);
+}
+
+static inline uint16_t lvgl_rgb565_be_mix_8_16(uint8_t c1, uint16_t c2, uint8_t mix)
+{
+    if (mix == 0) {
+        return c2;
+    } else if (mix == 255) {
+        return lvgl_rgb565_be_from_l8(c1);
+    }
+    lv_opa_t mix_inv = 255 - mix;
+    return ((((c1 >> 3) * mix + ((c2 >> 11) & 0x1F) * mix_inv) << 3) & 0xF800) +
+           ((((c1 >> 2) * mix + ((c2 >> 5) & 0x3F) * mix_inv) >> 3) & 0x07E0) +
+           (((c1 >> 3) * mix + (c2 & 0x1F) * mix_inv) >> 8);
+}
+
+static inline uint16_t lvgl_rgb565_be_mix_24_16(const uint8_t *c1, uint16_t c2, uint8_t mix)
+{
+    if (mix == 0) {
+        return c2;
+    } else if (mix == 255) {
+        return ((c1[2] & 0xF8) << 8) + ((c1[1] & 0xFC) << 3) + ((c1[0] & 0xF8) >> 3);
+    }
+    lv_opa_t mix_inv = 255 - mix;
+    return ((((c1[2] >> 3) * mix + ((c2 >> 11) & 0x1F) * mix_inv) << 3) & 0xF800) +
+           ((((c1[1] >> 2) * mix + ((c2 >> 5) & 0x3F) * mix_inv) >> 3) & 0x07E0) +
+           (((c1[0] >> 3) * mix + (c2 & 0x1F) * mix_inv) >> 8);
+}
+
+static inline void *lvgl_rgb565_be_next_row(const void *buf, int32_t stride)
+{
+    return (void *)((const uint8_t *)buf + stride);
+}
+
+/*
+ * Coverage of one pixel the way the generic variants compute it: the mask and opa, the latter
+ * only when opa < LV_OPA_MAX. Formats with alpha always scale by it, even at 255, and the opaque
+ * ones ignore `a`. `with_mask` and `with_opa` are constants at every call, so each variant
+ * compiles to its own loop without the checks.
+ */
+static inline uint8_t lvgl_rgb565_be_coverage(uint8_t a, bool with_mask, bool with_opa, lv_opa_t m, lv_opa_t opa)
+{
+    LV_UNUSED(a);
+    if (with_mask) {
+        return with_opa ? LV_OPA_MIX2(m, opa) : m;
+    }
+    return with_opa ? opa : 255;
+}
+
+static inline uint8_t lvgl_rgb565_be_coverage_alpha(uint8_t a, bool with_mask, bool with_opa, lv_opa_t m, lv_opa_t opa)
+{
+    if (with_mask) {
+        return with_opa ? LV_OPA_MIX3(a, m, opa) : LV_OPA_MIX2(a, m);
+    }
+    return with_opa ? LV_OPA_MIX2(a, opa) : a;
+}
+
+static inline lv_result_t lvgl_rgb565_be_fill(lv_draw_sw_blend_fill_dsc_t *dsc)
+{
+    if (!lvgl_rgb565_be_active) {
+        return LV_RESULT_INVALID;
+    }
+    uint16_t color16 = lv_color_to_u16(dsc->color);
+    uint16_t color_be = lvgl_rgb565_be_swap(color16);
+    const lv_opa_t *mask = dsc->mask_buf;
+    lv_opa_t opa = dsc->opa;
+    uint16_t *dest = dsc->dest_buf;
+    int32_t w = dsc->dest_w;
+
+    if (mask == NULL && opa >= LV_OPA_MAX) {
+        for (int32_t y = 0; y < dsc->dest_h; y++) {
+            for (int32_t x = 0; x < w; x++) {
+                dest[x] = color_be;
+            }
+            dest = lvgl_rgb565_be_next_row(dest, dsc->dest_stride);
+        }
+    } else if (mask == NULL) {
+        // Mostly a translucent fill over a plain background, so remember the last result
+        uint16_t last_dest = dest[0] + 1;
+        uint16_t last_res = 0;
+        for (int32_t y = 0; y < dsc->dest_h; y++) {
+            for (int32_t x = 0; x < w; x++) {
+                if (dest[x] != last_dest) {
+                    last_dest = dest[x];
+                    last_res = lvgl_rgb565_be_swap(lv_color_16_16_mix(color16, lvgl_rgb565_be_swap(last_dest), opa));
+                }
+                dest[x] = last_res;
+            }
+            dest = lvgl_rgb565_be_next_row(dest, dsc->dest_stride);
+        }
+    } else {
+        bool with_opa = opa < LV_OPA_MAX;
+        for (int32_t y = 0; y < dsc->dest_h; y++) {
+            for (int32_t x = 0; x < w; x++) {
+                uint8_t mix = with_opa ? LV_OPA_MIX2(mask[x], opa) : mask[x];
+                if (mix == 255) {
+                    dest[x] = color_be;
+                } else if (mix != 0) {
+                    dest[x] = lvgl_rgb565_be_swap(lv_color_16_16_mix(color16, lvgl_rgb565_be_swap(dest[x]), mix));
+                }
+            }
+            dest = lvgl_rgb565_be_next_row(dest, dsc->dest_stride);
+            mask += dsc->mask_stride;
+        }
+    }
+    return LV_RESULT_OK;
+}
+
+// One variant of an image blend. `COVERAGE` is one of the functions above and gets `ALPHA`,
+// `MIX` converts and mixes a source pixel. Both see the source row in `src` and the source pixel
+// index in `src_x`, `MIX` also gets the native-order destination pixel in `d` and the coverage
+// in `mix`.
+#define LVGL_RGB565_BE_IMAGE_ROWS(dsc, src_t, src_px, with_mask, with_opa, COVERAGE, ALPHA, MIX)                \
+    do {                                                                                                        \
+        const lv_opa_t *mask = (dsc)->mask_buf;                                                                 \
+        uint16_t *dest = (dsc)->dest_buf;                                                                       \
+        const src_t *src = (dsc)->src_buf;                                                                      \
+        for (int32_t y = 0; y < (dsc)->dest_h; y++) {                                                           \
+            for (int32_t x = 0, src_x = 0; x < (dsc)->dest_w; x++, src_x += (src_px)) {                         \
+                uint8_t mix = COVERAGE((ALPHA), (with_mask), (with_opa), (with_mask) ? mask[x] : 255, (dsc)->opa); \
+                if (mix != 0) {                                                                                 \
+                    uint16_t d = lvgl_rgb565_be_swap(dest[x]);                                                  \
+                    dest[x] = lvgl_rgb565_be_swap(MIX);                                                         \
+                }                                                                                               \
+            }                                                                                                   \
+            dest = lvgl_rgb565_be_next_row(dest, (dsc)->dest_stride);                                           \
+            src = lvgl_rgb565_be_next_row(src, (dsc)->src_stride);                                              \
+            if (with_mask) {                                                                                    \
+                mask += (dsc)->mask_stride;                                                                     \
+            }                                                                                                   \
+        }                                                                                                       \
+    } while (0)
+
+#define LVGL_RGB565_BE_IMAGE_BLEND(dsc, src_t, src_px, COVERAGE, ALPHA, MIX)                                    \
+    do {                                                                                                        \
+        if ((dsc)->mask_buf == NULL && (dsc)->opa >= LV_OPA_MAX) {                                              \
+            LVGL_RGB565_BE_IMAGE_ROWS(dsc, src_t, src_px, false, false, COVERAGE, ALPHA, MIX);                  \
+        } else if ((dsc)->mask_buf == NULL) {                                                                   \
+            LVGL_RGB565_BE_IMAGE_ROWS(dsc, src_t, src_px, false, true, COVERAGE, ALPHA, MIX);                   \
+        } else if ((dsc)->opa >= LV_OPA_MAX) {                                                                  \
+            LVGL_RGB565_BE_IMAGE_ROWS(dsc, src_t, src_px, true, false, COVERAGE, ALPHA, MIX);                   \
+        } else {                                                                                                \
+            LVGL_RGB565_BE_IMAGE_ROWS(dsc, src_t, src_px, true, true, COVERAGE, ALPHA, MIX);                    \
+        }                                                                                                       \
+    } while (0)
+
+static inline lv_result_t lvgl_rgb565_be_blend_rgb565(lv_draw_sw_blend_image_dsc_t *dsc)
+{
+    if (!lvgl_rgb565_be_active) {
+        return LV_RESULT_INVALID;
+    }
+    if (dsc->mask_buf == NULL && dsc->opa >= LV_OPA_MAX) {
+        // Both sides are big-endian already
+        const uint16_t *src = dsc->src_buf;
+        uint16_t *dest = dsc->dest_buf;
+        for (int32_t y = 0; y < dsc->dest_h; y++) {
+            lv_memcpy(dest, src, dsc->dest_w * 2);
+            dest = lvgl_rgb565_be_next_row(dest, dsc->dest_stride);
+            src = lvgl_rgb565_be_next_row(src, dsc->src_stride);
+        }
+        return LV_RESULT_OK;
+    }
+    LVGL_RGB565_BE_IMAGE_BLEND(dsc, uint16_t, 1, lvgl_rgb565_be_coverage, 255,
+                               lv_color_16_16_mix(lvgl_rgb565_be_swap(src[src_x]), d, mix));
+    return LV_RESULT_OK;
+}
+
+#if LV_DRAW_SW_SUPPORT_RGB888 || LV_DRAW_SW_SUPPORT_XRGB8888
+static inline lv_result_t lvgl_rgb565_be_blend_rgb888(lv_draw_sw_blend_image_dsc_t *dsc, uint8_t src_px_size)
+{
+    if (!lvgl_rgb565_be_active) {
+        return LV_RESULT_INVALID;
+    }
+    LVGL_RGB565_BE_IMAGE_BLEND(dsc, uint8_t, src_px_size, lvgl_rgb565_be_coverage, 255,
+                               lvgl_rgb565_be_mix_24_16(&src[src_x], d, mix));
+    return LV_RESULT_OK;
+}
+#endif
+
+#if LV_DRAW_SW_SUPPORT_ARGB8888
+static inline lv_result_t lvgl_rgb565_be_blend_argb8888(lv_draw_sw_blend_image_dsc_t *dsc)
+{
+    if (!lvgl_rgb565_be_active) {
+        return LV_RESULT_INVALID;
+    }
+    LVGL_RGB565_BE_IMAGE_BLEND(dsc, uint8_t, 4, lvgl_rgb565_be_coverage_alpha, src[src_x + 3],
+                               lvgl_rgb565_be_mix_24_16(&src[src_x], d, mix));
+    return LV_RESULT_OK;
+}
+#endif
+
+#if LV_DRAW_SW_SUPPORT_L8
+static inline lv_result_t lvgl_rgb565_be_blend_l8(lv_draw_sw_blend_image_dsc_t *dsc)
+{
+    if (!lvgl_rgb565_be_active) {
+        return LV_RESULT_INVALID;
+    }
+    LVGL_RGB565_BE_IMAGE_BLEND(dsc, uint8_t, 1, lvgl_rgb565_be_coverage, 255,
+                               lvgl_rgb565_be_mix_8_16(src[src_x], d, mix));
+    return LV_RESULT_OK;
+}
+#endif
+
+#if LV_DRAW_SW_SUPPORT_AL88
+static inline lv_result_t lvgl_rgb565_be_blend_al88(lv_draw_sw_blend_image_dsc_t *dsc)
+{
+    if (!lvgl_rgb565_be_active) {
+        return LV_RESULT_INVALID;
+    }
+    LVGL_RGB565_BE_IMAGE_BLEND(dsc, lv_color16a_t, 1, lvgl_rgb565_be_coverage_alpha, src[src_x].alpha,
+                               lvgl_rgb565_be_mix_8_16(src[src_x].lumi, d, mix));
+    return LV_RESULT_OK;
+}
+#endif
+
+#if LV_DRAW_SW_SUPPORT_I1
+static inline lv_result_t lvgl_rgb565_be_blend_i1(lv_draw_sw_blend_image_dsc_t *dsc)
+{
+    if (!lvgl_rgb565_be_active) {
+        return LV_RESULT_INVALID;
+    }
+    // src_x counts bits here
+    LVGL_RGB565_BE_IMAGE_BLEND(dsc, uint8_t, 1, lvgl_rgb565_be_coverage, 255,
+                               lvgl_rgb565_be_mix_8_16(((src[src_x / 8] >> (7 - (src_x % 8))) & 1) * 255, d, mix));
+    return LV_RESULT_OK;
+}
+#endif
+
+#define LV_DRAW_SW_COLOR_BLEND_TO_RGB565(dsc)                               lvgl_rgb565_be_fill(dsc)
+#define LV_DRAW_SW_COLOR_BLEND_TO_RGB565_WITH_OPA(dsc)                      lvgl_rgb565_be_fill(dsc)
+#define LV_DRAW_SW_COLOR_BLEND_TO_RGB565_WITH_MASK(dsc)                     lvgl_rgb565_be_fill(dsc)
+#define LV_DRAW_SW_COLOR_BLEND_TO_RGB565_MIX_MASK_OPA(dsc)                  lvgl_rgb565_be_fill(dsc)
+
+#define LV_DRAW_SW_RGB565_BLEND_NORMAL_TO_RGB565(dsc)                       lvgl_rgb565_be_blend_rgb565(dsc)
+#define LV_DRAW_SW_RGB565_BLEND_NORMAL_TO_RGB565_WITH_OPA(dsc)              lvgl_rgb565_be_blend_rgb565(dsc)
+#define LV_DRAW_SW_RGB565_BLEND_NORMAL_TO_RGB565_WITH_MASK(dsc)             lvgl_rgb565_be_blend_rgb565(dsc)
+#define LV_DRAW_SW_RGB565_BLEND_NORMAL_TO_RGB565_MIX_MASK_OPA(dsc)          lvgl_rgb565_be_blend_rgb565(dsc)
+
+#define LV_DRAW_SW_RGB888_BLEND_NORMAL_TO_RGB565(dsc, px_size)              lvgl_rgb565_be_blend_rgb888(dsc, px_size)
+#define LV_DRAW_SW_RGB888_BLEND_NORMAL_TO_RGB565_WITH_OPA(dsc, px_size)     lvgl_rgb565_be_blend_rgb888(dsc, px_size)
+#define LV_DRAW_SW_RGB888_BLEND_NORMAL_TO_RGB565_WITH_MASK(dsc, px_size)    lvgl_rgb565_be_blend_rgb888(dsc, px_size)
+#define LV_DRAW_SW_RGB888_BLEND_NORMAL_TO_RGB565_MIX_MASK_OPA(dsc, px_size) lvgl_rgb565_be_blend_rgb888(dsc, px_size)
+
+#define LV_DRAW_SW_ARGB8888_BLEND_NORMAL_TO_RGB565(dsc)                     lvgl_rgb565_be_blend_argb8888(dsc)
+#define LV_DRAW_SW_ARGB8888_BLEND_NORMAL_TO_RGB565_WITH_OPA(dsc)            lvgl_rgb565_be_blend_argb8888(dsc)
+#define LV_DRAW_SW_ARGB8888_BLEND_NORMAL_TO_RGB565_WITH_MASK(dsc)           lvgl_rgb565_be_blend_argb8888(dsc)
+#define LV_DRAW_SW_ARGB8888_BLEND_NORMAL_TO_RGB565_MIX_MASK_OPA(dsc)        lvgl_rgb565_be_blend_argb8888(dsc)
+
+#define LV_DRAW_SW_L8_BLEND_NORMAL_TO_RGB565(dsc)                           lvgl_rgb565_be_blend_l8(dsc)
+#define LV_DRAW_SW_L8_BLEND_NORMAL_TO_RGB565_WITH_OPA(dsc)                  lvgl_rgb565_be_blend_l8(dsc)
+#define LV_DRAW_SW_L8_BLEND_NORMAL_TO_RGB565_WITH_MASK(dsc)                 lvgl_rgb565_be_blend_l8(dsc)
+#define LV_DRAW_SW_L8_BLEND_NORMAL_TO_RGB565_MIX_MASK_OPA(dsc)              lvgl_rgb565_be_blend_l8(dsc)
+
+#define LV_DRAW_SW_AL88_BLEND_NORMAL_TO_RGB565(dsc)                         lvgl_rgb565_be_blend_al88(dsc)
+#define LV_DRAW_SW_AL88_BLEND_NORMAL_TO_RGB565_WITH_OPA(dsc)                lvgl_rgb565_be_blend_al88(dsc)
+#define LV_DRAW_SW_AL88_BLEND_NORMAL_TO_RGB565_WITH_MASK(dsc)               lvgl_rgb565_be_blend_al88(dsc)
+#define LV_DRAW_SW_AL88_BLEND_NORMAL_TO_RGB565_MIX_MASK_OPA(dsc)            lvgl_rgb565_be_blend_al88(dsc)
+
+#define LV_DRAW_SW_I1_BLEND_NORMAL_TO_RGB565(dsc)                           lvgl_rgb565_be_blend_i1(dsc)
+#define LV_DRAW_SW_I1_BLEND_NORMAL_TO_RGB565_WITH_OPA(dsc)                  lvgl_rgb565_be_blend_i1(dsc)
+#define LV_DRAW_SW_I1_BLEND_NORMAL_TO_RGB565_WITH_MASK(dsc)                 lvgl_rgb565_be_blend_i1(dsc)
+#define LV_DRAW_SW_I1_BLEND_NORMAL_TO_RGB565_MIX_MASK_OPA(dsc)              lvgl_rgb565_be_blend_i1(dsc)
+
+#endif
+
+#endif
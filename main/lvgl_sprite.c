@@ -0,0 +1,422 @@
+#include <string.h>
+#include "lvgl_sprite.h"
+#include "lvgl_rgb565_be.h"
+#include "sdkconfig.h"
+#include "src/core/lv_obj_private.h"
+#include "src/core/lv_obj_style_private.h"
+#include "src/core/lv_obj_draw_private.h"
+#include "src/core/lv_refr_private.h"
+#include "src/display/lv_display_private.h"
+#include "src/draw/lv_draw_private.h"
+
+#define SPRITE_POOL_BYTES   (CONFIG_DV8_SPRITE_CACHE_KB * 1024)
+// Every object can hold its LVGL_SPRITE_MAX_LOOKS, so there is always a free entry
+#define SPRITE_MAX_ENTRIES  (LVGL_SPRITE_MAX_OBJECTS * LVGL_SPRITE_MAX_LOOKS)
+// Looks rendered once that an object remembers, a look that cycles back within this many
+// others is captured
+#define SPRITE_SEEN         LVGL_SPRITE_MAX_LOOKS
+
+typedef struct {
+    lv_obj_t *obj;          // NULL for a free slot
+    uint32_t seen[SPRITE_SEEN];     // keys, 0 for none
+    uint8_t seen_next;
+    uint8_t looks;
+    bool blitted;           // its last DRAW_MAIN drew a captured look, the children skip theirs
+    bool pending;           // sprite_frame_cb queued
+} sprite_obj_t;
+
+typedef struct {
+    sprite_obj_t *owner;    // NULL for a free entry
+    uint32_t key;
+    uint32_t offset;        // into pool
+    uint32_t size;
+    uint32_t last_used;
+    bool big_endian;        // rendered by the hooks of lvgl_rgb565_be.h
+    lv_draw_buf_t buf;      // over the pixels in pool, the image drawn on a hit
+} sprite_entry_t;
+
+// Captured looks are packed from the start of the pool in no particular order, and a dropped
+// one is closed up right away, so the free space is always the tail
+static uint32_t pool[(SPRITE_POOL_BYTES > 0 ? SPRITE_POOL_BYTES : 4) / 4];
+static uint32_t pool_used;
+
+static sprite_obj_t objects[LVGL_SPRITE_MAX_OBJECTS];
+static sprite_entry_t entries[SPRITE_MAX_ENTRIES];
+static uint32_t use_clock;
+static bool capturing;
+static bool enabled = true;
+static lvgl_sprite_stats_t stats = { .pool_bytes = SPRITE_POOL_BYTES };
+
+
+static uint32_t fnv1a(uint32_t hash, const void *data, size_t len)
+{
+    const uint8_t *bytes = data;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// What the object draws to, its shadow and outline included
+static void sprite_area(lv_obj_t *obj, lv_area_t *area)
+{
+    int32_t ext = lv_obj_get_ext_draw_size(obj);
+    lv_obj_get_coords(obj, area);
+    lv_area_increase(area, ext, ext);
+}
+
+static bool sprite_in_transition(const lv_obj_t *obj)
+{
+    for (uint32_t i = 0; i < obj->style_cnt; i++) {
+        if (obj->styles[i].is_trans) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Whether the object draws right now what a capture of it would show
+static bool sprite_cacheable(lv_obj_t *obj)
+{
+    lv_obj_t *parent = lv_obj_get_parent(obj);
+    if (parent == NULL || lv_obj_get_layer_type(obj) != LV_LAYER_TYPE_NONE || sprite_in_transition(obj)) {
+        return false;
+    }
+    if (lv_display_get_color_format(lv_obj_get_display(obj)) != LV_COLOR_FORMAT_RGB565) {
+        return false;
+    }
+    if (lv_obj_get_style_bg_opa(parent, LV_PART_MAIN) < LV_OPA_MAX ||
+        lv_obj_get_style_bg_grad_dir(parent, LV_PART_MAIN) != LV_GRAD_DIR_NONE ||
+        lv_obj_get_style_bg_image_src(parent, LV_PART_MAIN) != NULL) {
+        return false;
+    }
+
+    uint32_t count = lv_obj_get_child_count(obj);
+    for (uint32_t i = 0; i < count; i++) {
+        lv_obj_t *child = lv_obj_get_child(obj, i);
+        if (lv_obj_get_layer_type(child) != LV_LAYER_TYPE_NONE || sprite_in_transition(child)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Hash of a draw descriptor without its base, which only says who is drawing. The descriptors
+// start zeroed, so the padding hashes the same every time.
+#define SPRITE_HASH_DSC(hash, dsc) \
+    fnv1a((hash), (const uint8_t *)&(dsc) + sizeof((dsc).base), sizeof(dsc) - sizeof((dsc).base))
+
+// Everything the object's and its children's draws read, resolved, so that another state, style,
+// theme or text is another key. Never 0.
+static uint32_t sprite_key(lv_obj_t *obj, const lv_area_t *area)
+{
+    int32_t size[2] = { lv_area_get_width(area), lv_area_get_height(area) };
+    uint32_t bg = lv_color_to_u32(lv_obj_get_style_bg_color(lv_obj_get_parent(obj), LV_PART_MAIN));
+    lv_draw_rect_dsc_t rect;
+    lv_draw_rect_dsc_init(&rect);
+    lv_obj_init_draw_rect_dsc(obj, LV_PART_MAIN, &rect);
+
+    uint32_t hash = fnv1a(2166136261u, size, sizeof(size));
+    hash = fnv1a(hash, &bg, sizeof(bg));
+    hash = SPRITE_HASH_DSC(hash, rect);
+
+    uint32_t count = lv_obj_get_child_count(obj);
+    for (uint32_t i = 0; i < count; i++) {
+        lv_obj_t *child = lv_obj_get_child(obj, i);
+        int32_t place[3] = {
+            lv_obj_get_x(child), lv_obj_get_y(child), lv_obj_has_flag(child, LV_OBJ_FLAG_HIDDEN),
+        };
+        hash = fnv1a(hash, place, sizeof(place));
+        lv_draw_rect_dsc_init(&rect);
+        lv_obj_init_draw_rect_dsc(child, LV_PART_MAIN, &rect);
+        hash = SPRITE_HASH_DSC(hash, rect);
+        if (lv_obj_check_type(child, &lv_label_class)) {
+            lv_draw_label_dsc_t label;
+            lv_draw_label_dsc_init(&label);
+            lv_obj_init_draw_label_dsc(child, LV_PART_MAIN, &label);
+            hash = SPRITE_HASH_DSC(hash, label);
+            const char *text = lv_label_get_text(child);
+            hash = fnv1a(hash, text, strlen(text) + 1);
+        }
+    }
+    return hash != 0 ? hash : 1;
+}
+
+static sprite_entry_t *sprite_find(const sprite_obj_t *so, uint32_t key)
+{
+    for (int i = 0; i < SPRITE_MAX_ENTRIES; i++) {
+        if (entries[i].owner == so && entries[i].key == key) {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+// Least recently drawn look of `so`, or of any object if NULL
+static sprite_entry_t *sprite_oldest(const sprite_obj_t *so)
+{
+    sprite_entry_t *oldest = NULL;
+    for (int i = 0; i < SPRITE_MAX_ENTRIES; i++) {
+        sprite_entry_t *entry = &entries[i];
+        if (entry->owner != NULL && (so == NULL || entry->owner == so) &&
+            (oldest == NULL || (int32_t)(entry->last_used - oldest->last_used) < 0)) {
+            oldest = entry;
+        }
+    }
+    return oldest;
+}
+
+// Free the entry and move the looks behind it down over its pixels. Only ever called between
+// refreshes, so no draw task still points at pixels that move.
+static void sprite_drop(sprite_entry_t *entry)
+{
+    uint8_t *base = (uint8_t *)pool;
+    uint32_t end = entry->offset + entry->size;
+
+    memmove(base + entry->offset, base + end, pool_used - end);
+    for (int i = 0; i < SPRITE_MAX_ENTRIES; i++) {
+        sprite_entry_t *moved = &entries[i];
+        if (moved->owner != NULL && moved->offset > entry->offset) {
+            moved->offset -= entry->size;
+            moved->buf.data = moved->buf.unaligned_data = base + moved->offset;
+            lv_image_cache_drop(&moved->buf);
+        }
+    }
+    pool_used -= entry->size;
+
+    // The image cache keys on the source address, which the next look in this entry reuses
+    lv_image_cache_drop(&entry->buf);
+    entry->owner->looks--;
+    stats.looks--;
+    stats.bytes -= entry->size;
+    entry->owner = NULL;
+}
+
+static void sprite_invalidate(sprite_obj_t *so)
+{
+    for (int i = 0; i < SPRITE_MAX_ENTRIES; i++) {
+        if (entries[i].owner == so) {
+            sprite_drop(&entries[i]);
+        }
+    }
+    memset(so->seen, 0, sizeof(so->seen));
+}
+
+// Render the object as it is now into a new entry for `key`, over its parent's background
+static void sprite_capture(sprite_obj_t *so, uint32_t key, const lv_area_t *area)
+{
+    int32_t w = lv_area_get_width(area);
+    int32_t h = lv_area_get_height(area);
+    uint32_t stride = lv_draw_buf_width_to_stride(w, LV_COLOR_FORMAT_RGB565);
+    uint32_t size = (stride * h + 3) & ~3u;
+    if (size > SPRITE_POOL_BYTES) {
+        return;
+    }
+
+    // Make room: the object's own least recently drawn look first, then anyone's
+    if (so->looks >= LVGL_SPRITE_MAX_LOOKS) {
+        sprite_drop(sprite_oldest(so));
+        stats.evictions++;
+    }
+    while (pool_used + size > SPRITE_POOL_BYTES) {
+        sprite_drop(sprite_oldest(NULL));
+        stats.evictions++;
+    }
+    sprite_entry_t *entry = NULL;
+    for (int i = 0; entry == NULL && i < SPRITE_MAX_ENTRIES; i++) {
+        entry = entries[i].owner == NULL ? &entries[i] : NULL;
+    }
+
+    entry->owner = so;
+    entry->key = key;
+    entry->offset = pool_used;
+    entry->size = size;
+    entry->last_used = ++use_clock;
+    entry->big_endian = lvgl_rgb565_be_active;
+    lv_draw_buf_init(&entry->buf, w, h, LV_COLOR_FORMAT_RGB565, stride, (uint8_t *)pool + entry->offset, size);
+    pool_used += size;
+    so->looks++;
+    stats.looks++;
+    stats.bytes += size;
+    stats.captures++;
+
+    lv_layer_t layer;
+    lv_memzero(&layer, sizeof(layer));
+    layer.draw_buf = &entry->buf;
+    layer.buf_area = *area;
+    layer.color_format = LV_COLOR_FORMAT_RGB565;
+    layer._clip_area = *area;
+    layer.phy_clip_area = *area;
+#if LV_DRAW_TRANSFORM_USE_MATRIX
+    lv_matrix_identity(&layer.matrix);
+#endif
+
+    // What lv_snapshot_take_to_draw_buf() does (LV_USE_SNAPSHOT is off), except that the buffer
+    // starts as the parent's background instead of transparent
+    lv_display_t *disp = lv_obj_get_display(so->obj);
+    lv_display_t *disp_old = lv_refr_get_disp_refreshing();
+    lv_layer_t *layer_old = disp->layer_head;
+    disp->layer_head = &layer;
+    lv_refr_set_disp_refreshing(disp);
+
+    lv_draw_rect_dsc_t bg;
+    lv_draw_rect_dsc_init(&bg);
+    bg.bg_color = lv_obj_get_style_bg_color(lv_obj_get_parent(so->obj), LV_PART_MAIN);
+    bg.bg_opa = LV_OPA_COVER;
+    lv_draw_rect(&layer, &bg, area);
+
+    capturing = true;
+    lv_obj_redraw(&layer, so->obj);
+    capturing = false;
+    while (layer.draw_task_head) {
+        lv_draw_dispatch_wait_for_request();
+        lv_draw_dispatch();
+    }
+
+    disp->layer_head = layer_old;
+    lv_refr_set_disp_refreshing(disp_old);
+}
+
+// After a frame that rendered the object: capture its look if this was the second time
+static void sprite_frame_cb(void *user_data)
+{
+    sprite_obj_t *so = user_data;
+    so->pending = false;
+
+    lv_obj_update_layout(so->obj);
+    if (!enabled || !sprite_cacheable(so->obj)) {
+        return;
+    }
+    lv_area_t area;
+    sprite_area(so->obj, &area);
+    uint32_t key = sprite_key(so->obj, &area);
+    if (sprite_find(so, key) != NULL) {
+        return;
+    }
+
+    for (int i = 0; i < SPRITE_SEEN; i++) {
+        if (so->seen[i] == key) {
+            so->seen[i] = 0;
+            sprite_capture(so, key, &area);
+            return;
+        }
+    }
+    so->seen[so->seen_next] = key;
+    so->seen_next = (so->seen_next + 1) % SPRITE_SEEN;
+}
+
+// Before the class draws the object: draw the captured look instead, if there is one
+static void sprite_draw_cb(lv_event_t *e)
+{
+    sprite_obj_t *so = lv_event_get_user_data(e);
+    if (capturing) {
+        return;
+    }
+    so->blitted = false;
+    if (!enabled) {
+        return;
+    }
+    if (!sprite_cacheable(so->obj)) {
+        stats.bypassed++;
+        return;
+    }
+
+    lv_area_t area;
+    sprite_area(so->obj, &area);
+    sprite_entry_t *entry = sprite_find(so, sprite_key(so->obj, &area));
+    if (entry != NULL && entry->big_endian != lvgl_rgb565_be_active) {
+        // A refresh lvgl_rgb565_be.h renders natively, the copy would come out byte-swapped
+        stats.bypassed++;
+        return;
+    }
+    if (entry == NULL) {
+        stats.misses++;
+        if (!so->pending) {
+            so->pending = true;
+            lv_async_call(sprite_frame_cb, so);
+        }
+        return;
+    }
+
+    stats.hits++;
+    entry->last_used = ++use_clock;
+    lv_draw_image_dsc_t dsc;
+    lv_draw_image_dsc_init(&dsc);
+    dsc.src = &entry->buf;
+    lv_draw_image(lv_event_get_layer(e), &dsc, &area);
+    so->blitted = true;
+    lv_event_stop_processing(e);
+}
+
+// The children are in the captured look already
+static void sprite_child_draw_cb(lv_event_t *e)
+{
+    sprite_obj_t *so = lv_event_get_user_data(e);
+    if (so->blitted && !capturing) {
+        lv_event_stop_processing(e);
+    }
+}
+
+static void sprite_delete_cb(lv_event_t *e)
+{
+    sprite_obj_t *so = lv_event_get_user_data(e);
+    sprite_invalidate(so);
+    if (so->pending) {
+        lv_async_call_cancel(sprite_frame_cb, so);
+    }
+    memset(so, 0, sizeof(*so));
+}
+
+bool lvgl_sprite_attach(lv_obj_t *obj)
+{
+    if (SPRITE_POOL_BYTES == 0) {
+        return false;
+    }
+    sprite_obj_t *so = NULL;
+    for (int i = 0; so == NULL && i < LVGL_SPRITE_MAX_OBJECTS; i++) {
+        so = objects[i].obj == NULL ? &objects[i] : NULL;
+    }
+    if (so == NULL) {
+        return false;
+    }
+
+    // The steps of a style transition are all rendered and none is worth a capture. Drop the
+    // styles that only carry a transition (the theme's), so a look switches in one copy.
+    for (uint32_t i = obj->style_cnt; i-- > 0;) {
+        const lv_obj_style_t *style = &obj->styles[i];
+        lv_style_value_t value;
+        if (!style->is_local && !style->is_trans && style->style->prop_cnt == 1 &&
+            lv_style_get_prop(style->style, LV_STYLE_TRANSITION, &value) == LV_STYLE_RES_FOUND) {
+            lv_obj_remove_style(obj, (lv_style_t *)style->style, style->selector);
+        }
+    }
+
+    so->obj = obj;
+    // Preprocess callbacks run before the class draws, and can stop it
+    lv_obj_add_event_cb(obj, sprite_draw_cb, LV_EVENT_DRAW_MAIN | LV_EVENT_PREPROCESS, so);
+    lv_obj_add_event_cb(obj, sprite_delete_cb, LV_EVENT_DELETE, so);
+    uint32_t count = lv_obj_get_child_count(obj);
+    for (uint32_t i = 0; i < count; i++) {
+        lv_obj_add_event_cb(lv_obj_get_child(obj, i), sprite_child_draw_cb, LV_EVENT_DRAW_MAIN | LV_EVENT_PREPROCESS, so);
+    }
+    return true;
+}
+
+void lvgl_sprite_invalidate(lv_obj_t *obj)
+{
+    for (int i = 0; i < LVGL_SPRITE_MAX_OBJECTS; i++) {
+        if (objects[i].obj != NULL && (obj == NULL || objects[i].obj == obj)) {
+            sprite_invalidate(&objects[i]);
+        }
+    }
+}
+
+void lvgl_sprite_set_enabled(bool enable)
+{
+    enabled = enable;
+}
+
+void lvgl_sprite_get_stats(lvgl_sprite_stats_t *out)
+{
+    *out = stats;
+}
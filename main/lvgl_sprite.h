@@ -0,0 +1,58 @@
+#ifndef LVGL_SPRITE_H
+#define LVGL_SPRITE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "lvgl.h"
+
+/*
+ * Pre-rendered looks for small widgets that flip between a few fixed looks, like the status
+ * buttons and their blink.
+ *
+ * An attached object is keyed by what its draw and its children's draws read, resolved: the
+ * rectangle and label draw descriptors, child positions, label texts, the size and the parent's
+ * background color. A look that had to be rendered a second time is captured after that frame
+ * into an RGB565 buffer from a static pool of CONFIG_DV8_SPRITE_CACHE_KB. From then on the
+ * object's draw is one image draw of that buffer, a memcpy per row, instead of the rectangle,
+ * shadow and label. Looks rendered only once, like a battery reading that moved on, never take
+ * pool space.
+ *
+ * Another state, style or theme is another key, so a stale look is never drawn; looks nobody
+ * draws anymore are the first to be evicted, and lvgl_sprite_invalidate() frees them at once,
+ * e.g. after switching themes.
+ *
+ * The capture is composited onto the parent's background color, so the object must sit on its
+ * parent's plain opaque background with no siblings under it. Frames with a style transition
+ * running, a layer (opa, transform, blend mode) or a parent gradient or image are rendered
+ * normally and not captured, and so are refreshes rendered in the other byte order than the look
+ * (lvgl_rgb565_be.h); attaching drops the object's transition-only styles (the theme's
+ * fade) so looks switch in one copy. Children must look the same for the same descriptors and
+ * text, no scrolling labels, and must exist when the object is attached. Everything here runs on
+ * the LVGL task, with lvgl_api_lock held.
+ */
+
+#define LVGL_SPRITE_MAX_OBJECTS     8
+#define LVGL_SPRITE_MAX_LOOKS       4       // per object, its least recently drawn one goes first
+
+typedef struct {
+    uint32_t hits;          // draws that were one image copy
+    uint32_t misses;        // draws rendered for lack of a captured look
+    uint32_t bypassed;      // draws rendered because the look can't be captured right now
+    uint32_t captures;
+    uint32_t evictions;     // looks dropped to make room, invalidations not included
+    uint32_t looks;         // captured looks held now
+    uint32_t bytes;         // of the pool they take
+    uint32_t pool_bytes;
+} lvgl_sprite_stats_t;
+
+// Cache the looks of `obj` from now on. Returns false if the pool is 0 bytes or
+// LVGL_SPRITE_MAX_OBJECTS are attached already. Deleting the object detaches it.
+extern bool lvgl_sprite_attach(lv_obj_t *obj);
+// Drop the captured looks of `obj`, or of every attached object if NULL
+extern void lvgl_sprite_invalidate(lv_obj_t *obj);
+// Render attached objects normally while disabled, for comparing the two. Enabled by default.
+extern void lvgl_sprite_set_enabled(bool enabled);
+// Counters since boot, read without the lock like lvgl_get_update_stats()
+extern void lvgl_sprite_get_stats(lvgl_sprite_stats_t *stats);
+
+#endif
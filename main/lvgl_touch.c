@@ -0,0 +1,37 @@
+#include "lvgl_touch.h"
+#include "dv8_touch.h"
+
+static lv_indev_t *touch_indev;
+
+
+static void lvgl_touch_read_cb(lv_indev_t *indev, lv_indev_data_t *data)
+{
+    dv8_touch_event_t event;
+    // Nothing queued (LVGL's own reads while pressed) gives the latest state
+    dv8_touch_pop(&event);
+    data->point.x = event.x;
+    data->point.y = event.y;
+    data->state = event.pressed ? LV_INDEV_STATE_PRESSED : LV_INDEV_STATE_RELEASED;
+}
+
+lv_indev_t *lvgl_touch_create(lv_display_t *disp)
+{
+    touch_indev = lv_indev_create();
+    lv_indev_set_type(touch_indev, LV_INDEV_TYPE_POINTER);
+    lv_indev_set_read_cb(touch_indev, lvgl_touch_read_cb);
+    lv_indev_set_display(touch_indev, disp);
+    lv_indev_set_mode(touch_indev, LV_INDEV_MODE_EVENT);
+    return touch_indev;
+}
+
+void lvgl_touch_read(void)
+{
+    // One event per read in event mode. Bounded, lv_indev_read() returns without reading while
+    // a screen load animation runs.
+    for (int i = 0; i < DV8_TOUCH_QUEUE_SIZE; i++) {
+        lv_indev_read(touch_indev);
+        if (!dv8_touch_pending()) {
+            break;
+        }
+    }
+}
@@ -0,0 +1,19 @@
+#ifndef LVGL_TOUCH_H
+#define LVGL_TOUCH_H
+
+#include "lvgl.h"
+
+/*
+ * Pointer input device fed by dv8_touch. The indev runs in LV_INDEV_MODE_EVENT, so LVGL has no
+ * read timer polling it while nothing is touched; the touch task posts LVGL_CMD_TOUCH after
+ * queuing events and the LVGL task calls lvgl_touch_read() for it. While a finger is down LVGL
+ * resumes its read timer by itself for long press and scrolling, which then reads the latest
+ * state. Rotation is LVGL's, events carry unrotated panel pixels.
+ */
+
+// Must be called with lvgl_api_lock held
+extern lv_indev_t *lvgl_touch_create(lv_display_t *disp);
+// LVGL task, lvgl_api_lock held: hand LVGL everything dv8_touch queued
+extern void lvgl_touch_read(void);
+
+#endif
@@ -0,0 +1,154 @@
+#include <math.h>
+#include "sdkconfig.h"
+#include "dv8_history.h"
+#include "dv8_state.h"
+#include "lvgl_trend.h"
+
+#define TREND_FONT          (&lv_font_montserrat_12)
+// Chart units: tenths of a percent, hundredths of m/s and rad/s
+#define BATTERY_SCALE       10
+#define CMD_VEL_SCALE       100
+#define CMD_VEL_RANGE       100     // +-1.0 on the chart, anything faster is clipped
+
+// One min/max pair of series per charted field
+typedef struct {
+    dv8_field_t field;
+    lv_obj_t **chart;
+    int32_t scale;
+    lv_chart_series_t *min;
+    lv_chart_series_t *max;
+} trend_trace_t;
+
+static lv_obj_t *status_scr;
+static lv_obj_t *trend_scr;
+static lv_obj_t *battery_chart;
+static lv_obj_t *cmd_vel_chart;
+static int64_t (*clock_now_us)(void);
+static bool showing_trend = false;
+static uint32_t page_elapsed_ms = 0;
+
+static trend_trace_t traces[] = {
+    { .field = DV8_FIELD_BATTERY_PERCENTAGE, .chart = &battery_chart, .scale = BATTERY_SCALE },
+    { .field = DV8_FIELD_LINEAR_X, .chart = &cmd_vel_chart, .scale = CMD_VEL_SCALE },
+    { .field = DV8_FIELD_ANGULAR_Z, .chart = &cmd_vel_chart, .scale = CMD_VEL_SCALE },
+};
+
+
+static int32_t chart_value(float value, int32_t scale)
+{
+    return (int32_t)lroundf(value * scale);
+}
+
+// Write the next point of a series and blank the one after it, which is the oldest on screen.
+// lv_chart_set_next_value() invalidates just those two points in circular mode.
+static void push_point(lv_obj_t *chart, lv_chart_series_t *ser, int32_t value)
+{
+    lv_chart_set_next_value(chart, ser, value);
+    lv_chart_get_y_array(chart, ser)[lv_chart_get_x_start_point(chart, ser)] = LV_CHART_POINT_NONE;
+}
+
+// Append the `count` newest columns of every trace, oldest first
+static void push_columns(uint32_t count)
+{
+    for (size_t i = 0; i < sizeof(traces) / sizeof(traces[0]); i++) {
+        trend_trace_t *trace = &traces[i];
+        for (uint32_t age = count; age-- > 0;) {
+            dv8_history_column_t column;
+            if (dv8_history_get(trace->field, age, &column)) {
+                push_point(*trace->chart, trace->min, chart_value(column.min, trace->scale));
+                push_point(*trace->chart, trace->max, chart_value(column.max, trace->scale));
+            } else {
+                push_point(*trace->chart, trace->min, LV_CHART_POINT_NONE);
+                push_point(*trace->chart, trace->max, LV_CHART_POINT_NONE);
+            }
+        }
+    }
+}
+
+static void history_timer_cb(lv_timer_t *timer)
+{
+    uint32_t closed = dv8_history_advance(clock_now_us());
+    if (closed > 0) {
+        push_columns(closed);
+    }
+}
+
+void lvgl_trend_show(bool show)
+{
+    if (show != showing_trend) {
+        lv_screen_load(show ? trend_scr : status_scr);
+        showing_trend = show;
+    }
+    page_elapsed_ms = 0;
+}
+
+#if CONFIG_DV8_TREND_PAGE_MS > 0
+#define PAGE_TIMER_MS 250
+
+static void page_timer_cb(lv_timer_t *timer)
+{
+    dv8_robot_state_t state;
+    dv8_state_read(&state);
+    page_elapsed_ms += PAGE_TIMER_MS;
+
+    // A stopped robot is what the panel is for, keep the buttons up
+    if (state.e_stop == 1 || state.handbrake == 1) {
+        lvgl_trend_show(false);
+    } else if (page_elapsed_ms >= (showing_trend ? CONFIG_DV8_TREND_PAGE_MS : CONFIG_DV8_STATUS_PAGE_MS)) {
+        lvgl_trend_show(!showing_trend);
+    }
+}
+#endif
+
+static lv_obj_t *chart_create(lv_obj_t *parent, const char *title, int32_t y, int32_t height, int32_t min, int32_t max)
+{
+    lv_obj_t *lbl = lv_label_create(parent);
+    lv_obj_set_style_text_font(lbl, TREND_FONT, 0);
+    lv_label_set_text_static(lbl, title);
+    lv_obj_set_pos(lbl, 2, y);
+
+    lv_obj_t *chart = lv_chart_create(parent);
+    lv_obj_set_pos(chart, 0, y + lv_font_get_line_height(TREND_FONT));
+    lv_obj_set_size(chart, LV_PCT(100), height);
+    lv_obj_set_style_pad_all(chart, 2, 0);
+    lv_obj_set_style_radius(chart, 0, 0);
+    lv_obj_set_style_size(chart, 0, 0, LV_PART_INDICATOR);     // lines only, no point markers
+    lv_obj_set_style_line_width(chart, 1, LV_PART_ITEMS);
+    lv_chart_set_type(chart, LV_CHART_TYPE_LINE);
+    lv_chart_set_update_mode(chart, LV_CHART_UPDATE_MODE_CIRCULAR);
+    lv_chart_set_point_count(chart, DV8_HISTORY_COLUMNS);
+    lv_chart_set_range(chart, LV_CHART_AXIS_PRIMARY_Y, min, max);
+    lv_chart_set_div_line_count(chart, 3, 0);
+    return chart;
+}
+
+void lvgl_trend_ui(lv_display_t *disp, int64_t (*now_us)(void))
+{
+    int32_t height = lv_display_get_vertical_resolution(disp);
+    int32_t title_height = lv_font_get_line_height(TREND_FONT);
+    int32_t chart_height = height / 2 - title_height;
+
+    status_scr = lv_display_get_screen_active(disp);
+    trend_scr = lv_obj_create(NULL);
+    clock_now_us = now_us;
+
+    battery_chart = chart_create(trend_scr, "Battery %", 0, chart_height, 0, 100 * BATTERY_SCALE);
+    cmd_vel_chart = chart_create(trend_scr, "linear_x / angular_z", height / 2, chart_height,
+                                 -CMD_VEL_RANGE, CMD_VEL_RANGE);
+
+    // Same palette as the status buttons, BGR
+    lv_color_t green = lv_color_make(100, 180, 30);
+    lv_color_t blue = lv_color_make(200, 170, 60);
+    lv_color_t red = lv_color_make(0, 0, 255);
+    lv_color_t colors[] = { green, blue, red };
+    for (size_t i = 0; i < sizeof(traces) / sizeof(traces[0]); i++) {
+        traces[i].min = lv_chart_add_series(*traces[i].chart, colors[i], LV_CHART_AXIS_PRIMARY_Y);
+        traces[i].max = lv_chart_add_series(*traces[i].chart, colors[i], LV_CHART_AXIS_PRIMARY_Y);
+    }
+
+    dv8_history_advance(clock_now_us());
+    lv_timer_create(history_timer_cb, CONFIG_DV8_HISTORY_COLUMN_MS, NULL);
+#if CONFIG_DV8_TREND_PAGE_MS > 0
+    lv_timer_create(page_timer_cb, PAGE_TIMER_MS, NULL);
+#endif
+}
@@ -0,0 +1,24 @@
+#ifndef LVGL_TREND_H
+#define LVGL_TREND_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "lvgl.h"
+
+/*
+ * Trend page: battery level and cmd_vel (linear_x, angular_z) over the last DV8_HISTORY_COLUMNS
+ * columns of dv8_history, drawn as min/max envelopes. The charts run in circular mode: each
+ * closed column overwrites the oldest point behind a one point gap, so a new sample redraws a
+ * couple of pixel columns whatever the history length.
+ *
+ * The page alternates with the status buttons, CONFIG_DV8_STATUS_PAGE_MS of status then
+ * CONFIG_DV8_TREND_PAGE_MS of trends, but never while the e-stop or handbrake is on.
+ */
+
+// Create the page next to the active screen of `disp` (the status buttons). `now_us` is the clock
+// the messages are stamped with, as for lvgl_set_clock(). Must be called with lvgl_api_lock held.
+extern void lvgl_trend_ui(lv_display_t *disp, int64_t (*now_us)(void));
+// Switch to the trend page or back to the status buttons now
+extern void lvgl_trend_show(bool show);
+
+#endif
@@ -7,21 +7,21 @@
 // This demo UI is adapted from LVGL official example: https://docs.lvgl.io/master/examples.html#loader-with-arc
 
 #include "lvgl.h"
-#include "esp_log.h"
+#include <math.h>
 #include <stdbool.h>
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
+#include "dv8_state.h"
+#include "dv8_latency.h"
+#include "dv8_stale.h"
+#include "lvgl_ui.h"
+#include "lvgl_blink.h"
+#include "lvgl_numlabel.h"
+#include "lvgl_sprite.h"
 
-
-// Access global variable from main.c
-extern _lock_t lvgl_api_lock;
-extern float battery_percentage;
-extern int battery_is_charging;
-extern int e_stop;
-extern int handbrake;
-extern int direct_status;      // 0 or 1 for autonomous
-extern int safety_mode;
-extern int robot_mode;      // 1-Idle, 2-Coverage, 3-Litter Picking, 4-Switching
+#define BLINK_PERIOD_MS 1000
+// Subject value of a field that expired in dv8_stale, no real value maps to it
+#define FIELD_STALE INT32_MIN
+// Button showing a value from before this boot; the default theme greys disabled buttons out
+#define CACHED_STATE LV_STATE_DISABLED
 
 
 // styles
@@ -32,25 +32,89 @@ static lv_style_t style_blue;
 static bool styles_initialized = false;     //battery
 
 
-// objects
-static lv_obj_t * btn_e_stop = NULL;
-static lv_obj_t * lbl_e_stop = NULL;
-static lv_obj_t * btn_handbrake = NULL;
-static lv_obj_t * lbl_handbrake = NULL;
-static lv_obj_t * btn_autonomous = NULL;
-static lv_obj_t * lbl_autonomous = NULL;
-static lv_obj_t * btn_safety_mode = NULL;
-static lv_obj_t * lbl_safety_mode = NULL;
-static lv_obj_t * btn_robot_mode = NULL;
-static lv_obj_t * lbl_robot_mode = NULL;
-static lv_obj_t * btn_battery = NULL;
-static lv_obj_t * lbl_battery_percentage = NULL;
-
+// Visual states of a status button. Each maps to an object state with its style attached
+// once at creation, so switching is an lv_obj_add_state/remove_state and no style churn.
+typedef enum {
+    VISUAL_UNKNOWN = 0,     // default state
+    VISUAL_NORMAL,
+    VISUAL_WARNING,
+    VISUAL_BLUE,
+} ui_visual_t;
+
+static const lv_state_t visual_states[] = {
+    [VISUAL_UNKNOWN] = LV_STATE_DEFAULT,
+    [VISUAL_NORMAL] = LV_STATE_USER_1,
+    [VISUAL_WARNING] = LV_STATE_USER_2,
+    [VISUAL_BLUE] = LV_STATE_USER_3,
+};
+
+// A status button that remembers what it last rendered, so updates only apply the delta
+typedef struct {
+    lv_obj_t *btn;
+    lv_obj_t *lbl;
+    ui_visual_t visual;
+    const char *text;       // static string currently shown by lbl
+    bool blinking;
+} ui_indicator_t;
 
-// Blink stuff
-static TaskHandle_t battery_flash_task_handle = NULL;
-static TaskHandle_t litter_picking_flash_task_handle = NULL;
 
+// objects
+static ui_indicator_t ind_e_stop;
+static ui_indicator_t ind_handbrake;
+static ui_indicator_t ind_autonomous;
+static ui_indicator_t ind_safety_mode;
+static ui_indicator_t ind_robot_mode;
+static ui_indicator_t ind_battery;
+static lvgl_numlabel_t battery_readout;    // "Battery: 82.5%" from tenths of a percent
+
+
+// Observable copies of the robot state, one per displayed field
+static lv_subject_t subject_battery_percentage;     // tenths of a percent
+static lv_subject_t subject_battery_is_charging;
+static lv_subject_t subject_e_stop;
+static lv_subject_t subject_handbrake;
+static lv_subject_t subject_direct_status;     // 0 or 1 for autonomous
+static lv_subject_t subject_safety_mode;
+static lv_subject_t subject_robot_mode;     // 1-Idle, 2-Coverage, 3-Litter Picking, 4-Switching
+
+// Fields without a widget stay NULL and are always skipped
+static lv_subject_t *field_subjects[DV8_FIELD_COUNT] = {
+    [DV8_FIELD_BATTERY_PERCENTAGE] = &subject_battery_percentage,
+    [DV8_FIELD_BATTERY_IS_CHARGING] = &subject_battery_is_charging,
+    [DV8_FIELD_E_STOP] = &subject_e_stop,
+    [DV8_FIELD_HANDBRAKE] = &subject_handbrake,
+    [DV8_FIELD_DIRECT_STATUS] = &subject_direct_status,
+    [DV8_FIELD_SAFETY_MODE] = &subject_safety_mode,
+    [DV8_FIELD_ROBOT_MODE] = &subject_robot_mode,
+};
+
+// The button each field is shown on, for the cached look. The battery button goes by the
+// percentage alone, like its stale look.
+static ui_indicator_t *const field_indicators[DV8_FIELD_COUNT] = {
+    [DV8_FIELD_BATTERY_PERCENTAGE] = &ind_battery,
+    [DV8_FIELD_E_STOP] = &ind_e_stop,
+    [DV8_FIELD_HANDBRAKE] = &ind_handbrake,
+    [DV8_FIELD_DIRECT_STATUS] = &ind_autonomous,
+    [DV8_FIELD_SAFETY_MODE] = &ind_safety_mode,
+    [DV8_FIELD_ROBOT_MODE] = &ind_robot_mode,
+};
+
+// Snapshot the UI was last brought up to date with
+static dv8_robot_state_t shown_state;
+// Fields of shown_state that came from dv8_state_cache and haven't been received since
+static uint32_t cached_fields = 0;
+
+// Clock the receive stamps are taken with, NULL keeps every field shown forever
+static int64_t (*clock_now_us)(void) = NULL;
+// Runs dv8_stale_expire() when the next deadline is due, paused while there is none
+static lv_timer_t *stale_timer = NULL;
+
+// Changed fields that reached a widget vs. ones that had nothing to redraw
+static uint32_t updates_applied = 0;
+static uint32_t updates_skipped = 0;
+
+
+static void lvgl_bind_robot_state(void);
 
 
 void example_lvgl_demo_ui(lv_display_t *disp)
@@ -93,22 +157,13 @@ void example_lvgl_demo_ui(lv_display_t *disp)
     };
 
     // Define pointers to your global objects (so you still have access in update functions)
-    lv_obj_t **btn_ptrs[] = {
-        &btn_e_stop,
-        &btn_safety_mode,
-        &btn_handbrake,
-        &btn_autonomous,
-        &btn_robot_mode,
-        &btn_battery
-    };
-
-    lv_obj_t **lbl_ptrs[] = {
-        &lbl_e_stop,
-        &lbl_safety_mode,
-        &lbl_handbrake,
-        &lbl_autonomous,
-        &lbl_robot_mode,
-        &lbl_battery_percentage
+    ui_indicator_t *ind_ptrs[] = {
+        &ind_e_stop,
+        &ind_safety_mode,
+        &ind_handbrake,
+        &ind_autonomous,
+        &ind_robot_mode,
+        &ind_battery
     };
 
     // Create buttons in a loop
@@ -116,91 +171,93 @@ void example_lvgl_demo_ui(lv_display_t *disp)
     int spacing = 25;    // Vertical spacing
 
     for (int i = 0; i < 6; i++) {
-        *(btn_ptrs[i]) = lv_button_create(scr);
-        *(lbl_ptrs[i]) = lv_label_create(*(btn_ptrs[i]));
-        lv_label_set_text_static(*(lbl_ptrs[i]), btn_labels[i]);
-        lv_obj_align(*(btn_ptrs[i]), LV_ALIGN_TOP_MID, 0, base_y + i * spacing);
+        ui_indicator_t *ind = ind_ptrs[i];
+        ind->btn = lv_button_create(scr);
+        ind->lbl = lv_label_create(ind->btn);
+        ind->visual = VISUAL_UNKNOWN;
+        ind->text = btn_labels[i];
+        ind->blinking = false;
+        lv_label_set_text_static(ind->lbl, ind->text);
+        lv_obj_align(ind->btn, LV_ALIGN_TOP_MID, 0, base_y + i * spacing);
+
+        // Every look the button can take, selected by state from here on
+        lv_obj_add_style(ind->btn, &style_unknown, LV_PART_MAIN | visual_states[VISUAL_UNKNOWN]);
+        lv_obj_add_style(ind->btn, &style_normal, LV_PART_MAIN | visual_states[VISUAL_NORMAL]);
+        lv_obj_add_style(ind->btn, &style_warning, LV_PART_MAIN | visual_states[VISUAL_WARNING]);
+        lv_obj_add_style(ind->btn, &style_blue, LV_PART_MAIN | visual_states[VISUAL_BLUE]);
+        lv_obj_add_style(ind->btn, &style_unknown, LV_PART_MAIN | LVGL_BLINK_STATE);
+        // Each look drawn as one copy once it came up twice, blink toggles included
+        lvgl_sprite_attach(ind->btn);
     }
 
+    lvgl_numlabel_init(&battery_readout, ind_battery.lbl, "Battery: ", 1, "%");
+    lvgl_bind_robot_state();
 }
 
+void lvgl_set_clock(int64_t (*now_us)(void))
+{
+    clock_now_us = now_us;
+}
 
-// Flashing buttons
-void flash_battery_style_task(void *arg)
+void lvgl_set_cached_fields(uint32_t fields)
 {
-    lv_obj_t *target = (lv_obj_t *)arg;
-
-    while (1) {
-        // Step 1: Apply style_unknown
-        _lock_acquire(&lvgl_api_lock);
-        lv_obj_remove_style(target, &style_normal, 0);
-        lv_obj_remove_style(target, &style_unknown, 0);
-        lv_obj_add_style(target, &style_unknown, 0);
-        _lock_release(&lvgl_api_lock);
-        vTaskDelay(pdMS_TO_TICKS(500));
-
-        // Step 2: Apply style_normal
-        _lock_acquire(&lvgl_api_lock);
-        lv_obj_remove_style(target, &style_unknown, 0);
-        lv_obj_remove_style(target, &style_normal, 0);
-        lv_obj_add_style(target, &style_normal, 0);
-        _lock_release(&lvgl_api_lock);
-        vTaskDelay(pdMS_TO_TICKS(500));
-    }
+    cached_fields = fields;
 }
 
-//  change to litter picking blink
-void flash_litter_picking_style_task(void *arg)
+// Drop the cached look of fields that are live again
+static void lvgl_uncache_fields(uint32_t fields)
 {
-    lv_obj_t *target = (lv_obj_t *)arg;
-
-    while (1) {
-        // Step 1: Apply style_unknown
-        _lock_acquire(&lvgl_api_lock);
-        lv_obj_remove_style(target, &style_blue, 0);
-        lv_obj_remove_style(target, &style_unknown, 0);
-        lv_obj_add_style(target, &style_unknown, 0);
-        _lock_release(&lvgl_api_lock);
-        vTaskDelay(pdMS_TO_TICKS(500));
-
-        // Step 2: Apply style_normal
-        _lock_acquire(&lvgl_api_lock);
-        lv_obj_remove_style(target, &style_unknown, 0);
-        lv_obj_remove_style(target, &style_blue, 0);
-        lv_obj_add_style(target, &style_blue, 0);
-        _lock_release(&lvgl_api_lock);
-        vTaskDelay(pdMS_TO_TICKS(500));
+    uint32_t live = cached_fields & fields;
+
+    for (int field = 0; live != 0 && field < DV8_FIELD_COUNT; field++) {
+        if ((live & DV8_FIELD_BIT(field)) && field_indicators[field] != NULL) {
+            lv_obj_remove_state(field_indicators[field]->btn, CACHED_STATE);
+        }
     }
+    cached_fields &= ~live;
 }
 
 
+// Apply only what differs from the last rendered look. `text` must be a static string,
+// NULL leaves the label alone.
+static void indicator_set(ui_indicator_t *ind, ui_visual_t visual, const char *text, bool blink)
+{
+    if (ind->visual != visual) {
+        lv_obj_remove_state(ind->btn, visual_states[ind->visual]);
+        lv_obj_add_state(ind->btn, visual_states[visual]);
+        ind->visual = visual;
+    }
+
+    if (text != NULL && ind->text != text) {
+        lv_label_set_text_static(ind->lbl, text);
+        lv_obj_center(ind->lbl); //realign to button
+        ind->text = text;
+    }
 
-// logic
-void lvgl_update_battery_percentage(float battery_percentage)
+    if (ind->blinking != blink) {
+        if (blink) {
+            lvgl_blink_start(ind->btn, BLINK_PERIOD_MS);
+        } else {
+            lvgl_blink_stop(ind->btn);
+        }
+        ind->blinking = blink;
+    }
+}
+
+
+// logic, only called from the subject observers below with lvgl_api_lock held
+void lvgl_update_battery_percentage(int32_t battery_tenths)
 {
-    char battery_str[32];
-    snprintf(battery_str, sizeof(battery_str), "Battery: %.1f%%", battery_percentage);
-    lv_label_set_text(lbl_battery_percentage, battery_str);
+    lvgl_numlabel_set(&battery_readout, battery_tenths);
+    ind_battery.text = NULL;    // the readout owns the label text now
 }
 
 void lvgl_update_battery_charge(int battery_is_charging)
 {
     if (battery_is_charging == 1) {
-        if (battery_flash_task_handle == NULL) {
-            xTaskCreate(flash_battery_style_task, "battery_flash", 2048, btn_battery, 3, &battery_flash_task_handle);
-        }
-    }else {
-        lv_obj_add_style(btn_battery, &style_unknown, 0);
-
-        if (battery_flash_task_handle != NULL){
-            vTaskDelete(battery_flash_task_handle);
-            battery_flash_task_handle = NULL;
-    
-            _lock_acquire(&lvgl_api_lock);
-            lv_obj_remove_style(btn_battery, &style_normal, 0);
-            lv_obj_remove_style(btn_battery, &style_unknown, 0);
-            lv_obj_add_style(btn_battery, &style_unknown, 0);
-            _lock_release(&lvgl_api_lock);}
+        indicator_set(&ind_battery, VISUAL_NORMAL, NULL, true);
+    } else {
+        indicator_set(&ind_battery, VISUAL_UNKNOWN, NULL, false);
     }
 }
 
@@ -208,100 +265,279 @@ void lvgl_update_battery_charge(int battery_is_charging)
 void lvgl_update_e_stop(int e_stop)
 {
     if (e_stop == 1) {
-        lv_obj_add_style(btn_e_stop, &style_warning, 0);    //On - Red
+        indicator_set(&ind_e_stop, VISUAL_WARNING, "E-Stop", false);    //On - Red
     } else {
-        lv_obj_add_style(btn_e_stop, &style_unknown, 0);    //Off / Unknown - Greyed
+        indicator_set(&ind_e_stop, VISUAL_UNKNOWN, "E-Stop", false);    //Off / Unknown - Greyed
     }
 }
 
 void lvgl_update_handbrake(int handbrake)
 {
     if (handbrake == 1) {
-        lv_obj_add_style(btn_handbrake, &style_warning, 0);
+        indicator_set(&ind_handbrake, VISUAL_WARNING, "Handbrake", false);
     } else {
-        lv_obj_add_style(btn_handbrake, &style_unknown, 0);
+        indicator_set(&ind_handbrake, VISUAL_UNKNOWN, "Handbrake", false);
     }
 }
 
 void lvgl_update_autonomous(int direct_status)
 {
     if (direct_status == 1) {
-        lv_label_set_text(lbl_autonomous, "Manual Control");
-        lv_obj_add_style(btn_autonomous, &style_blue, 0);
+        indicator_set(&ind_autonomous, VISUAL_BLUE, "Manual Control", false);
     } else {
-        lv_label_set_text(lbl_autonomous, "Autonomous Control");
-        lv_obj_add_style(btn_autonomous, &style_unknown, 0);
+        indicator_set(&ind_autonomous, VISUAL_UNKNOWN, "Autonomous Control", false);
     }
-    lv_obj_center(lbl_autonomous); //realign to button
 }
 
 void lvgl_update_safety_mode(int safety_mode)
 {
     if (safety_mode == 1) {
-        lv_label_set_text(lbl_safety_mode, "Safety Mode: On");
-        lv_obj_add_style(btn_safety_mode, &style_normal, 0);
+        indicator_set(&ind_safety_mode, VISUAL_NORMAL, "Safety Mode: On", false);
     } else if (safety_mode == 0) {
-        lv_label_set_text(lbl_safety_mode, "Safety Mode: Off");
-        lv_obj_add_style(btn_safety_mode, &style_warning, 0);
+        indicator_set(&ind_safety_mode, VISUAL_WARNING, "Safety Mode: Off", false);
     } else {
-        lv_label_set_text(lbl_safety_mode, "Safety Mode: Unknown");
-        lv_obj_add_style(btn_safety_mode, &style_unknown, 0);
+        indicator_set(&ind_safety_mode, VISUAL_UNKNOWN, "Safety Mode: Unknown", false);
     }
-    lv_obj_center(lbl_safety_mode); //realign to button
 }
 
 void lvgl_update_robot_mode(int robot_mode)     // 1-Idle, 2-Coverage, 3-Litter Picking, 4-Switching
 {
     if (robot_mode == 1) {
-        if (litter_picking_flash_task_handle != NULL) {
-            vTaskDelete(litter_picking_flash_task_handle);
-            litter_picking_flash_task_handle = NULL;
-        }
-        lv_label_set_text(lbl_robot_mode, "Mode: Idle");
-        lv_obj_add_style(btn_robot_mode, &style_normal, 0);
+        indicator_set(&ind_robot_mode, VISUAL_NORMAL, "Mode: Idle", false);
     } else if (robot_mode == 2) {
-        if (litter_picking_flash_task_handle != NULL) {
-            vTaskDelete(litter_picking_flash_task_handle);
-            litter_picking_flash_task_handle = NULL;
-        }
-        lv_label_set_text(lbl_robot_mode, "Mode: Coverage");
-        lv_obj_add_style(btn_robot_mode, &style_normal, 0);
+        indicator_set(&ind_robot_mode, VISUAL_NORMAL, "Mode: Coverage", false);
     } else if (robot_mode == 3) {
-        lv_label_set_text(lbl_robot_mode, "Mode: Litter Picking");
-        if (litter_picking_flash_task_handle == NULL) {
-            xTaskCreate(flash_litter_picking_style_task, "litter_picking_flash", 2048, btn_robot_mode, 3, &litter_picking_flash_task_handle);
-        }
+        indicator_set(&ind_robot_mode, VISUAL_BLUE, "Mode: Litter Picking", true);
     } else if (robot_mode == 4) {
-        if (litter_picking_flash_task_handle != NULL) {
-            vTaskDelete(litter_picking_flash_task_handle);
-            litter_picking_flash_task_handle = NULL;
-        }
-        lv_label_set_text(lbl_robot_mode, "Switching Mode");
-        lv_obj_add_style(btn_robot_mode, &style_normal, 0);
+        indicator_set(&ind_robot_mode, VISUAL_NORMAL, "Switching Mode", false);
     } else if (robot_mode == 6) {
-        if (litter_picking_flash_task_handle != NULL) {
-            vTaskDelete(litter_picking_flash_task_handle);
-            litter_picking_flash_task_handle = NULL;
-        }
-        lv_label_set_text(lbl_robot_mode, "Mode: Idle");
-        lv_obj_add_style(btn_robot_mode, &style_normal, 0);
+        indicator_set(&ind_robot_mode, VISUAL_NORMAL, "Mode: Idle", false);
     } else if (robot_mode == 7) {
-        if (litter_picking_flash_task_handle != NULL) {
-            vTaskDelete(litter_picking_flash_task_handle);
-            litter_picking_flash_task_handle = NULL;
+        indicator_set(&ind_robot_mode, VISUAL_WARNING, "Error", false);
+    } else {
+        indicator_set(&ind_robot_mode, VISUAL_UNKNOWN, "Mode: ?", false);
+    }
+}
+
+
+// Observers: redraw a widget only when its subject was set to a new value
+static void battery_percentage_observer_cb(lv_observer_t *observer, lv_subject_t *subject)
+{
+    if (lv_subject_get_int(subject) == FIELD_STALE) {
+        indicator_set(&ind_battery, VISUAL_UNKNOWN, "Battery: no data", false);
+        return;
+    }
+    lvgl_update_battery_percentage(lv_subject_get_int(subject));
+    // The stale look above took over the charging look and blink, which are the other subject's
+    int32_t battery_is_charging = lv_subject_get_int(&subject_battery_is_charging);
+    lvgl_update_battery_charge(battery_is_charging == FIELD_STALE ? 0 : battery_is_charging);
+}
+
+static void battery_is_charging_observer_cb(lv_observer_t *observer, lv_subject_t *subject)
+{
+    // Not known to be charging, the percentage tells on its own whether it is stale
+    int32_t battery_is_charging = lv_subject_get_int(subject);
+    lvgl_update_battery_charge(battery_is_charging == FIELD_STALE ? 0 : battery_is_charging);
+}
+
+static void e_stop_observer_cb(lv_observer_t *observer, lv_subject_t *subject)
+{
+    if (lv_subject_get_int(subject) == FIELD_STALE) {
+        indicator_set(&ind_e_stop, VISUAL_UNKNOWN, "E-Stop: no data", false);
+        return;
+    }
+    lvgl_update_e_stop(lv_subject_get_int(subject));
+}
+
+static void handbrake_observer_cb(lv_observer_t *observer, lv_subject_t *subject)
+{
+    if (lv_subject_get_int(subject) == FIELD_STALE) {
+        indicator_set(&ind_handbrake, VISUAL_UNKNOWN, "Handbrake: no data", false);
+        return;
+    }
+    lvgl_update_handbrake(lv_subject_get_int(subject));
+}
+
+static void direct_status_observer_cb(lv_observer_t *observer, lv_subject_t *subject)
+{
+    if (lv_subject_get_int(subject) == FIELD_STALE) {
+        indicator_set(&ind_autonomous, VISUAL_UNKNOWN, "Control: no data", false);
+        return;
+    }
+    lvgl_update_autonomous(lv_subject_get_int(subject));
+}
+
+static void safety_mode_observer_cb(lv_observer_t *observer, lv_subject_t *subject)
+{
+    if (lv_subject_get_int(subject) == FIELD_STALE) {
+        indicator_set(&ind_safety_mode, VISUAL_UNKNOWN, "Safety Mode: no data", false);
+        return;
+    }
+    lvgl_update_safety_mode(lv_subject_get_int(subject));
+}
+
+static void robot_mode_observer_cb(lv_observer_t *observer, lv_subject_t *subject)
+{
+    if (lv_subject_get_int(subject) == FIELD_STALE) {
+        indicator_set(&ind_robot_mode, VISUAL_UNKNOWN, "Mode: no data", false);
+        return;
+    }
+    lvgl_update_robot_mode(lv_subject_get_int(subject));
+}
+
+static int32_t robot_field_value(const dv8_robot_state_t *state, dv8_field_t field)
+{
+    switch (field) {
+    case DV8_FIELD_BATTERY_PERCENTAGE:
+        return (int32_t)lroundf(state->battery_percentage * 10.0f);
+    case DV8_FIELD_BATTERY_IS_CHARGING:
+        return state->battery_is_charging;
+    case DV8_FIELD_E_STOP:
+        return state->e_stop;
+    case DV8_FIELD_HANDBRAKE:
+        return state->handbrake;
+    case DV8_FIELD_DIRECT_STATUS:
+        return state->direct_status;
+    case DV8_FIELD_SAFETY_MODE:
+        return state->safety_mode;
+    case DV8_FIELD_ROBOT_MODE:
+        return state->robot_mode;
+    default:
+        return 0;
+    }
+}
+
+/*
+ * Sleep until the wheel's next deadline, so a healthy robot costs no wakeups between them. From
+ * its own callback the timer has just run and counts the new period from there; anywhere else
+ * `rearm` counts it from now (and wakes the LVGL task to pick up the new deadline).
+ */
+static void stale_timer_schedule(bool rearm)
+{
+    int32_t next_ms = dv8_stale_next_ms(clock_now_us());
+
+    if (next_ms < 0) {
+        lv_timer_pause(stale_timer);
+        return;
+    }
+    lv_timer_set_period(stale_timer, next_ms);
+    if (rearm) {
+        lv_timer_reset(stale_timer);
+        lv_timer_resume(stale_timer);
+    }
+}
+
+// One timer for all fields: dv8_stale_expire() only visits the deadlines that are due
+static void stale_timer_cb(lv_timer_t *timer)
+{
+    uint32_t expired = dv8_stale_expire(clock_now_us());
+
+    for (int field = 0; expired != 0 && field < DV8_FIELD_COUNT; field++) {
+        if ((expired & DV8_FIELD_BIT(field)) && field_subjects[field] != NULL) {
+            lv_subject_set_int(field_subjects[field], FIELD_STALE);
+        }
+    }
+    stale_timer_schedule(false);
+}
+
+// Seed the subjects with the current state; adding an observer draws the widget once
+static void lvgl_bind_robot_state(void)
+{
+    dv8_state_read(&shown_state);
+
+    for (int field = 0; field < DV8_FIELD_COUNT; field++) {
+        if (field_subjects[field] != NULL) {
+            lv_subject_init_int(field_subjects[field], robot_field_value(&shown_state, field));
         }
-        lv_label_set_text(lbl_robot_mode, "Error");
-        lv_obj_add_style(btn_robot_mode, &style_warning, 0);
-    } else if (robot_mode == 0) {
-        if (litter_picking_flash_task_handle != NULL) {
-            vTaskDelete(litter_picking_flash_task_handle);
-            litter_picking_flash_task_handle = NULL;
+    }
+
+    lv_subject_add_observer_obj(&subject_battery_percentage, battery_percentage_observer_cb, ind_battery.btn, NULL);
+    lv_subject_add_observer_obj(&subject_battery_is_charging, battery_is_charging_observer_cb, ind_battery.btn, NULL);
+    lv_subject_add_observer_obj(&subject_e_stop, e_stop_observer_cb, ind_e_stop.btn, NULL);
+    lv_subject_add_observer_obj(&subject_handbrake, handbrake_observer_cb, ind_handbrake.btn, NULL);
+    lv_subject_add_observer_obj(&subject_direct_status, direct_status_observer_cb, ind_autonomous.btn, NULL);
+    lv_subject_add_observer_obj(&subject_safety_mode, safety_mode_observer_cb, ind_safety_mode.btn, NULL);
+    lv_subject_add_observer_obj(&subject_robot_mode, robot_mode_observer_cb, ind_robot_mode.btn, NULL);
+
+    // Cached values are drawn as they are but greyed out, and count as expired until received
+    for (int field = 0; field < DV8_FIELD_COUNT; field++) {
+        if ((cached_fields & DV8_FIELD_BIT(field)) && field_indicators[field] != NULL) {
+            lv_obj_add_state(field_indicators[field]->btn, CACHED_STATE);
         }
-        lv_label_set_text(lbl_robot_mode, "Mode: ?");
-        lv_obj_add_style(btn_robot_mode, &style_unknown, 0);
-    } else {
-        lv_label_set_text(lbl_robot_mode, "Mode: ?");
-        lv_obj_add_style(btn_robot_mode, &style_unknown, 0);
     }
-    lv_obj_center(lbl_robot_mode); //realign to button
-}
\ No newline at end of file
+
+    if (clock_now_us != NULL) {
+        dv8_stale_init(clock_now_us(), cached_fields);
+        stale_timer = lv_timer_create(stale_timer_cb, DV8_STALE_TICK_MS, NULL);
+        stale_timer_schedule(true);
+    }
+}
+
+uint32_t lvgl_apply_robot_state(const dv8_robot_state_t *state, uint32_t changed)
+{
+    uint32_t applied = 0;
+
+    for (int field = 0; field < DV8_FIELD_COUNT; field++) {
+        if ((changed & DV8_FIELD_BIT(field)) == 0) {
+            continue;
+        }
+
+        lv_subject_t *subject = field_subjects[field];
+        int32_t value = robot_field_value(state, field);
+        if (subject == NULL || lv_subject_get_int(subject) == value) {
+            updates_skipped++;
+            continue;
+        }
+        lv_subject_set_int(subject, value);
+        applied |= DV8_FIELD_BIT(field);
+        updates_applied++;
+    }
+    return applied;
+}
+
+void lvgl_show_field(dv8_field_t field, int32_t value)
+{
+    if ((unsigned)field < DV8_FIELD_COUNT && field_subjects[field] != NULL) {
+        lv_subject_set_int(field_subjects[field], value);
+    }
+}
+
+bool lvgl_sync_robot_state(void)
+{
+    // One consistent copy per call; an unchanged version means no LVGL work at all
+    // Expired fields received again are redrawn even if their value is the same as before
+    dv8_robot_state_t state;
+    uint32_t revived = clock_now_us != NULL ? dv8_stale_revive(clock_now_us()) : 0;
+    if (revived != 0) {
+        // Tracked again, its deadline may be the earliest now
+        stale_timer_schedule(true);
+    }
+    if (dv8_state_read(&state) == shown_state.version && revived == 0) {
+        return false;
+    }
+
+    uint32_t changed = dv8_state_diff(&shown_state, &state);
+    lvgl_uncache_fields(changed | revived);
+    uint32_t applied = lvgl_apply_robot_state(&state, changed | revived);
+    for (int field = 0; field < DV8_FIELD_COUNT; field++) {
+        if (applied & changed & DV8_FIELD_BIT(field)) {
+            dv8_latency_mark(field, state.changed_us[field]);
+        }
+    }
+    shown_state = state;
+    return true;
+}
+
+lv_obj_t *lvgl_field_button(dv8_field_t field)
+{
+    if (field == DV8_FIELD_BATTERY_IS_CHARGING) {
+        return ind_battery.btn;
+    }
+    return (unsigned)field < DV8_FIELD_COUNT && field_indicators[field] != NULL ? field_indicators[field]->btn : NULL;
+}
+
+void lvgl_get_update_stats(uint32_t *applied, uint32_t *skipped)
+{
+    *applied = updates_applied;
+    *skipped = updates_skipped;
+}
@@ -0,0 +1,33 @@
+#ifndef LVGL_UI_H
+#define LVGL_UI_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "lvgl.h"
+#include "dv8_state.h"
+
+// Clock for the receive stamps passed to dv8_message_handle(), esp_timer_get_time on the panel.
+// Set before example_lvgl_demo_ui() to expire fields the robot stopped sending (dv8_stale.h).
+extern void lvgl_set_clock(int64_t (*now_us)(void));
+// Fields of the dv8_state snapshot restored from dv8_state_cache rather than received. Set before
+// example_lvgl_demo_ui(): their buttons show the cached value greyed out until it is received.
+extern void lvgl_set_cached_fields(uint32_t fields);
+// Create the status buttons on the active screen of `disp` and bind them to the robot state
+extern void example_lvgl_demo_ui(lv_display_t *disp);
+// Push the fields flagged in `changed` (see dv8_state_diff()) from a snapshot into the UI and
+// return the ones that changed a widget. Must be called with lvgl_api_lock held.
+extern uint32_t lvgl_apply_robot_state(const dv8_robot_state_t *state, uint32_t changed);
+// Show `value` on the widget of `field` until the robot state changes that field, in the unit its
+// widget takes: as in dv8_robot_state_t, the battery in tenths of a percent. For trying widgets
+// out without a robot (lvgl_cmd). Must be called with lvgl_api_lock held.
+extern void lvgl_show_field(dv8_field_t field, int32_t value);
+// Bring the UI up to date with the latest dv8_state snapshot and redraw expired fields that were
+// received again. Returns false, without touching any widget, if there was neither. Must be called with lvgl_api_lock held.
+extern bool lvgl_sync_robot_state(void);
+// Button `field` is shown on, NULL if none. Both battery fields share one. For the simulator's
+// checks of what a field looks like.
+extern lv_obj_t *lvgl_field_button(dv8_field_t field);
+// Changed fields that reached a widget vs. ones that had nothing to redraw
+extern void lvgl_get_update_stats(uint32_t *applied, uint32_t *skipped);
+
+#endif
@@ -5,15 +5,17 @@
  */
 
 #include <stdio.h>
-#include <unistd.h>
+#include <inttypes.h>
 #include <sys/lock.h>
 #include <sys/param.h>
+#include <stdatomic.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_timer.h"
 #include "esp_lcd_panel_io.h"
 #include "esp_lcd_panel_vendor.h"
 #include "esp_lcd_panel_ops.h"
+#include "esp_lcd_panel_commands.h"
 #include "driver/gpio.h"
 #include "driver/spi_master.h"
 #include "esp_err.h"
@@ -23,6 +25,23 @@
 //to include "mqtt_module"
 //#include "mqtt_module.h"
 #include "dv8_mqtt.h"
+#include "lvgl_ui.h"
+#include "lvgl_fleet.h"
+#include "lvgl_trend.h"
+#include "lvgl_pacer.h"
+#include "lvgl_cmd.h"
+#include "lvgl_sprite.h"
+#include "lvgl_rgb565_be.h"
+#include "dv8_fleet.h"
+#include "dv8_latency.h"
+#include "dv8_metrics.h"
+#include "dv8_message.h"
+#include "dv8_state_cache.h"
+#include "dv8_boot.h"
+#include "dv8_binlog.h"
+#include "dv8_touch.h"
+#include "lvgl_touch.h"
+#include "dv8_console.h"
 #include "nvs_flash.h"
 #include "esp_event.h"
 #include "esp_netif.h"
@@ -41,17 +60,6 @@
 
 static const char *TAG = "example";
 
-_Atomic(float) linear_x;
-_Atomic(float) angular_z;
-_Atomic(float) battery_percentage;
-_Atomic(int) brush_speed;
-_Atomic(int) battery_is_charging;
-_Atomic(int) e_stop;
-_Atomic(int) handbrake;
-_Atomic(int) direct_status;
-_Atomic(int) robot_mode;
-_Atomic(int) safety_mode;
-
 // Using SPI2 in the example
 #define LCD_HOST  SPI2_HOST
 
@@ -69,6 +77,7 @@ _Atomic(int) safety_mode;
 #define EXAMPLE_PIN_NUM_LCD_CS         4
 #define EXAMPLE_PIN_NUM_BK_LIGHT       2
 #define EXAMPLE_PIN_NUM_TOUCH_CS       15
+#define EXAMPLE_PIN_NUM_TOUCH_IRQ      6     // STMPE610 INT, open drain active low
 
 // The pixel number in horizontal and vertical
 #if CONFIG_EXAMPLE_LCD_CONTROLLER_ILI9341
@@ -78,40 +87,82 @@ _Atomic(int) safety_mode;
 #define EXAMPLE_LCD_H_RES              240
 #define EXAMPLE_LCD_V_RES              240
 #endif
+// Offset of the visible area in the controller's frame memory, with the axes as set at init. Zero on
+// the supported modules; 128x160 ST7735 boards driven as an ILI9341 often need 2 and 1.
+#define EXAMPLE_LCD_X_GAP              0
+#define EXAMPLE_LCD_Y_GAP              0
 // Bit number used to represent command and parameter
 #define EXAMPLE_LCD_CMD_BITS           8
 #define EXAMPLE_LCD_PARAM_BITS         8
 
 #define EXAMPLE_LVGL_DRAW_BUF_LINES    20 // number of display lines in each draw buffer
-#define EXAMPLE_LVGL_TICK_PERIOD_MS    2
-#define EXAMPLE_LVGL_TASK_MAX_DELAY_MS 500
-#define EXAMPLE_LVGL_TASK_MIN_DELAY_MS 1
 #define EXAMPLE_LVGL_TASK_STACK_SIZE   (4 * 1024)
 #define EXAMPLE_LVGL_TASK_PRIORITY     2
+#define EXAMPLE_UI_STATS_PERIOD_MS     10000 // how often app_main reports applied/skipped UI updates
+#define EXAMPLE_LOG_TASK_STACK_SIZE    (3 * 1024)
+#define EXAMPLE_LOG_TASK_PRIORITY      1     // below everything but idle, logging waits for the UI
+#define EXAMPLE_LOG_DRAIN_PERIOD_MS    200
+#define EXAMPLE_TOUCH_TASK_STACK_SIZE  (3 * 1024)
+#define EXAMPLE_TOUCH_TASK_PRIORITY    3     // above LVGL: a few short bus transactions per interrupt
+#define EXAMPLE_TOUCH_HELD_POLL_MS     50    // while pressed, in case an interrupt edge was missed
 
 // LVGL library is not thread-safe, this example will call LVGL APIs from different tasks, so use a mutex to protect it
 _lock_t lvgl_api_lock;
 
-extern void example_lvgl_demo_ui(lv_disp_t *disp);
-extern void lvgl_update_battery_percentage(float battery_percentage);
-extern void lvgl_update_battery_charge(int battery_is_charging);
-extern void lvgl_update_e_stop(int e_stop);
-extern void lvgl_update_handbrake(int handbrake);
-extern void lvgl_update_autonomous(int direct_status);
-extern void lvgl_update_safety_mode(int safety_mode);
-extern void lvgl_update_robot_mode(int robot_mode);
-
+/*
+ * Address window the panel is writing into. The flush callback sets CASET/RASET itself instead of
+ * going through esp_lcd_panel_draw_bitmap(), so that a stripe starting on the row right below the
+ * previous one, with the same columns, is sent as a RAMWRC continuation of the open window rather
+ * than another CASET + RASET + RAMWR. LVGL renders full-width invalid areas as consecutive 20-line
+ * stripes, so a full redraw becomes one window. Only touched from flush_cb and the rotation event,
+ * both with lvgl_api_lock held.
+ *
+ * Bypassing draw_bitmap() means its gap offset has to be added here as well, so the gap is kept in
+ * x_gap/y_gap next to the copy given to the driver. Mirroring and swapping need nothing: they are
+ * MADCTL bits the controller applies to whatever window it is sent.
+ */
+static struct {
+    esp_lcd_panel_io_handle_t io;
+    bool open;
+    int x1, x2;
+    int next_y;
+    int x_gap, y_gap;
+} lcd_window;
+
+// SPI throughput. Bytes and busy time count up from boot, the stats report in app_main and the
+// metrics report each take their own differences; windows and merged are cleared by the former.
+static int64_t lcd_flush_started_us;           // flush_cb -> transfer-done callback of the same area
+static _Atomic(uint32_t) lcd_flush_bytes;
+static _Atomic(uint32_t) lcd_flush_busy_us;     // from the first command of an area until its pixels are out
+static _Atomic(uint32_t) lcd_flush_windows;     // CASET/RASET windows opened
+static _Atomic(uint32_t) lcd_flush_merged;      // stripes that continued an open window
+static _Atomic(uint32_t) lcd_flush_pending;     // flush_cb -> transfer done, the touch service yields to these
 
 static bool example_notify_lvgl_flush_ready(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_io_event_data_t *edata, void *user_ctx)
 {
     lv_display_t *disp = (lv_display_t *)user_ctx;
+    atomic_fetch_add_explicit(&lcd_flush_busy_us, (uint32_t)(esp_timer_get_time() - lcd_flush_started_us), memory_order_relaxed);
+    atomic_fetch_sub_explicit(&lcd_flush_pending, 1, memory_order_relaxed);
+    // The last area of a frame is out: whatever changed in it is now on the glass
+    if (lv_display_flush_is_last(disp)) {
+        dv8_latency_frame_done(esp_timer_get_time());
+    }
     lv_display_flush_ready(disp);
     return false;
 }
 
-/* Rotate display and touch, when rotated screen in LVGL. Called when driver parameters are updated. */
-static void example_lvgl_port_update_callback(lv_display_t *disp)
+// Gap for the current axes: swapping them swaps which gap goes with CASET and which with RASET
+static void example_lcd_set_gap(esp_lcd_panel_handle_t panel_handle, bool swap_xy)
 {
+    lcd_window.x_gap = swap_xy ? EXAMPLE_LCD_Y_GAP : EXAMPLE_LCD_X_GAP;
+    lcd_window.y_gap = swap_xy ? EXAMPLE_LCD_X_GAP : EXAMPLE_LCD_Y_GAP;
+    esp_lcd_panel_set_gap(panel_handle, lcd_window.x_gap, lcd_window.y_gap);
+}
+
+/* Rotate display and touch, when rotated screen in LVGL. Called on LV_EVENT_RESOLUTION_CHANGED, i.e. once per rotation. */
+static void example_lvgl_port_update_callback(lv_event_t *e)
+{
+    lv_display_t *disp = lv_event_get_current_target(e);
     esp_lcd_panel_handle_t panel_handle = lv_display_get_user_data(disp);
     lv_display_rotation_t rotation = lv_display_get_rotation(disp);
 
@@ -137,26 +188,110 @@ static void example_lvgl_port_update_callback(lv_display_t *disp)
         esp_lcd_panel_mirror(panel_handle, false, false);
         break;
     }
+    example_lcd_set_gap(panel_handle, rotation == LV_DISPLAY_ROTATION_90 || rotation == LV_DISPLAY_ROTATION_270);
+    // MADCTL changed, the next stripe has to set its window again
+    lcd_window.open = false;
+}
+
+// Window in LVGL coordinates, offset by the gap like esp_lcd_panel_draw_bitmap() does
+static void example_lcd_set_window(int x1, int x2, int y1, int y2)
+{
+    x1 += lcd_window.x_gap;
+    x2 += lcd_window.x_gap;
+    y1 += lcd_window.y_gap;
+    y2 += lcd_window.y_gap;
+    esp_lcd_panel_io_tx_param(lcd_window.io, LCD_CMD_CASET, (uint8_t[]) {
+        (x1 >> 8) & 0xFF, x1 & 0xFF, (x2 >> 8) & 0xFF, x2 & 0xFF,
+    }, 4);
+    esp_lcd_panel_io_tx_param(lcd_window.io, LCD_CMD_RASET, (uint8_t[]) {
+        (y1 >> 8) & 0xFF, y1 & 0xFF, (y2 >> 8) & 0xFF, y2 & 0xFF,
+    }, 4);
 }
 
 static void example_lvgl_flush_cb(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map)
 {
-    example_lvgl_port_update_callback(disp);
-    esp_lcd_panel_handle_t panel_handle = lv_display_get_user_data(disp);
     int offsetx1 = area->x1;
     int offsetx2 = area->x2;
     int offsety1 = area->y1;
     int offsety2 = area->y2;
-    // because SPI LCD is big-endian, we need to swap the RGB bytes order
-    lv_draw_sw_rgb565_swap(px_map, (offsetx2 + 1 - offsetx1) * (offsety2 + 1 - offsety1));
-    // copy a buffer's content to a specific area of the display
-    esp_lcd_panel_draw_bitmap(panel_handle, offsetx1, offsety1, offsetx2 + 1, offsety2 + 1, px_map);
+    size_t len = (offsetx2 + 1 - offsetx1) * (offsety2 + 1 - offsety1) * sizeof(uint16_t);
+    // because SPI LCD is big-endian, we need to swap the RGB bytes order, unless the blend hooks
+    // of lvgl_rgb565_be.h rendered it that way already
+    if (!lvgl_rgb565_be_active) {
+        lv_draw_sw_rgb565_swap(px_map, (offsetx2 + 1 - offsetx1) * (offsety2 + 1 - offsety1));
+    }
+    if (lv_display_flush_is_last(disp)) {
+        dv8_latency_frame_flushing();
+    }
+    dv8_boot_mark(DV8_BOOT_FIRST_FLUSH);
+    // Before the window commands, which wait for the bus as well
+    atomic_fetch_add_explicit(&lcd_flush_pending, 1, memory_order_relaxed);
+    lcd_flush_started_us = esp_timer_get_time();
+    atomic_fetch_add_explicit(&lcd_flush_bytes, len, memory_order_relaxed);
+
+    int lcd_cmd = LCD_CMD_RAMWR;
+#if CONFIG_DV8_LCD_MERGE_STRIPES
+    if (lcd_window.open && offsetx1 == lcd_window.x1 && offsetx2 == lcd_window.x2 && offsety1 == lcd_window.next_y) {
+        lcd_cmd = LCD_CMD_RAMWRC;
+        atomic_fetch_add_explicit(&lcd_flush_merged, 1, memory_order_relaxed);
+    } else {
+        // Open the window down to the last row so the stripes below can continue it
+        example_lcd_set_window(offsetx1, offsetx2, offsety1, lv_display_get_vertical_resolution(disp) - 1);
+        atomic_fetch_add_explicit(&lcd_flush_windows, 1, memory_order_relaxed);
+    }
+    lcd_window.open = true;
+    lcd_window.x1 = offsetx1;
+    lcd_window.x2 = offsetx2;
+    lcd_window.next_y = offsety2 + 1;
+#else
+    example_lcd_set_window(offsetx1, offsetx2, offsety1, offsety2);
+    atomic_fetch_add_explicit(&lcd_flush_windows, 1, memory_order_relaxed);
+#endif
+    // copy a buffer's content to the window, the done callback tells LVGL the buffer is free again
+    esp_lcd_panel_io_tx_color(lcd_window.io, lcd_cmd, px_map, len);
 }
 
-static void example_increase_lvgl_tick(void *arg)
+/* LVGL reads the time when it needs it instead of a periodic timer counting it up */
+static uint32_t example_lvgl_tick_get(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+static TaskHandle_t lvgl_task;
+static _Atomic(uint32_t) lvgl_task_wakeups;
+
+/*
+ * Wake the LVGL task before its deadline. Registered as the lv_timer resume callback, which LVGL
+ * calls whenever a timer is created, resumed or reset (an invalidated area resumes the refresh
+ * timer), and as the MQTT state-changed callback.
+ */
+static void example_lvgl_wake(void *arg)
 {
-    /* Tell LVGL how many milliseconds has elapsed */
-    lv_tick_inc(EXAMPLE_LVGL_TICK_PERIOD_MS);
+    if (lvgl_task != NULL) {
+        xTaskNotifyGive(lvgl_task);
+    }
+}
+
+// Commands other tasks posted with lvgl_cmd_post(), lvgl_api_lock held
+static void example_lvgl_apply_cmd(lvgl_cmd_type_t type, uint32_t target, int32_t value)
+{
+#if !CONFIG_DV8_FLEET_MODE
+    switch (type) {
+    case LVGL_CMD_PAGE:
+        lvgl_trend_show(value != 0);
+        break;
+    case LVGL_CMD_FIELD:
+        lvgl_show_field((dv8_field_t)target, value);
+        break;
+    default:
+        break;
+    }
+#endif
+#if CONFIG_EXAMPLE_LCD_TOUCH_CONTROLLER_STMPE610
+    if (type == LVGL_CMD_TOUCH) {
+        lvgl_touch_read();
+    }
+#endif
 }
 
 static void example_lvgl_port_task(void *arg)
@@ -165,21 +300,168 @@ static void example_lvgl_port_task(void *arg)
     uint32_t time_till_next_ms = 0;
     uint32_t time_threshold_ms = 1000 / CONFIG_FREERTOS_HZ;
     while (1) {
+        int64_t pass_start_us = esp_timer_get_time();
         _lock_acquire(&lvgl_api_lock);
+        lvgl_cmd_drain(example_lvgl_apply_cmd);
+        // Take what the MQTT task published and render it in the same pass
+#if CONFIG_DV8_FLEET_MODE
+        lvgl_fleet_sync();
+#else
+        lvgl_sync_robot_state();
+#endif
         time_till_next_ms = lv_timer_handler();
         _lock_release(&lvgl_api_lock);
-        // in case of triggering a task watch dog time out
-        time_till_next_ms = MAX(time_till_next_ms, time_threshold_ms);
-        usleep(1000 * time_till_next_ms);
+        dv8_metrics_pass((uint32_t)(esp_timer_get_time() - pass_start_us));
+
+        // Sleep until the next lv_timer is due, or for good when they are all paused (nothing
+        // animates and nothing is invalid). in case of triggering a task watch dog time out, block
+        // for at least a tick.
+        TickType_t wait = portMAX_DELAY;
+        if (time_till_next_ms != LV_NO_TIMER_READY) {
+            wait = pdMS_TO_TICKS(MAX(time_till_next_ms, time_threshold_ms));
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+        atomic_fetch_add_explicit(&lvgl_task_wakeups, 1, memory_order_relaxed);
+    }
+}
+
+#if CONFIG_EXAMPLE_LCD_TOUCH_CONTROLLER_STMPE610
+static TaskHandle_t touch_task;
+static _Atomic(uint32_t) touch_irq_us;     // low 32 bits of esp_timer_get_time(), 64-bit atomics aren't ISR safe here
+
+static void example_touch_isr(void *arg)
+{
+    atomic_store_explicit(&touch_irq_us, (uint32_t)esp_timer_get_time(), memory_order_relaxed);
+    BaseType_t woken = pdFALSE;
+    if (touch_task != NULL) {
+        vTaskNotifyGiveFromISR(touch_task, &woken);
+    }
+    portYIELD_FROM_ISR(woken);
+}
+
+// One register byte per transaction, the command phase carries the register (0x80 to read)
+static int example_touch_read(void *ctx, uint8_t reg, uint8_t *value)
+{
+    spi_transaction_t t = {
+        .cmd = 0x80 | reg,
+        .length = 8,
+        .flags = SPI_TRANS_USE_RXDATA,
+    };
+    if (spi_device_polling_transmit(ctx, &t) != ESP_OK) {
+        return -1;
     }
+    *value = t.rx_data[0];
+    return 0;
+}
+
+static int example_touch_write(void *ctx, uint8_t reg, uint8_t value)
+{
+    spi_transaction_t t = {
+        .cmd = reg,
+        .length = 8,
+        .flags = SPI_TRANS_USE_TXDATA,
+        .tx_data = { value },
+    };
+    return spi_device_polling_transmit(ctx, &t) == ESP_OK ? 0 : -1;
 }
 
+// Hold the bus over a service burst, so its transactions don't each wait for an LCD stripe
+static void example_touch_bus_begin(void *ctx)
+{
+    spi_device_acquire_bus(ctx, portMAX_DELAY);
+}
+
+static void example_touch_bus_end(void *ctx)
+{
+    spi_device_release_bus(ctx);
+}
+
+// ...unless a stripe is waiting for it, which then goes first: dv8_touch releases and re-acquires
+static bool example_touch_bus_contended(void *ctx)
+{
+    return atomic_load_explicit(&lcd_flush_pending, memory_order_relaxed) > 0;
+}
+
+static void example_touch_task(void *arg)
+{
+    while (1) {
+        // No bus traffic at all until the controller interrupts, except for a slow check while held
+        bool irq = ulTaskNotifyTake(pdTRUE, dv8_touch_pressed() ? pdMS_TO_TICKS(EXAMPLE_TOUCH_HELD_POLL_MS) : portMAX_DELAY) > 0;
+        int64_t now_us = esp_timer_get_time();
+        int64_t irq_us = irq ? now_us - (uint32_t)((uint32_t)now_us - atomic_load_explicit(&touch_irq_us, memory_order_relaxed)) : now_us;
+        if (dv8_touch_service(irq_us)) {
+            lvgl_cmd_post(LVGL_CMD_TOUCH, 0, 0);
+        }
+    }
+}
+#endif
+
+#if CONFIG_DV8_METRICS_PUBLISH_PERIOD_MS > 0
+// An lv_timer, so lv_mem_monitor() runs under lvgl_api_lock and the report on the LVGL task
+static void example_metrics_timer_cb(lv_timer_t *timer)
+{
+    static char payload[768];
+
+    lv_mem_monitor_t mem;
+    lv_mem_monitor(&mem);
+    lvgl_pacer_stats_t frames;
+    lvgl_pacer_get_stats(&frames);
+    lvgl_cmd_stats_t cmds;
+    lvgl_cmd_get_stats(&cmds);
+    dv8_metrics_sample_t sample = {
+        .heap_total = mem.total_size,
+        .heap_free = mem.free_size,
+        .heap_biggest_free = mem.free_biggest_size,
+        .heap_max_used = mem.max_used,
+        .heap_frag_pct = mem.frag_pct,
+        .flush_bytes = atomic_load_explicit(&lcd_flush_bytes, memory_order_relaxed),
+        .flush_busy_us = atomic_load_explicit(&lcd_flush_busy_us, memory_order_relaxed),
+        .frames_dropped = frames.dropped,
+        .cmds_dropped = cmds.dropped,
+    };
+    int len = dv8_metrics_report(&sample, payload, sizeof(payload));
+    if (len < 0 || (size_t)len >= sizeof(payload)) {
+        ESP_LOGW(TAG, "metrics report doesn't fit in %u bytes", (unsigned)sizeof(payload));
+        return;
+    }
+    mqtt_publish_metrics(payload, len);
+}
+#endif
+
+static uint32_t example_log_clock(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+// Print one binlog record the way ESP_LOGx would, with the time it was logged at
+static void example_log_emit(const dv8_binlog_record_t *record)
+{
+    const dv8_binlog_message_t *msg = &dv8_binlog_messages[record->id];
+    esp_log_level_t level = msg->level == 'E' ? ESP_LOG_ERROR :
+                            msg->level == 'W' ? ESP_LOG_WARN :
+                            msg->level == 'I' ? ESP_LOG_INFO :
+                            msg->level == 'D' ? ESP_LOG_DEBUG : ESP_LOG_VERBOSE;
+    char line[160];
+    dv8_binlog_format(line, sizeof(line), record);
+    esp_log_write(level, msg->tag, "%c (%"PRIu32") %s: %s\n", msg->level, record->time_ms, msg->tag, line);
+}
+
+static void example_log_task(void *arg)
+{
+    while (1) {
+        // Rate-limited state values are due once their interval is up, message or not
+        mqtt_flush_state_log();
+        dv8_binlog_drain(example_log_emit);
+        vTaskDelay(pdMS_TO_TICKS(EXAMPLE_LOG_DRAIN_PERIOD_MS));
+    }
+}
 
 void wifi_and_mqtt_task(void *arg)
 {
     ESP_LOGI("WIFI", "Starting Wi-Fi and MQTT connection task");
 
     ESP_ERROR_CHECK(example_connect());        // Connect to Wi-Fi
+    dv8_boot_mark(DV8_BOOT_WIFI);
     mqtt_module_start();                       // Start MQTT
 
     ESP_LOGI("WIFI", "Wi-Fi and MQTT initialized");
@@ -242,15 +524,47 @@ void app_main(void)
     ESP_ERROR_CHECK(esp_lcd_panel_invert_color(panel_handle, true));
 #endif
     ESP_ERROR_CHECK(esp_lcd_panel_mirror(panel_handle, true, false));
+    example_lcd_set_gap(panel_handle, false);
 
     // user can flush pre-defined pattern to the screen before we turn on the screen or backlight
     ESP_ERROR_CHECK(esp_lcd_panel_disp_on_off(panel_handle, true));
+    dv8_boot_mark(DV8_BOOT_PANEL);
 
     ESP_LOGI(TAG, "Turn on LCD backlight");
     gpio_set_level(EXAMPLE_PIN_NUM_BK_LIGHT, EXAMPLE_LCD_BK_LIGHT_ON_LEVEL);
 
+#if CONFIG_EXAMPLE_LCD_TOUCH_CONTROLLER_STMPE610
+    ESP_LOGI(TAG, "Initialize STMPE610 touch controller");
+    // Our own device on the LCD's bus rather than the vendored driver's panel IO, which can't hold
+    // the bus across a burst; the settings are those of ESP_LCD_TOUCH_IO_SPI_STMPE610_CONFIG
+    spi_device_interface_config_t tp_dev_config = {
+        .command_bits = 8,
+        .mode = 1,
+        .clock_speed_hz = 1 * 1000 * 1000,
+        .spics_io_num = EXAMPLE_PIN_NUM_TOUCH_CS,
+        .queue_size = 1,
+    };
+    spi_device_handle_t tp_dev = NULL;
+    ESP_ERROR_CHECK(spi_bus_add_device(LCD_HOST, &tp_dev_config, &tp_dev));
+    dv8_touch_init(&(dv8_touch_bus_t) { example_touch_read, example_touch_write, example_touch_bus_begin,
+                                        example_touch_bus_end, example_touch_bus_contended, tp_dev },
+                   EXAMPLE_LCD_H_RES, EXAMPLE_LCD_V_RES, esp_timer_get_time);
+    ESP_ERROR_CHECK(dv8_touch_configure() ? ESP_OK : ESP_FAIL);
+
+    gpio_config_t tp_irq_config = {
+        .pin_bit_mask = 1ULL << EXAMPLE_PIN_NUM_TOUCH_IRQ,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .intr_type = GPIO_INTR_NEGEDGE,
+    };
+    ESP_ERROR_CHECK(gpio_config(&tp_irq_config));
+    ESP_ERROR_CHECK(gpio_install_isr_service(0));
+    ESP_ERROR_CHECK(gpio_isr_handler_add(EXAMPLE_PIN_NUM_TOUCH_IRQ, example_touch_isr, NULL));
+#endif
+
     ESP_LOGI(TAG, "Initialize LVGL library");
     lv_init();
+    lv_tick_set_cb(example_lvgl_tick_get);
 
     //Setting Theme Colour
     lv_color_t primary = lv_color_make(100, 180, 30);   // Main accent color (b,g,r)
@@ -284,17 +598,18 @@ void app_main(void)
     // set color depth
     lv_display_set_color_format(display, LV_COLOR_FORMAT_RGB565);
     // set the callback which can copy the rendered image to an area of the display
+    lcd_window.io = io_handle;
     lv_display_set_flush_cb(display, example_lvgl_flush_cb);
-
-    ESP_LOGI(TAG, "Install LVGL tick timer");
-    // Tick interface for LVGL (using esp_timer to generate 2ms periodic event)
-    const esp_timer_create_args_t lvgl_tick_timer_args = {
-        .callback = &example_increase_lvgl_tick,
-        .name = "lvgl_tick"
-    };
-    esp_timer_handle_t lvgl_tick_timer = NULL;
-    ESP_ERROR_CHECK(esp_timer_create(&lvgl_tick_timer_args, &lvgl_tick_timer));
-    ESP_ERROR_CHECK(esp_timer_start_periodic(lvgl_tick_timer, EXAMPLE_LVGL_TICK_PERIOD_MS * 1000));
+    // rotation is sent to the panel only when it changes, not with every flushed area
+    lv_display_add_event_cb(display, example_lvgl_port_update_callback, LV_EVENT_RESOLUTION_CHANGED, NULL);
+    // render big-endian unless a refresh needs what the hooks don't cover
+    lvgl_rgb565_be_attach(display);
+    // refresh only when something is invalid, slower while animations can't keep up
+    lvgl_pacer_attach(display, esp_timer_get_time);
+#if CONFIG_DV8_METRICS_PUBLISH_PERIOD_MS > 0
+    dv8_metrics_set_clock(esp_timer_get_time);
+    lv_timer_create(example_metrics_timer_cb, CONFIG_DV8_METRICS_PUBLISH_PERIOD_MS, NULL);
+#endif
 
     ESP_LOGI(TAG, "Register io panel event callback for LVGL flush ready notification");
     const esp_lcd_panel_io_callbacks_t cbs = {
@@ -302,55 +617,131 @@ void app_main(void)
     };
     /* Register done callback */
     ESP_ERROR_CHECK(esp_lcd_panel_io_register_event_callbacks(io_handle, &cbs, display));
+    dv8_boot_mark(DV8_BOOT_LVGL);
 
-    ESP_LOGI(TAG, "Create LVGL task");
-    xTaskCreate(example_lvgl_port_task, "LVGL", EXAMPLE_LVGL_TASK_STACK_SIZE, NULL, EXAMPLE_LVGL_TASK_PRIORITY, NULL);
+    // NVS first, the last known robot state is drawn before Wi-Fi is even started
+    ESP_ERROR_CHECK(nvs_flash_init());
+#if CONFIG_DV8_STATE_CACHE && !CONFIG_DV8_FLEET_MODE
+    dv8_robot_state_t cached_state = { 0 };
+    uint32_t cached_fields = dv8_state_cache_load(&cached_state);
+    if (cached_fields != 0) {
+        ESP_LOGI(TAG, "Restored the last known robot state, shown greyed out until it is received");
+        dv8_message_restore(&cached_state);
+        lvgl_set_cached_fields(cached_fields);
+    }
+#endif
 
     ESP_LOGI(TAG, "Display LVGL Meter Widget");
     // Lock the mutex due to the LVGL APIs are not thread-safe
     _lock_acquire(&lvgl_api_lock);
+    //Rotate Screen, before anything is drawn
+    lv_disp_set_rotation(display, LV_DISPLAY_ROTATION_180);
+#if CONFIG_DV8_FLEET_MODE
+    lvgl_fleet_ui(display);
+#else
+    lvgl_set_clock(esp_timer_get_time);
     example_lvgl_demo_ui(display);
+    lvgl_trend_ui(display, esp_timer_get_time);
+#endif
+#if CONFIG_EXAMPLE_LCD_TOUCH_CONTROLLER_STMPE610
+    lvgl_touch_create(display);
+#endif
     _lock_release(&lvgl_api_lock);
+    dv8_boot_mark(DV8_BOOT_UI);
+#if CONFIG_DV8_STATE_CACHE && !CONFIG_DV8_FLEET_MODE
+    dv8_state_cache_start();
+#endif
 
-    //Rotate Screen
-    lv_disp_set_rotation(display, LV_DISPLAY_ROTATION_180);
+    ESP_LOGI(TAG, "Create LVGL task");
+    xTaskCreate(example_lvgl_port_task, "LVGL", EXAMPLE_LVGL_TASK_STACK_SIZE, NULL, EXAMPLE_LVGL_TASK_PRIORITY, &lvgl_task);
+    lv_timer_handler_set_resume_cb(example_lvgl_wake, NULL);
+    lvgl_cmd_set_wake_cb(example_lvgl_wake, NULL);
+#if CONFIG_EXAMPLE_LCD_TOUCH_CONTROLLER_STMPE610
+    xTaskCreate(example_touch_task, "touch", EXAMPLE_TOUCH_TASK_STACK_SIZE, NULL, EXAMPLE_TOUCH_TASK_PRIORITY, &touch_task);
+    // An interrupt before the task existed went unanswered, and the edge won't come again until it is
+    xTaskNotifyGive(touch_task);
+#endif
 
     
     //for mqtt_module
-    ESP_ERROR_CHECK(nvs_flash_init());
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
 
+    // The LVGL task sleeps until the MQTT handler reports a change
+    mqtt_set_state_changed_cb(example_lvgl_wake, NULL);
+
     //runs mqtt connection in background
     xTaskCreate(wifi_and_mqtt_task, "wifi_mqtt", 4096, NULL, 5, NULL);
 
-    // 🔧 Manually override/test values here
-    // battery_percentage = 85.5;
-    // battery_is_charging = 1;
-    // e_stop = 0;
-    // handbrake = 1;
-    // robot_mode = 1;
-    // direct_status = 0;
-    // safety_mode = 1;
+#if CONFIG_DV8_CONSOLE
+    dv8_console_start();
+#endif
 
+    // 🔧 Manually override/test values here
+    // dv8_state_publish(&(dv8_robot_state_t) {
+    //     .battery_percentage = 85.5,
+    //     .battery_is_charging = 1,
+    //     .e_stop = 0,
+    //     .handbrake = 1,
+    //     .robot_mode = 1,
+    //     .direct_status = 0,
+    //     .safety_mode = 1,
+    // });
+
+    int64_t last_stats_us = esp_timer_get_time();
+    uint32_t last_flush_bytes = 0, last_flush_busy_us = 0;
     while (1) {
+        vTaskDelay(pdMS_TO_TICKS(EXAMPLE_UI_STATS_PERIOD_MS));
+
+        int64_t now_us = esp_timer_get_time();
+        // Stats go through the binlog, formatted later by the log task
+#if CONFIG_DV8_FLEET_MODE
+        dv8_fleet_stats_t fleet;
+        dv8_fleet_get_stats(&fleet);
+        DV8_BINLOG(FLEET, fleet.robots, fleet.messages, fleet.changed, fleet.rejected, lvgl_fleet_rows_redrawn());
+#endif
+        uint32_t applied, skipped;
+        lvgl_get_update_stats(&applied, &skipped);
         //ESP_LOGI("HEAP", "Free heap: %d", esp_get_free_heap_size());
-    	ESP_LOGI(TAG,"linear_x: %f, angular_z: %f",linear_x,angular_z);
-        ESP_LOGI(TAG,"battery_percentage: %f",battery_percentage);
-        ESP_LOGI(TAG,"battery_is_charging: %d",battery_is_charging);
-        ESP_LOGI(TAG,"e_stop: %d",e_stop);
-        ESP_LOGI(TAG,"handbrake: %d",handbrake);
-        ESP_LOGI(TAG,"direct_status: %d",direct_status);    // 0 or 1 for autonomous
-        ESP_LOGI(TAG,"safety_mode: %d",safety_mode);
-        ESP_LOGI(TAG,"robot_mode: %d",robot_mode);          // 1-Idle, 2-Coverage, 3-Litter Picking, 4-Switching
-        ESP_LOGI(TAG,"brush_speed: %d",brush_speed);
-        lvgl_update_battery_percentage(battery_percentage);
-        lvgl_update_battery_charge(battery_is_charging);
-        lvgl_update_e_stop(e_stop);
-        lvgl_update_handbrake(handbrake);
-        lvgl_update_autonomous(direct_status);
-        lvgl_update_safety_mode(safety_mode);
-        lvgl_update_robot_mode(robot_mode);
-        vTaskDelay(10);
+        DV8_BINLOG(UI_UPDATES, applied, skipped);
+#if CONFIG_DV8_STATE_CACHE && !CONFIG_DV8_FLEET_MODE
+        DV8_BINLOG(CACHE_WRITES, dv8_state_cache_writes());
+#endif
+        lvgl_cmd_stats_t cmds;
+        lvgl_cmd_get_stats(&cmds);
+        DV8_BINLOG(UI_COMMANDS, cmds.posted, cmds.coalesced, cmds.dropped, cmds.depth, cmds.max_depth);
+        lvgl_pacer_stats_t frames;
+        lvgl_pacer_get_stats(&frames);
+        DV8_BINLOG(FRAMES, frames.rendered, frames.skipped, frames.dropped, frames.period_ms, frames.max_cost_us,
+                   lvgl_rgb565_be_get_fallbacks());
+#if !CONFIG_DV8_FLEET_MODE
+        lvgl_sprite_stats_t sprites;
+        lvgl_sprite_get_stats(&sprites);
+        uint32_t drawn = sprites.hits + sprites.misses + sprites.bypassed;
+        DV8_BINLOG(SPRITES, sprites.hits, sprites.misses + sprites.bypassed, drawn ? (uint32_t)((uint64_t)sprites.hits * 100 / drawn) : 0,
+                   sprites.captures, sprites.evictions, sprites.looks, sprites.bytes, sprites.pool_bytes);
+#endif
+        uint32_t flush_bytes = atomic_load_explicit(&lcd_flush_bytes, memory_order_relaxed);
+        uint32_t flush_busy_us = atomic_load_explicit(&lcd_flush_busy_us, memory_order_relaxed);
+        uint32_t bytes = flush_bytes - last_flush_bytes;
+        uint32_t busy_us = flush_busy_us - last_flush_busy_us;
+        last_flush_bytes = flush_bytes;
+        last_flush_busy_us = flush_busy_us;
+        uint32_t windows = atomic_exchange_explicit(&lcd_flush_windows, 0, memory_order_relaxed);
+        uint32_t merged = atomic_exchange_explicit(&lcd_flush_merged, 0, memory_order_relaxed);
+        // kB/s while transferring, against the pixel clock / 8 bits
+        uint32_t busy_kbps = busy_us ? (uint32_t)((uint64_t)bytes * 1000 / busy_us) : 0;
+        uint32_t ceiling_kbps = EXAMPLE_LCD_PIXEL_CLOCK_HZ / 8 / 1000;
+        DV8_BINLOG(SPI, bytes / 1000, busy_us / 1000, busy_kbps, ceiling_kbps, busy_kbps * 100 / ceiling_kbps, windows, merged);
+#if CONFIG_EXAMPLE_LCD_TOUCH_CONTROLLER_STMPE610
+        dv8_touch_stats_t touch;
+        dv8_touch_get_stats(&touch);
+        DV8_BINLOG(TOUCH, touch.irqs, touch.samples, touch.discarded, touch.events, touch.transactions,
+                   touch.bus_us / 1000, touch.yields, touch.max_latency_us);
+#endif
+        uint32_t wakeups = atomic_exchange_explicit(&lvgl_task_wakeups, 0, memory_order_relaxed);
+        int64_t period_ms = MAX((now_us - last_stats_us) / 1000, 1);
+        DV8_BINLOG(WAKEUPS, wakeups, (uint32_t)(wakeups * 1000LL / period_ms), (uint32_t)(wakeups * 100000LL / period_ms % 100));
+        last_stats_us = now_us;
     }
 }
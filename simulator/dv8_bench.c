@@ -0,0 +1,148 @@
+/*
+ * Payload format benchmark: for every robot topic, bytes on the wire and decode time per message
+ * of the JSON text the robot sends today against the packed encoding (main/dv8_packed.h).
+ *
+ * Decoders measured:
+ *   dv8_json   the allocation-free flat JSON decoder dv8_message_handle() tries first
+ *   packed     dv8_packed_decode()
+ *   cJSON      cJSON_ParseWithLength + cJSON_GetObjectItem per field, the original path
+ *              (only when the simulator was built with cJSON)
+ *
+ * Usage: dv8_bench [iterations per topic]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "dv8_json.h"
+#include "dv8_packed.h"
+#include "dv8_state.h"
+#include "dv8_topics.h"
+#include "sim_display.h"
+#ifndef DV8_NO_CJSON
+#include <cJSON.h>
+#endif
+
+#define BENCH_DEFAULT_ITERATIONS 200000
+
+// Values like the ones seen in the field, so the JSON has realistic number lengths
+static const dv8_robot_state_t sample_state = {
+    .linear_x = 0.35f,
+    .angular_z = -0.125f,
+    .battery_percentage = 87.5f,
+    .brush_speed = 1200,
+    .battery_is_charging = 0,
+    .e_stop = 1,
+    .handbrake = 0,
+    .direct_status = 1,
+    .robot_mode = 2,
+    .safety_mode = 1,
+};
+
+// Same shape as the robot's json.dumps(): {"key": value, "key": value}
+static size_t format_json(uint32_t fields, char *out, size_t size)
+{
+    size_t len = snprintf(out, size, "{");
+    for (int field = 0; field < DV8_FIELD_COUNT; field++) {
+        if (fields & DV8_FIELD_BIT(field)) {
+            len += snprintf(out + len, size - len, "%s\"%s\": %.15g", len > 1 ? ", " : "",
+                            dv8_field_info[field].name, dv8_state_get_field(&sample_state, field));
+        }
+    }
+    len += snprintf(out + len, size - len, "}");
+    return len;
+}
+
+#ifndef DV8_NO_CJSON
+static bool decode_cjson(const char *data, size_t data_len, uint32_t fields, dv8_robot_state_t *state)
+{
+    cJSON *json = cJSON_ParseWithLength(data, data_len);
+    if (json == NULL) {
+        return false;
+    }
+    for (int field = 0; field < DV8_FIELD_COUNT; field++) {
+        if (fields & DV8_FIELD_BIT(field)) {
+            cJSON *item = cJSON_GetObjectItem(json, dv8_field_info[field].name);
+            if (item != NULL) {
+                dv8_state_set_field(state, field, cJSON_GetNumberValue(item));
+            }
+        }
+    }
+    cJSON_Delete(json);
+    return true;
+}
+#endif
+
+typedef bool (*decode_fn_t)(const char *data, size_t data_len, uint32_t fields, dv8_robot_state_t *state);
+
+static double time_decode(decode_fn_t decode, const char *data, size_t data_len, uint32_t fields, unsigned iterations)
+{
+    dv8_robot_state_t state = {0};
+
+    uint64_t start_us = sim_monotonic_us();
+    for (unsigned i = 0; i < iterations; i++) {
+        if (!decode(data, data_len, fields, &state)) {
+            fprintf(stderr, "decode failed\n");
+            exit(1);
+        }
+    }
+    uint64_t elapsed_us = sim_monotonic_us() - start_us;
+
+    // Also keeps the compiler from dropping the loop
+    if (dv8_state_diff(&state, &sample_state) & fields) {
+        fprintf(stderr, "decoded values differ\n");
+        exit(1);
+    }
+    return elapsed_us * 1000.0 / iterations;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned iterations = argc > 1 ? strtoul(argv[1], NULL, 10) : BENCH_DEFAULT_ITERATIONS;
+    if (iterations == 0) {
+        fprintf(stderr, "usage: %s [iterations per topic]\n", argv[0]);
+        return 2;
+    }
+
+    size_t total_json = 0, total_packed = 0;
+    double total_json_ns = 0, total_packed_ns = 0;
+#ifndef DV8_NO_CJSON
+    double total_cjson_ns = 0;
+#endif
+
+    printf("%-36s %6s %6s %10s %10s %10s\n", "topic", "json B", "pack B", "dv8_json", "packed", "cJSON");
+    for (size_t i = 0; i < dv8_topic_count; i++) {
+        const dv8_topic_t *topic = &dv8_topics[i];
+        char json[256];
+        uint8_t packed[DV8_PACKED_MAX_SIZE];
+        size_t json_len = format_json(topic->fields, json, sizeof(json));
+        size_t packed_len = dv8_packed_encode(&sample_state, topic->fields, packed, sizeof(packed));
+
+        double json_ns = time_decode(dv8_json_decode, json, json_len, topic->fields, iterations);
+        double packed_ns = time_decode(dv8_packed_decode, (const char *)packed, packed_len, topic->fields, iterations);
+#ifndef DV8_NO_CJSON
+        double cjson_ns = time_decode(decode_cjson, json, json_len, topic->fields, iterations);
+        char cjson_text[16];
+        snprintf(cjson_text, sizeof(cjson_text), "%.1f", cjson_ns);
+        total_cjson_ns += cjson_ns;
+#else
+        const char *cjson_text = "-";
+#endif
+
+        printf("%-36s %6zu %6zu %10.1f %10.1f %10s\n", topic->topic, json_len, packed_len, json_ns, packed_ns, cjson_text);
+        total_json += json_len;
+        total_packed += packed_len;
+        total_json_ns += json_ns;
+        total_packed_ns += packed_ns;
+    }
+
+    printf("%-36s %6zu %6zu %10.1f %10.1f ", "per message, average", total_json / dv8_topic_count,
+           total_packed / dv8_topic_count, total_json_ns / dv8_topic_count, total_packed_ns / dv8_topic_count);
+#ifndef DV8_NO_CJSON
+    printf("%10.1f\n", total_cjson_ns / dv8_topic_count);
+#else
+    printf("%10s\n(built without cJSON)\n", "-");
+#endif
+    return 0;
+}
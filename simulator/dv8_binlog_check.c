@@ -0,0 +1,289 @@
+/*
+ * Binary log check: writes records through dv8_binlog_write() the way the firmware's tasks do,
+ * drains them, and walks dumps of the ring with dv8_binlog_dump_next(), against a model of
+ * every record written: id, args, time and its position in the ring.
+ *
+ *   rounds   a random batch of records of every message, args included, then a dump and a
+ *            drain. The positions run through many laps of the ring and past the 8-bit lap
+ *            counter in the headers.
+ *   full     records until the ring refuses one, a dump of the full ring, a drain, and the
+ *            LOG_DROPPED record the drain adds for the drops.
+ *   format   dv8_binlog_format() against fixed text: %T, %F, %f, flags, missing args and
+ *            truncation.
+ *
+ * Every drained and every dumped record must match the model, and format to the same text as
+ * the model's record. Exits 1 on the first mismatch.
+ *
+ * Usage: dv8_binlog_check [--rounds N] [--seed N]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include "dv8_binlog.h"
+#include "dv8_state.h"
+#include "dv8_topics.h"
+
+#define CHECK_DEFAULT_ROUNDS    2000        // ~360k words, the lap counter wraps at 256 * 1024
+#define CHECK_MAX_BATCH         60          // records per round, well below a ringful
+#define CHECK_MODEL_SIZE        1024        // power of two, more than a ringful of records
+#define CHECK_LINE_SIZE         256
+
+typedef struct {
+    dv8_binlog_record_t record;
+    uint32_t pos;           // first word in the ring, counting from 0 forever
+} model_record_t;
+
+static model_record_t model[CHECK_MODEL_SIZE];
+static uint32_t model_count;        // records written so far
+static uint32_t model_drained;      // ... of which dv8_binlog_drain() emitted
+static uint32_t model_head;         // the ring's write position
+static uint32_t dropped_reported;   // drops dv8_binlog_drain() has logged
+
+static uint32_t clock_ms;
+
+
+static void fail(const char *what, uint32_t record)
+{
+    fprintf(stderr, "FAIL: %s, record %" PRIu32 "\n", what, record);
+    exit(1);
+}
+
+static uint32_t check_clock(void)
+{
+    return clock_ms;
+}
+
+// Args a record of message `id` carries, one per conversion
+static unsigned message_args(dv8_binlog_id_t id)
+{
+    unsigned count = 0;
+    for (const char *pct = strchr(dv8_binlog_messages[id].format, '%'); pct != NULL; pct = strchr(pct, '%')) {
+        if (pct[1] == '%') {
+            pct += 2;
+            continue;
+        }
+        count++;
+        pct++;
+    }
+    return count;
+}
+
+static void model_add(dv8_binlog_id_t id, const uint32_t *args, uint8_t nargs)
+{
+    model_record_t *m = &model[model_count % CHECK_MODEL_SIZE];
+    m->record = (dv8_binlog_record_t) { .time_ms = clock_ms, .id = id, .nargs = nargs };
+    memcpy(m->record.args, args, nargs * sizeof(args[0]));
+    m->pos = model_head;
+    model_head += 2 + nargs;
+    model_count++;
+}
+
+// A record of message `id` with random args; false if the ring was full
+static bool write_random(dv8_binlog_id_t id)
+{
+    uint32_t args[DV8_BINLOG_MAX_ARGS];
+    unsigned nargs = message_args(id);
+
+    for (unsigned i = 0; i < nargs; i++) {
+        // Small values too, so %T and %F name real topics and fields now and then
+        args[i] = rand() % 4 ? (uint32_t)rand() % 16 : (uint32_t)rand() << 16 ^ (uint32_t)rand();
+    }
+    clock_ms += rand() % 50;
+    if (!dv8_binlog_write(id, args, nargs)) {
+        return false;
+    }
+    model_add(id, args, nargs);
+    return true;
+}
+
+static void compare(const model_record_t *m, const dv8_binlog_record_t *record, uint32_t index, const char *where)
+{
+    char expected[CHECK_LINE_SIZE], got[CHECK_LINE_SIZE];
+    char what[64];
+
+    if (record->id != m->record.id || record->nargs != m->record.nargs || record->time_ms != m->record.time_ms ||
+            memcmp(record->args, m->record.args, record->nargs * sizeof(record->args[0])) != 0) {
+        snprintf(what, sizeof(what), "%s record differs from the one written", where);
+        fail(what, index);
+    }
+    dv8_binlog_format(expected, sizeof(expected), &m->record);
+    dv8_binlog_format(got, sizeof(got), record);
+    if (strcmp(expected, got) != 0) {
+        fprintf(stderr, "FAIL: %s record %" PRIu32 " formats as \"%s\", expected \"%s\"\n", where, index, got, expected);
+        exit(1);
+    }
+}
+
+static void emit_cb(const dv8_binlog_record_t *record)
+{
+    if (model_drained == model_count) {
+        fail("drained a record that was never written", model_drained);
+    }
+    compare(&model[model_drained % CHECK_MODEL_SIZE], record, model_drained, "drained");
+    model_drained++;
+}
+
+static void drain(void)
+{
+    dv8_binlog_drain(emit_cb);
+    if (model_drained != model_count) {
+        fail("drain stopped short of the last record written", model_drained);
+    }
+
+    // The drain logs new drops into the ring itself, emitted by the next one
+    dv8_binlog_stats_t stats;
+    dv8_binlog_get_stats(&stats);
+    if (stats.dropped != dropped_reported) {
+        uint32_t count = stats.dropped - dropped_reported;
+        model_add(DV8_BINLOG_LOG_DROPPED, &count, 1);
+        dropped_reported = stats.dropped;
+    }
+}
+
+// The dump holds every record that starts within the last ringful, oldest first
+static void check_dump(void)
+{
+    static uint8_t dump[DV8_BINLOG_DUMP_SIZE];
+    dv8_binlog_reader_t reader;
+    dv8_binlog_record_t record;
+
+    dv8_binlog_dump(dump);
+    if (!dv8_binlog_reader_init(&reader, dump, sizeof(dump))) {
+        fail("dv8_binlog_reader_init() refused the dump", model_count);
+    }
+    uint32_t first = model_head > DV8_BINLOG_RING_WORDS ? model_head - DV8_BINLOG_RING_WORDS : 0;
+    uint32_t index = model_count;
+    while (index > 0 && model_count - index < CHECK_MODEL_SIZE - 1 && model[(index - 1) % CHECK_MODEL_SIZE].pos >= first) {
+        index--;
+    }
+    for (; dv8_binlog_dump_next(&reader, &record); index++) {
+        if (index == model_count) {
+            fail("dump has a record past the last one written", index);
+        }
+        compare(&model[index % CHECK_MODEL_SIZE], &record, index, "dumped");
+    }
+    if (index != model_count) {
+        fail("dump ends before the last record written", index);
+    }
+}
+
+static void check_rounds(unsigned rounds)
+{
+    for (unsigned round = 0; round < rounds; round++) {
+        unsigned batch = 1 + rand() % CHECK_MAX_BATCH;
+        for (unsigned i = 0; i < batch; i++) {
+            if (!write_random(rand() % DV8_BINLOG_MESSAGE_COUNT)) {
+                fail("ring full below a ringful", model_count);
+            }
+        }
+        check_dump();
+        drain();
+    }
+}
+
+static void check_full(void)
+{
+    uint32_t written = 0;
+
+    while (write_random(rand() % DV8_BINLOG_MESSAGE_COUNT)) {
+        written++;
+    }
+    // Then the smallest records, one arg, until not even those fit
+    while (write_random(DV8_BINLOG_CACHE_WRITES)) {
+        written++;
+    }
+    if (model_head - model[model_drained % CHECK_MODEL_SIZE].pos + 3 <= DV8_BINLOG_RING_WORDS) {
+        fail("ring refused a record with room left", model_count);
+    }
+    for (unsigned i = 0; i < 4; i++) {
+        if (write_random(DV8_BINLOG_CACHE_WRITES)) {
+            fail("ring took a record past full", model_count);
+        }
+    }
+    dv8_binlog_stats_t stats;
+    dv8_binlog_get_stats(&stats);
+    uint32_t dropped = stats.dropped - dropped_reported;
+
+    check_dump();
+    drain();
+    const dv8_binlog_record_t *logged = &model[(model_count - 1) % CHECK_MODEL_SIZE].record;
+    if (logged->id != DV8_BINLOG_LOG_DROPPED || logged->args[0] != dropped) {
+        fail("drain didn't log the records dropped", model_count);
+    }
+    check_dump();
+    drain();
+    printf("full: %" PRIu32 " records filled the ring, %" PRIu32 " dropped and logged\n", written, dropped);
+}
+
+static void expect_text(const dv8_binlog_record_t *record, const char *expected)
+{
+    char line[CHECK_LINE_SIZE];
+    int len = dv8_binlog_format(line, sizeof(line), record);
+    if (strcmp(line, expected) != 0 || len != (int)strlen(expected)) {
+        fprintf(stderr, "FAIL: formatted \"%s\" (%d), expected \"%s\"\n", line, len, expected);
+        exit(1);
+    }
+}
+
+static void check_format(void)
+{
+    char expected[CHECK_LINE_SIZE];
+
+    snprintf(expected, sizeof(expected), "%s = 82.50 (3 changes not logged)", dv8_field_info[DV8_FIELD_BATTERY_PERCENTAGE].name);
+    expect_text(&(dv8_binlog_record_t) { .id = DV8_BINLOG_STATE, .nargs = 3,
+                                         .args = { DV8_FIELD_BATTERY_PERCENTAGE, DV8_BINLOG_F(82.5f), 3 } }, expected);
+    snprintf(expected, sizeof(expected), "field %d = -1.00 (0 changes not logged)", DV8_FIELD_COUNT);
+    expect_text(&(dv8_binlog_record_t) { .id = DV8_BINLOG_STATE, .nargs = 3, .args = { DV8_FIELD_COUNT, DV8_BINLOG_F(-1.0f), 0 } },
+                expected);
+    snprintf(expected, sizeof(expected), "received %s, 12 bytes", dv8_topics[0].topic);
+    expect_text(&(dv8_binlog_record_t) { .id = DV8_BINLOG_RECEIVED, .nargs = 2, .args = { 0, 12 } }, expected);
+    snprintf(expected, sizeof(expected), "topic %u: 70000 bytes didn't parse", (unsigned)dv8_topic_count);
+    expect_text(&(dv8_binlog_record_t) { .id = DV8_BINLOG_BAD_PAYLOAD, .nargs = 2, .args = { dv8_topic_count, 70000 } },
+                expected);
+    expect_text(&(dv8_binlog_record_t) { .id = DV8_BINLOG_WAKEUPS, .nargs = 3, .args = { 7, 1, 5 } },
+                "LVGL wakeups: 7 (1.05/s)");
+    // A record short of args, as a stale dump might hold
+    expect_text(&(dv8_binlog_record_t) { .id = DV8_BINLOG_UI_UPDATES, .nargs = 1, .args = { 4 } },
+                "UI updates applied: 4, skipped: ?");
+
+    // Truncated like snprintf: the full length back, as much as fits written
+    char small[8];
+    dv8_binlog_record_t record = { .id = DV8_BINLOG_UI_UPDATES, .nargs = 2, .args = { 4, 5 } };
+    int len = dv8_binlog_format(small, sizeof(small), &record);
+    if (len != (int)strlen("UI updates applied: 4, skipped: 5") || strcmp(small, "UI upda") != 0) {
+        fprintf(stderr, "FAIL: truncated to \"%s\" (%d)\n", small, len);
+        exit(1);
+    }
+    printf("format: ok\n");
+}
+
+int main(int argc, char **argv)
+{
+    unsigned rounds = CHECK_DEFAULT_ROUNDS, seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+            rounds = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoul(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "usage: %s [--rounds N] [--seed N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    srand(seed);
+    dv8_topics_init();
+    dv8_binlog_set_clock(check_clock);
+
+    check_format();
+    check_rounds(rounds);
+    printf("rounds: %u, %" PRIu32 " records in %" PRIu32 " words, %" PRIu32 " laps of the ring\n", rounds,
+           model_count, model_head, model_head / DV8_BINLOG_RING_WORDS);
+    check_full();
+    check_rounds(rounds / 10);
+    return 0;
+}
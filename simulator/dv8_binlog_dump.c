@@ -0,0 +1,125 @@
+/*
+ * Decodes a dump of the firmware's binary log ring (see main/dv8_binlog.h) into the lines the
+ * log task would have printed, oldest first:
+ *   I (123456) example: UI updates applied: 12, skipped: 3
+ *
+ * The dump is either the raw DV8_BINLOG_DUMP_SIZE bytes, or the hex the "binlog dump" console
+ * command prints. For hex, a whole console capture can be passed as it is: only lines made of
+ * hex digits are read, so prompts and log lines printed in between are skipped.
+ *
+ * Usage: dv8_binlog_dump [--level E|W|I|D|V] dump.bin|dump.txt|-
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdbool.h>
+#include "dv8_binlog.h"
+
+static const char LEVELS[] = "EWIDV";
+
+
+static bool hex_line(const char *line)
+{
+    bool any = false;
+    for (; *line != '\0'; line++) {
+        if (isxdigit((unsigned char)*line)) {
+            any = true;
+        } else if (!isspace((unsigned char)*line)) {
+            return false;
+        }
+    }
+    return any;
+}
+
+// Raw dumps are taken as they are, anything else is read as hex lines
+static size_t read_dump(FILE *f, uint8_t *dump, size_t size)
+{
+    size_t len = fread(dump, 1, 4, f);
+    if (len == 4 && memcmp(dump, DV8_BINLOG_DUMP_MAGIC, 4) == 0) {
+        return len + fread(dump + len, 1, size - len, f);
+    }
+
+    char line[512];
+    size_t n = 0;
+    // The 4 bytes already read start the first line
+    memcpy(line, dump, len);
+    line[len] = '\0';
+    if (fgets(line + len, sizeof(line) - len, f) == NULL && len == 0) {
+        return 0;
+    }
+    do {
+        if (!hex_line(line)) {
+            continue;
+        }
+        int hi = -1;
+        for (const char *c = line; *c != '\0' && n < size; c++) {
+            if (!isxdigit((unsigned char)*c)) {
+                continue;
+            }
+            int digit = isdigit((unsigned char)*c) ? *c - '0' : tolower((unsigned char)*c) - 'a' + 10;
+            if (hi < 0) {
+                hi = digit;
+            } else {
+                dump[n++] = (uint8_t)(hi << 4 | digit);
+                hi = -1;
+            }
+        }
+    } while (fgets(line, sizeof(line), f) != NULL);
+    return n;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = NULL;
+    const char *max_level = strchr(LEVELS, 'V');
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--level") == 0 && i + 1 < argc && strlen(argv[i + 1]) == 1 &&
+            strchr(LEVELS, argv[i + 1][0]) != NULL) {
+            max_level = strchr(LEVELS, argv[++i][0]);
+        } else if (path == NULL && (argv[i][0] != '-' || strcmp(argv[i], "-") == 0)) {
+            path = argv[i];
+        } else {
+            path = NULL;
+            break;
+        }
+    }
+    if (path == NULL) {
+        fprintf(stderr, "usage: %s [--level E|W|I|D|V] dump.bin|dump.txt|-\n", argv[0]);
+        return 2;
+    }
+
+    FILE *f = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return 1;
+    }
+    static uint8_t dump[DV8_BINLOG_DUMP_SIZE];
+    size_t len = read_dump(f, dump, sizeof(dump));
+    if (f != stdin) {
+        fclose(f);
+    }
+
+    dv8_binlog_reader_t reader;
+    if (!dv8_binlog_reader_init(&reader, dump, len)) {
+        fprintf(stderr, "%s: not a %u byte binlog dump (%zu bytes)\n", path, (unsigned)DV8_BINLOG_DUMP_SIZE, len);
+        return 1;
+    }
+
+    dv8_binlog_record_t record;
+    unsigned count = 0;
+    while (dv8_binlog_dump_next(&reader, &record)) {
+        const dv8_binlog_message_t *msg = &dv8_binlog_messages[record.id];
+        if (strchr(LEVELS, msg->level) > max_level) {
+            continue;
+        }
+        char line[256];
+        dv8_binlog_format(line, sizeof(line), &record);
+        printf("%c (%u) %s: %s\n", msg->level, (unsigned)record.time_ms, msg->tag, line);
+        count++;
+    }
+    fprintf(stderr, "%u records, ring written up to word %u\n", count, (unsigned)reader.head);
+    return 0;
+}
@@ -0,0 +1,341 @@
+/*
+ * Fleet mode load generator: a producer thread publishes the usual robot topics for many robots
+ * under DV8_TOPIC_PREFIX "/<id>/..." into dv8_fleet_handle(), paced on the wall clock like the
+ * MQTT task would see them, while the main thread runs the fleet overview (lvgl_fleet.c) at one
+ * LVGL frame per LV_DEF_REFR_PERIOD into the memory framebuffer of sim_display.c.
+ *
+ * Every robot sends --rate messages per second, cycling through the topics with values that
+ * drift like a working robot's (battery drains, modes and flags change now and then). At the end
+ * the summary goes to stderr:
+ *   messages sent and achieved rate, decode cost per message, the producer's worst lag behind
+ *   its schedule, how long each UI frame spent in lvgl_fleet_sync() + lv_timer_handler(), rows
+ *   redrawn, and a check that every robot's snapshot ended up equal to what it last sent
+ *
+ * --metrics-ms N also runs dv8_metrics like the firmware does (lvgl_pacer on the display, a
+ * report every N ms from an lv_timer), prints each <prefix>/ui/metrics payload to stdout and
+ * what the reports cost.
+ *
+ * Usage: dv8_fleet_load [--robots N] [--rate HZ] [--seconds S] [--packed] [--metrics-ms N] [--dump-ppm out.ppm]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <time.h>
+#include "lvgl.h"
+#include "dv8_fleet.h"
+#include "dv8_metrics.h"
+#include "dv8_packed.h"
+#include "dv8_topics.h"
+#include "lvgl_fleet.h"
+#include "lvgl_pacer.h"
+#include "sim_display.h"
+
+#define LOAD_FRAME_MS           LV_DEF_REFR_PERIOD
+
+typedef struct {
+    unsigned robots;
+    unsigned rate;
+    unsigned seconds;
+    bool packed;
+    unsigned metrics_ms;
+} load_config_t;
+
+typedef struct {
+    uint64_t sent;
+    uint64_t results[DV8_MESSAGE_BAD_PAYLOAD + 1];
+    uint64_t handle_us;         // time spent inside dv8_fleet_handle()
+    uint64_t max_lag_us;        // worst distance behind the send schedule
+    uint32_t reports;
+    uint64_t report_us;         // time spent in the metrics timer, lv_mem_monitor() included
+    uint64_t max_report_us;
+} load_result_t;
+
+static load_config_t config = { .robots = 250, .rate = 10, .seconds = 5, .packed = false };
+static load_result_t result;
+// What each robot last sent, compared with its fleet snapshot at the end
+static dv8_robot_state_t *truth;
+static uint64_t start_us;
+static volatile bool producer_done = false;
+
+
+static uint32_t load_tick_cb(void)
+{
+    return (sim_monotonic_us() - start_us) / 1000;
+}
+
+static int64_t load_clock_us(void)
+{
+    return sim_monotonic_us() - start_us;
+}
+
+// example_metrics_timer_cb of spi_lcd_main.c, minus the SPI counters the memory framebuffer has not
+static void metrics_timer_cb(lv_timer_t *timer)
+{
+    static char payload[768];
+    uint64_t before_us = sim_monotonic_us();
+
+    lv_mem_monitor_t mem;
+    lv_mem_monitor(&mem);
+    lvgl_pacer_stats_t frames;
+    lvgl_pacer_get_stats(&frames);
+    dv8_metrics_sample_t sample = {
+        .heap_total = mem.total_size,
+        .heap_free = mem.free_size,
+        .heap_biggest_free = mem.free_biggest_size,
+        .heap_max_used = mem.max_used,
+        .heap_frag_pct = mem.frag_pct,
+        .frames_dropped = frames.dropped,
+    };
+    int len = dv8_metrics_report(&sample, payload, sizeof(payload));
+
+    uint64_t cost_us = sim_monotonic_us() - before_us;
+    result.reports++;
+    result.report_us += cost_us;
+    result.max_report_us = cost_us > result.max_report_us ? cost_us : result.max_report_us;
+    printf("%.*s\n", len < (int)sizeof(payload) ? len : (int)sizeof(payload) - 1, payload);
+}
+
+static uint32_t xorshift(void)
+{
+    static uint32_t x = 2463534242u;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+// Move the fields `topic` carries along, the way a robot at work would
+static void drift(dv8_robot_state_t *state, uint32_t fields)
+{
+    if (fields & DV8_FIELD_BIT(DV8_FIELD_LINEAR_X)) {
+        state->linear_x = (int)(xorshift() % 101 - 50) / 100.0f;
+        state->angular_z = (int)(xorshift() % 101 - 50) / 100.0f;
+    }
+    if (fields & DV8_FIELD_BIT(DV8_FIELD_BATTERY_PERCENTAGE)) {
+        state->battery_percentage = state->battery_percentage <= 5 ? 100 : state->battery_percentage - 0.5f;
+    }
+    if (fields & DV8_FIELD_BIT(DV8_FIELD_BATTERY_IS_CHARGING) && xorshift() % 50 == 0) {
+        state->battery_is_charging = !state->battery_is_charging;
+    }
+    if (fields & DV8_FIELD_BIT(DV8_FIELD_E_STOP) && xorshift() % 100 == 0) {
+        state->e_stop = !state->e_stop;
+    }
+    if (fields & DV8_FIELD_BIT(DV8_FIELD_HANDBRAKE) && xorshift() % 50 == 0) {
+        state->handbrake = !state->handbrake;
+    }
+    if (fields & DV8_FIELD_BIT(DV8_FIELD_DIRECT_STATUS) && xorshift() % 50 == 0) {
+        state->direct_status = !state->direct_status;
+    }
+    if (fields & DV8_FIELD_BIT(DV8_FIELD_ROBOT_MODE) && xorshift() % 20 == 0) {
+        state->robot_mode = 1 + xorshift() % 4;
+    }
+    if (fields & DV8_FIELD_BIT(DV8_FIELD_SAFETY_MODE) && xorshift() % 100 == 0) {
+        state->safety_mode = !state->safety_mode;
+    }
+}
+
+// Same shape as the robot's json.dumps(): {"key": value, "key": value}
+static size_t format_json(const dv8_robot_state_t *state, uint32_t fields, char *out, size_t size)
+{
+    size_t len = snprintf(out, size, "{");
+    for (int field = 0; field < DV8_FIELD_COUNT; field++) {
+        if (fields & DV8_FIELD_BIT(field)) {
+            len += snprintf(out + len, size - len, "%s\"%s\": %.9g", len > 1 ? ", " : "",
+                            dv8_field_info[field].name, dv8_state_get_field(state, field));
+        }
+    }
+    len += snprintf(out + len, size - len, "}");
+    return len;
+}
+
+static void sleep_us(uint64_t us)
+{
+    struct timespec ts = { .tv_sec = us / 1000000, .tv_nsec = (us % 1000000) * 1000 };
+    nanosleep(&ts, NULL);
+}
+
+// Message n goes out at n / (robots * rate) s, to robot n % robots, robots take turns per topic
+static void *producer(void *arg)
+{
+    const uint64_t total = (uint64_t)config.robots * config.rate * config.seconds;
+    const uint64_t per_second = (uint64_t)config.robots * config.rate;
+    const size_t prefix_len = strlen(DV8_TOPIC_PREFIX);
+
+    while (result.sent < total) {
+        uint64_t now_us = sim_monotonic_us() - start_us;
+        uint64_t due = now_us * per_second / 1000000 + 1;
+        if (due > total) {
+            due = total;
+        }
+
+        for (; result.sent < due; result.sent++) {
+            uint64_t n = result.sent;
+            unsigned robot = n % config.robots;
+            const dv8_topic_t *topic = &dv8_topics[(n / config.robots) % dv8_topic_count];
+
+            uint64_t scheduled_us = n * 1000000 / per_second;
+            uint64_t lag_us = sim_monotonic_us() - start_us - scheduled_us;
+            if (lag_us > result.max_lag_us && lag_us < (1ULL << 63)) {
+                result.max_lag_us = lag_us;
+            }
+
+            char name[128], payload[256];
+            int name_len = snprintf(name, sizeof(name), "%s/dv8-%03u%s", DV8_TOPIC_PREFIX, robot,
+                                    topic->topic + prefix_len);
+            drift(&truth[robot], topic->fields);
+            size_t payload_len = config.packed
+                ? dv8_packed_encode(&truth[robot], topic->fields, (uint8_t *)payload, sizeof(payload))
+                : format_json(&truth[robot], topic->fields, payload, sizeof(payload));
+
+            uint64_t before_us = sim_monotonic_us();
+            dv8_message_result_t res = dv8_fleet_handle(name, name_len, payload, payload_len, before_us, NULL);
+            result.handle_us += sim_monotonic_us() - before_us;
+            result.results[res]++;
+            dv8_metrics_message(res);
+        }
+        sleep_us(1000);
+    }
+    producer_done = true;
+    return NULL;
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+int main(int argc, char **argv)
+{
+    const char *ppm_path = NULL;
+    bool usage = false;
+
+    for (int i = 1; i < argc && !usage; i++) {
+        if (strcmp(argv[i], "--robots") == 0 && i + 1 < argc) {
+            config.robots = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            config.rate = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            config.seconds = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--packed") == 0) {
+            config.packed = true;
+        } else if (strcmp(argv[i], "--metrics-ms") == 0 && i + 1 < argc) {
+            config.metrics_ms = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--dump-ppm") == 0 && i + 1 < argc) {
+            ppm_path = argv[++i];
+        } else {
+            usage = true;
+        }
+    }
+    if (usage || config.robots == 0 || config.robots > 1000 || config.rate == 0 || config.seconds == 0) {
+        fprintf(stderr, "usage: %s [--robots N (1-1000)] [--rate HZ] [--seconds S] [--packed] [--metrics-ms N]"
+                        " [--dump-ppm out.ppm]\n", argv[0]);
+        return 2;
+    }
+
+    truth = calloc(config.robots, sizeof(*truth));
+    size_t max_frames = config.seconds * 1000 / LOAD_FRAME_MS + 16;
+    uint32_t *frame_us = calloc(max_frames, sizeof(*frame_us));
+    if (truth == NULL || frame_us == NULL) {
+        perror("calloc");
+        return 1;
+    }
+
+    // Robots start idle with safety on, the snapshots only catch up once each topic went out
+    for (unsigned i = 0; truth != NULL && i < config.robots; i++) {
+        truth[i].robot_mode = 1;
+        truth[i].safety_mode = 1;
+        truth[i].battery_percentage = 100 - i % 50;
+    }
+
+    dv8_topics_init();
+    start_us = sim_monotonic_us();
+    lv_init();
+    lv_tick_set_cb(load_tick_cb);
+    lv_display_t *display = sim_display_create();
+    lvgl_fleet_ui(display);
+    if (config.metrics_ms > 0) {
+        lvgl_pacer_attach(display, load_clock_us);
+        dv8_metrics_set_clock(load_clock_us);
+        lv_timer_create(metrics_timer_cb, config.metrics_ms, NULL);
+    }
+    lv_refr_now(display);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, producer, NULL) != 0) {
+        perror("pthread_create");
+        return 1;
+    }
+
+    // UI side, as the LVGL task and app_main loop would run it
+    size_t frames = 0;
+    uint64_t next_frame_us = sim_monotonic_us();
+    while (!producer_done && frames < max_frames) {
+        uint64_t before_us = sim_monotonic_us();
+        lvgl_fleet_sync();
+        lv_timer_handler();
+        uint64_t after_us = sim_monotonic_us();
+        frame_us[frames++] = after_us - before_us;
+        dv8_metrics_pass(after_us - before_us);
+
+        next_frame_us += LOAD_FRAME_MS * 1000;
+        if (next_frame_us > after_us) {
+            sleep_us(next_frame_us - after_us);
+        }
+    }
+    pthread_join(thread, NULL);
+    uint64_t wall_us = sim_monotonic_us() - start_us;
+    lvgl_fleet_sync();
+    lv_refr_now(display);
+
+    // Every message was applied if each robot's snapshot matches what it sent last
+    unsigned mismatched = 0;
+    for (size_t i = 0; i < dv8_fleet_count(); i++) {
+        dv8_robot_state_t state;
+        dv8_fleet_read(i, &state);
+        unsigned robot = strtoul(dv8_fleet_id(i) + 4, NULL, 10);
+        if (robot >= config.robots || dv8_state_diff(&state, &truth[robot]) != 0) {
+            mismatched++;
+        }
+    }
+
+    dv8_fleet_stats_t fleet;
+    dv8_fleet_get_stats(&fleet);
+    fprintf(stderr, "robots: %u at %u Hz for %u s, %s payloads\n", config.robots, config.rate, config.seconds,
+            config.packed ? "packed" : "JSON");
+    fprintf(stderr, "messages: %" PRIu64 " in %.3f s, %.0f messages/s (changed %" PRIu64 ", unchanged %" PRIu64
+            ", unknown topic %" PRIu64 ", fleet full %" PRIu64 ", bad payload %" PRIu64 ")\n",
+            result.sent, wall_us / 1e6, wall_us ? result.sent * 1e6 / wall_us : 0.0,
+            result.results[DV8_MESSAGE_CHANGED], result.results[DV8_MESSAGE_UNCHANGED],
+            result.results[DV8_MESSAGE_UNKNOWN_TOPIC], result.results[DV8_MESSAGE_FLEET_FULL],
+            result.results[DV8_MESSAGE_BAD_PAYLOAD]);
+    fprintf(stderr, "dv8_fleet_handle: %.0f ns per message, %.1f%% of one core; producer lag max %.1f ms\n",
+            result.sent ? result.handle_us * 1000.0 / result.sent : 0.0,
+            wall_us ? result.handle_us * 100.0 / wall_us : 0.0, result.max_lag_us / 1000.0);
+
+    if (frames > 0) {
+        qsort(frame_us, frames, sizeof(*frame_us), compare_u32);
+        fprintf(stderr, "UI frames: %zu, sync + timers us: p50 %" PRIu32 ", p99 %" PRIu32 ", max %" PRIu32 "\n",
+                frames, frame_us[frames / 2], frame_us[frames * 99 / 100], frame_us[frames - 1]);
+    }
+    if (result.reports > 0) {
+        fprintf(stderr, "metrics reports: %" PRIu32 ", %.0f us each, max %" PRIu64 " us, %.3f%% of one core\n",
+                result.reports, (double)result.report_us / result.reports, result.max_report_us,
+                wall_us ? result.report_us * 100.0 / wall_us : 0.0);
+    }
+    fprintf(stderr, "robot snapshots changed: %" PRIu32 ", rows redrawn: %" PRIu32 "\n",
+            fleet.changed, lvgl_fleet_rows_redrawn());
+    fprintf(stderr, "robots in the fleet: %" PRIu32 ", rejected messages: %" PRIu32 ", snapshots out of date: %u\n",
+            fleet.robots, fleet.rejected, mismatched);
+
+    free(truth);
+    free(frame_us);
+    if (ppm_path != NULL && !sim_display_dump_ppm(ppm_path)) {
+        return 1;
+    }
+    return mismatched == 0 && fleet.rejected == 0 ? 0 : 1;
+}
@@ -0,0 +1,410 @@
+/*
+ * Differential fuzz test of dv8_json_decode() against cJSON, the decoder it stands in front of.
+ *
+ * Payloads are flat {"key": number} objects the way the robot sends them, with the variations
+ * cJSON_GetObjectItem() has rules for (keys in any case, a key repeated, unknown keys, numbers in
+ * every notation, odd whitespace, bytes after the object), then the same payloads mutated byte by
+ * byte, and payloads with other shapes (strings, literals, nesting, escapes) that must go to cJSON.
+ * Every payload is decoded by both, each into a copy of the same state, for a random field mask:
+ *   - if dv8_json_decode() accepts it, cJSON must parse it and both copies must be identical
+ *   - if it falls back, its copy must be untouched, and the payload must be one the flat decoder
+ *     isn't meant to handle: not an object of numbers to cJSON, or with escapes, NUL bytes or
+ *     numbers longer than cJSON's number buffer
+ * The first mismatch is printed and exits 1. At the end, the decode time per message of both over
+ * the unmutated flat payloads.
+ *
+ * Usage: dv8_json_fuzz [--payloads N] [--seed S]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <inttypes.h>
+#include <cJSON.h>
+#include "dv8_json.h"
+#include "dv8_state.h"
+#include "sim_display.h"
+
+#define FUZZ_DEFAULT_PAYLOADS   200000
+#define FUZZ_MAX_PAYLOAD        512
+#define FUZZ_MAX_TIMED          4096
+#define FUZZ_TIMING_ROUNDS      50
+// cJSON copies a number into a buffer of 64 bytes, dv8_json leaves longer ones to it
+#define FUZZ_MAX_NUMBER_LEN     63
+
+typedef struct {
+    uint64_t payloads;
+    uint64_t accepted;          // by dv8_json_decode()
+    uint64_t fell_back;
+    uint64_t cjson_rejected;    // of those, cJSON didn't parse either
+    uint64_t mixed_case;        // accepted payloads that had a field name in another case
+    uint64_t repeated;          // ... or a field name twice
+} fuzz_stats_t;
+
+typedef struct {
+    char data[FUZZ_MAX_PAYLOAD];
+    size_t len;
+    uint32_t fields;
+} timed_payload_t;
+
+static const char *const unknown_keys[] = { "stamp", "frame_id", "linear_y", "voltage", "e", "" };
+static const char *const whitespace[] = { "", "", " ", "  ", "\t", "\n", "\r\n ", "\x01", "\x1f" };
+static const char *const other_values[] = {
+    "\"on\"", "true", "false", "null", "[]", "[1, 2]", "{}", "{\"e_stop\": 1}", "\"\\u0031\"", "\"a\\\"b\"",
+};
+// Mutations insert these, mostly bytes the decoders branch on
+static const char mutation_bytes[] = "{}[]\":,\\-+.eE0123456789 \t\n\0x_tnulfrs";
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15ull;
+static fuzz_stats_t stats;
+static timed_payload_t *timed;
+static size_t timed_count;
+
+
+// xorshift64*, fast and reproducible from --seed
+static uint32_t rnd(uint32_t n)
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (uint32_t)((rng_state * 2685821657736338717ull) >> 32) % n;
+}
+
+static void append(char *out, size_t *len, const char *text, size_t text_len)
+{
+    if (*len + text_len < FUZZ_MAX_PAYLOAD) {
+        memcpy(out + *len, text, text_len);
+        *len += text_len;
+    }
+}
+
+static void append_str(char *out, size_t *len, const char *text)
+{
+    append(out, len, text, strlen(text));
+}
+
+static void append_ws(char *out, size_t *len)
+{
+    append_str(out, len, whitespace[rnd(sizeof(whitespace) / sizeof(whitespace[0]))]);
+}
+
+static void append_number(char *out, size_t *len)
+{
+    char number[128];
+
+    switch (rnd(8)) {
+    case 0:
+        snprintf(number, sizeof(number), "%d", (int)rnd(3) - 1);
+        break;
+    case 1:
+        snprintf(number, sizeof(number), "%d", (int)rnd(200001) - 100000);
+        break;
+    case 2:
+        snprintf(number, sizeof(number), "%.*f", (int)rnd(8), (rnd(2000001) - 1000000) / 1000.0);
+        break;
+    case 3:
+        snprintf(number, sizeof(number), "%.*e", (int)rnd(6), (rnd(2000001) - 1000000) / 7.0);
+        break;
+    case 4:
+        snprintf(number, sizeof(number), "%s%uE%s%u", rnd(2) ? "-" : "", rnd(100), rnd(2) ? "+" : "-", rnd(400));
+        break;
+    case 5:
+        snprintf(number, sizeof(number), "%s0.%u", rnd(2) ? "-" : "", rnd(1000));
+        break;
+    case 6: {
+        // Around cJSON's number buffer size
+        size_t digits = FUZZ_MAX_NUMBER_LEN - 4 + rnd(10);
+        for (size_t i = 0; i < digits; i++) {
+            number[i] = '0' + (i == 0 ? 1 + rnd(9) : rnd(10));
+        }
+        number[digits] = '\0';
+        break;
+    }
+    default:
+        snprintf(number, sizeof(number), "%u", rnd(2));
+        break;
+    }
+    append_str(out, len, number);
+}
+
+// A field name of `fields`, possibly in another case, or an unknown key
+static void append_key(char *out, size_t *len, uint32_t fields, bool *mixed_case, uint32_t *seen, bool *repeated)
+{
+    char key[64];
+    int field = rnd(DV8_FIELD_COUNT + 3);
+
+    if (field >= DV8_FIELD_COUNT || (fields & DV8_FIELD_BIT(field)) == 0) {
+        snprintf(key, sizeof(key), "%s", field >= DV8_FIELD_COUNT ? unknown_keys[rnd(sizeof(unknown_keys) / sizeof(unknown_keys[0]))]
+                                                                   : dv8_field_info[field].name);
+    } else {
+        snprintf(key, sizeof(key), "%s", dv8_field_info[field].name);
+        if (rnd(4) == 0) {
+            for (char *c = key; *c != '\0'; c++) {
+                if (rnd(2)) {
+                    *c = toupper((unsigned char)*c);
+                    *mixed_case |= *c != tolower((unsigned char)*c);
+                }
+            }
+        }
+        *repeated |= (*seen & DV8_FIELD_BIT(field)) != 0;
+        *seen |= DV8_FIELD_BIT(field);
+    }
+    append_str(out, len, "\"");
+    append_str(out, len, key);
+    append_str(out, len, "\"");
+}
+
+// {"key": number, ...} like json.dumps() and its variations, flags what the stats count
+static size_t make_flat(char *out, uint32_t fields, bool *mixed_case, bool *repeated)
+{
+    size_t len = 0;
+    uint32_t seen = 0;
+    unsigned members = rnd(8);
+
+    *mixed_case = false;
+    *repeated = false;
+    append_ws(out, &len);
+    append_str(out, &len, "{");
+    for (unsigned i = 0; i < members; i++) {
+        append_ws(out, &len);
+        append_key(out, &len, fields, mixed_case, &seen, repeated);
+        append_ws(out, &len);
+        append_str(out, &len, ":");
+        append_ws(out, &len);
+        append_number(out, &len);
+        append_ws(out, &len);
+        if (i + 1 < members) {
+            append_str(out, &len, ",");
+        }
+    }
+    append_ws(out, &len);
+    append_str(out, &len, "}");
+    if (rnd(8) == 0) {
+        append_str(out, &len, rnd(2) ? " trailing" : "\n}");
+    }
+    return len;
+}
+
+// One member of another shape somewhere in a flat payload
+static size_t make_other(char *out, uint32_t fields)
+{
+    bool mixed_case, repeated;
+    size_t len = make_flat(out, fields, &mixed_case, &repeated);
+    char *brace = memchr(out, '{', len);
+    if (brace == NULL) {
+        return len;
+    }
+
+    char member[128];
+    const char *value = other_values[rnd(sizeof(other_values) / sizeof(other_values[0]))];
+    int field = rnd(DV8_FIELD_COUNT);
+    int member_len = rnd(3) == 0 ? snprintf(member, sizeof(member), "\"%s\\u0020\": 1,", dv8_field_info[field].name)
+                                 : snprintf(member, sizeof(member), "\"%s\": %s,", dv8_field_info[field].name, value);
+    size_t at = brace + 1 - out;
+    if (len + member_len < FUZZ_MAX_PAYLOAD) {
+        memmove(out + at + member_len, out + at, len - at);
+        memcpy(out + at, member, member_len);
+        len += member_len;
+    }
+    return len;
+}
+
+static size_t mutate(char *out, size_t len)
+{
+    unsigned mutations = 1 + rnd(4);
+
+    for (unsigned i = 0; i < mutations && len > 0; i++) {
+        size_t at = rnd(len);
+        switch (rnd(5)) {
+        case 0:
+            out[at] = mutation_bytes[rnd(sizeof(mutation_bytes) - 1)];
+            break;
+        case 1:
+            if (len + 1 < FUZZ_MAX_PAYLOAD) {
+                memmove(out + at + 1, out + at, len - at);
+                out[at] = mutation_bytes[rnd(sizeof(mutation_bytes) - 1)];
+                len++;
+            }
+            break;
+        case 2:
+            memmove(out + at, out + at + 1, len - at - 1);
+            len--;
+            break;
+        case 3:
+            len = at;
+            break;
+        default:
+            out[at] ^= 1 << rnd(8);
+            break;
+        }
+    }
+    return len;
+}
+
+// decode_with_cjson() of dv8_message.c, the path dv8_json_decode() falls back to
+static bool decode_cjson(const char *data, size_t data_len, uint32_t fields, dv8_robot_state_t *state)
+{
+    cJSON *json = cJSON_ParseWithLength(data, data_len);
+    if (json == NULL) {
+        return false;
+    }
+    for (int field = 0; field < DV8_FIELD_COUNT; field++) {
+        if (fields & DV8_FIELD_BIT(field)) {
+            cJSON *item = cJSON_GetObjectItem(json, dv8_field_info[field].name);
+            if (item != NULL) {
+                dv8_state_set_field(state, field, cJSON_GetNumberValue(item));
+            }
+        }
+    }
+    cJSON_Delete(json);
+    return true;
+}
+
+// What dv8_json_decode() should accept: an object of numbers to cJSON, without the escapes, NUL
+// bytes and long numbers it leaves to cJSON on purpose
+static bool expect_flat(const char *data, size_t data_len)
+{
+    cJSON *json = cJSON_ParseWithLength(data, data_len);
+    bool flat = json != NULL && cJSON_IsObject(json);
+    for (cJSON *item = flat ? json->child : NULL; item != NULL; item = item->next) {
+        flat &= cJSON_IsNumber(item);
+    }
+    cJSON_Delete(json);
+
+    size_t run = 0;
+    for (size_t i = 0; flat && i < data_len; i++) {
+        run = data[i] != '\0' && strchr("0123456789+-.eE", data[i]) != NULL ? run + 1 : 0;
+        flat = data[i] != '\\' && data[i] != '\0' && run <= FUZZ_MAX_NUMBER_LEN;
+    }
+    return flat;
+}
+
+static void fail(const char *what, const char *data, size_t data_len, uint32_t fields)
+{
+    fprintf(stderr, "FAIL: %s, fields 0x%03" PRIx32 ", payload of %zu bytes:\n", what, fields, data_len);
+    for (size_t i = 0; i < data_len; i++) {
+        fprintf(stderr, isprint((unsigned char)data[i]) ? "%c" : "\\x%02x", (unsigned char)data[i]);
+    }
+    fprintf(stderr, "\n");
+    exit(1);
+}
+
+static void check(const char *data, size_t data_len, uint32_t fields, bool mixed_case, bool repeated)
+{
+    dv8_robot_state_t initial, flat, reference;
+
+    // Every field set, so a decoder that writes a field it shouldn't is caught
+    memset(&initial, 0, sizeof(initial));
+    for (int field = 0; field < DV8_FIELD_COUNT; field++) {
+        dv8_state_set_field(&initial, field, 1000 + field);
+    }
+    flat = initial;
+    reference = initial;
+
+    stats.payloads++;
+    bool flat_ok = dv8_json_decode(data, data_len, fields, &flat);
+    bool reference_ok = decode_cjson(data, data_len, fields, &reference);
+
+    if (flat_ok) {
+        stats.accepted++;
+        stats.mixed_case += mixed_case;
+        stats.repeated += repeated;
+        if (!reference_ok) {
+            fail("dv8_json_decode() accepted a payload cJSON rejects", data, data_len, fields);
+        }
+        if (memcmp(&flat, &reference, sizeof(flat)) != 0) {
+            fail("dv8_json_decode() and cJSON decoded different values", data, data_len, fields);
+        }
+    } else {
+        stats.fell_back++;
+        stats.cjson_rejected += !reference_ok;
+        if (memcmp(&flat, &initial, sizeof(flat)) != 0) {
+            fail("dv8_json_decode() wrote to the state of a payload it rejected", data, data_len, fields);
+        }
+        if (expect_flat(data, data_len)) {
+            fail("dv8_json_decode() left a flat payload to cJSON", data, data_len, fields);
+        }
+    }
+}
+
+static double time_decode(bool (*decode)(const char *, size_t, uint32_t, dv8_robot_state_t *))
+{
+    dv8_robot_state_t state = {0};
+
+    uint64_t start_us = sim_monotonic_us();
+    for (unsigned round = 0; round < FUZZ_TIMING_ROUNDS; round++) {
+        for (size_t i = 0; i < timed_count; i++) {
+            decode(timed[i].data, timed[i].len, timed[i].fields, &state);
+        }
+    }
+    uint64_t elapsed_us = sim_monotonic_us() - start_us;
+
+    // Keeps the compiler from dropping the loop
+    if (state.version != 0) {
+        exit(1);
+    }
+    return elapsed_us * 1000.0 / ((double)FUZZ_TIMING_ROUNDS * timed_count);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long payloads = FUZZ_DEFAULT_PAYLOADS;
+    bool usage = false;
+
+    for (int i = 1; i < argc && !usage; i++) {
+        if (strcmp(argv[i], "--payloads") == 0 && i + 1 < argc) {
+            payloads = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            rng_state = (strtoull(argv[++i], NULL, 0) + 1) * 0x9e3779b97f4a7c15ull;
+        } else {
+            usage = true;
+        }
+    }
+    if (usage || payloads == 0) {
+        fprintf(stderr, "usage: %s [--payloads N] [--seed S]\n", argv[0]);
+        return 2;
+    }
+
+    timed = calloc(FUZZ_MAX_TIMED, sizeof(*timed));
+    if (timed == NULL) {
+        perror("calloc");
+        return 1;
+    }
+
+    char data[FUZZ_MAX_PAYLOAD];
+    for (unsigned long i = 0; i < payloads; i++) {
+        uint32_t fields = rnd(2) ? DV8_FIELD_BIT(DV8_FIELD_COUNT) - 1 : rnd(DV8_FIELD_BIT(DV8_FIELD_COUNT));
+        bool mixed_case = false, repeated = false;
+        size_t len;
+
+        switch (i % 4) {
+        case 0:
+        case 1:
+            len = make_flat(data, fields, &mixed_case, &repeated);
+            if (timed_count < FUZZ_MAX_TIMED && dv8_json_decode(data, len, fields, &(dv8_robot_state_t) {0})) {
+                memcpy(timed[timed_count].data, data, len);
+                timed[timed_count].len = len;
+                timed[timed_count++].fields = fields;
+            }
+            break;
+        case 2:
+            len = mutate(data, make_flat(data, fields, &mixed_case, &repeated));
+            break;
+        default:
+            len = rnd(2) ? make_other(data, fields) : mutate(data, make_other(data, fields));
+            break;
+        }
+        check(data, len, fields, mixed_case, repeated);
+    }
+
+    printf("payloads: %" PRIu64 ", dv8_json accepted %" PRIu64 " (%" PRIu64 " with a field name in another case, %"
+           PRIu64 " with a field name twice), fell back %" PRIu64 " (cJSON rejected %" PRIu64 "), no mismatch\n",
+           stats.payloads, stats.accepted, stats.mixed_case, stats.repeated, stats.fell_back, stats.cjson_rejected);
+    if (timed_count > 0) {
+        printf("flat payloads, %zu different: dv8_json %.1f ns/msg, cJSON %.1f ns/msg\n", timed_count,
+               time_decode(dv8_json_decode), time_decode(decode_cjson));
+    }
+    return 0;
+}
@@ -0,0 +1,57 @@
+/*
+ * Writes a Python encoder for the packed payload format (main/dv8_packed.h) to stdout, built
+ * from the same field and topic tables the panel decodes with, so the robot side and its tests
+ * can't drift from the firmware.
+ *
+ * Usage: dv8_packed_gen > dv8_packed.py
+ */
+
+#include <stdio.h>
+#include "dv8_packed.h"
+#include "dv8_topics.h"
+
+int main(void)
+{
+    printf("# Generated by simulator/dv8_packed_gen from main/dv8_state.c and main/dv8_topics.c, do not edit.\n"
+           "\"\"\"Encoder for the DV8 panel's packed payload format, see main/dv8_packed.h.\"\"\"\n"
+           "\n"
+           "import struct\n"
+           "\n"
+           "MAGIC = 0x%02X\n"
+           "VERSION = %d\n"
+           "\n"
+           "# field name: (field id, little-endian struct format of its value)\n"
+           "FIELDS = {\n", DV8_PACKED_MAGIC, DV8_PACKED_VERSION);
+    for (int field = 0; field < DV8_FIELD_COUNT; field++) {
+        printf("    \"%s\": (%d, \"<%c\"),\n", dv8_field_info[field].name, field,
+               dv8_field_info[field].type == DV8_VALUE_FLOAT ? 'f' : 'i');
+    }
+    printf("}\n"
+           "\n"
+           "# topic: fields the panel takes from it\n"
+           "TOPICS = {\n");
+    for (size_t i = 0; i < dv8_topic_count; i++) {
+        printf("    \"%s\": (", dv8_topics[i].topic);
+        for (int field = 0; field < DV8_FIELD_COUNT; field++) {
+            if (dv8_topics[i].fields & DV8_FIELD_BIT(field)) {
+                printf("\"%s\", ", dv8_field_info[field].name);
+            }
+        }
+        printf("),\n");
+    }
+    printf("}\n"
+           "\n"
+           "\n"
+           "def encode(values):\n"
+           "    \"\"\"Pack a {field name: number} dict, the binary counterpart of json.dumps(values).\"\"\"\n"
+           "    mask = 0\n"
+           "    for name in values:\n"
+           "        mask |= 1 << FIELDS[name][0]\n"
+           "    out = bytearray(struct.pack(\"<BBH\", MAGIC, VERSION, mask))\n"
+           "    for name, (field_id, fmt) in sorted(FIELDS.items(), key=lambda item: item[1][0]):\n"
+           "        if mask & (1 << field_id):\n"
+           "            value = values[name]\n"
+           "            out += struct.pack(fmt, float(value) if fmt == \"<f\" else int(value))\n"
+           "    return bytes(out)\n");
+    return 0;
+}
@@ -0,0 +1,307 @@
+/*
+ * Replays a recorded dv8_trace (see main/dv8_trace.h) through the same receive path and UI
+ * as the firmware: dv8_message_handle() -> dv8_state snapshot -> lvgl_sync_robot_state() ->
+ * render into the memory framebuffer of sim_display.c.
+ *
+ * --speed 1 and --speed 10 play the trace on a virtual clock at real time or 10x, rendering one
+ * LVGL frame per LV_DEF_REFR_PERIOD like the panel does, so message-to-flush latency includes
+ * waiting for the next refresh. --speed max feeds messages back to back and refreshes the
+ * display right after every message that changed the state, which measures the raw cost of the
+ * pipeline. Either way the summary goes to stderr:
+ *   messages by result, messages/s (wall clock), message-to-flush latency min/p50/p99/max,
+ *   then the same per displayed field from dv8_latency, as the panel reports it
+ *
+ * --record turns the tool around: it reads "topic payload" lines, as printed by
+ *   mosquitto_sub -v -t '/robot/#'
+ * from stdin and writes them to a trace, timestamped on arrival.
+ *
+ * Usage: dv8_replay [--speed 1|10|max] [--dump-ppm out.ppm] trace.dv8t
+ *        dv8_replay --record trace.dv8t < lines
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include "lvgl.h"
+#include "dv8_latency.h"
+#include "dv8_message.h"
+#include "dv8_topics.h"
+#include "dv8_trace.h"
+#include "lvgl_ui.h"
+#include "sim_display.h"
+
+#define REPLAY_FRAME_MS         LV_DEF_REFR_PERIOD
+#define REPLAY_SPEED_MAX        0
+
+static uint32_t sim_time_ms = 0;
+
+// Arrival times of the state changes that haven't been flushed yet, and the latencies of the
+// ones that have
+static uint64_t pending_us[4096];
+static size_t pending_count = 0;
+static uint64_t *latencies_us = NULL;
+static size_t latency_count = 0, latency_capacity = 0;
+static uint32_t lost_changes = 0;
+
+// --speed max stamps with the wall clock, otherwise with the virtual one
+static bool wall_clock = false;
+static uint64_t virtual_time_us = 0;
+
+
+static uint32_t sim_tick_cb(void)
+{
+    return sim_time_ms;
+}
+
+// Same clock the messages are stamped with, for dv8_stale
+static int64_t replay_clock_us(void)
+{
+    return wall_clock ? (int64_t)sim_monotonic_us() : (int64_t)virtual_time_us;
+}
+
+static void add_latency(uint64_t latency_us)
+{
+    if (latency_count == latency_capacity) {
+        latency_capacity = latency_capacity ? latency_capacity * 2 : 1024;
+        latencies_us = realloc(latencies_us, latency_capacity * sizeof(*latencies_us));
+        if (latencies_us == NULL) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    latencies_us[latency_count++] = latency_us;
+}
+
+static void add_pending(uint64_t now_us)
+{
+    // More changes than that between two frames all wait for the same flush anyway, keep the oldest
+    if (pending_count < sizeof(pending_us) / sizeof(pending_us[0])) {
+        pending_us[pending_count++] = now_us;
+    }
+}
+
+static void frame_done_cb(void)
+{
+    uint64_t flush_time_us = wall_clock ? sim_monotonic_us() : virtual_time_us;
+    // The memory framebuffer is "on the glass" as soon as flush_cb returns
+    dv8_latency_frame_flushing();
+    dv8_latency_frame_done(flush_time_us);
+    for (size_t i = 0; i < pending_count; i++) {
+        add_latency(flush_time_us - pending_us[i]);
+    }
+    pending_count = 0;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static uint8_t *read_file(const char *path, size_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t *buf = malloc(size > 0 ? size : 1);
+    if (buf == NULL || fread(buf, 1, size, f) != (size_t)size) {
+        fprintf(stderr, "%s: read failed\n", path);
+        free(buf);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+    *len = size;
+    return buf;
+}
+
+static int record(const char *path)
+{
+    FILE *out = fopen(path, "wb");
+    if (out == NULL) {
+        perror(path);
+        return 1;
+    }
+
+    uint8_t header[DV8_TRACE_HEADER_SIZE];
+    dv8_trace_write_header(header);
+    fwrite(header, 1, sizeof(header), out);
+
+    static char line[DV8_TRACE_BLOCK_SIZE];
+    static uint8_t rec[DV8_TRACE_BLOCK_SIZE + 64];
+    uint64_t start_us = sim_monotonic_us(), last_us = start_us;
+    uint32_t count = 0;
+
+    while (fgets(line, sizeof(line), stdin) != NULL) {
+        uint64_t now_us = sim_monotonic_us();
+        size_t len = strcspn(line, "\r\n");
+        char *space = memchr(line, ' ', len);
+        if (space == NULL) {
+            continue;
+        }
+
+        size_t topic_len = space - line;
+        size_t n = dv8_trace_encode(rec, sizeof(rec), now_us - last_us, line, topic_len,
+                                    space + 1, len - topic_len - 1);
+        if (n == 0) {
+            continue;
+        }
+        fwrite(rec, 1, n, out);
+        last_us = now_us;
+        count++;
+    }
+
+    fclose(out);
+    fprintf(stderr, "recorded %" PRIu32 " messages over %.1f s\n", count, (sim_monotonic_us() - start_us) / 1e6);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned speed = 1;
+    const char *ppm_path = NULL;
+    const char *record_path = NULL;
+    const char *trace_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            i++;
+            speed = strcmp(argv[i], "max") == 0 ? REPLAY_SPEED_MAX : strtoul(argv[i], NULL, 10);
+            if (speed == REPLAY_SPEED_MAX && strcmp(argv[i], "max") != 0) {
+                trace_path = NULL;
+                break;
+            }
+        } else if (strcmp(argv[i], "--dump-ppm") == 0 && i + 1 < argc) {
+            ppm_path = argv[++i];
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (trace_path == NULL && argv[i][0] != '-') {
+            trace_path = argv[i];
+        } else {
+            trace_path = NULL;
+            break;
+        }
+    }
+
+    dv8_topics_init();
+    if (record_path != NULL) {
+        return record(record_path);
+    }
+    if (trace_path == NULL) {
+        fprintf(stderr, "usage: %s [--speed 1|10|max] [--dump-ppm out.ppm] trace.dv8t\n"
+                        "       %s --record trace.dv8t < \"topic payload\" lines\n", argv[0], argv[0]);
+        return 2;
+    }
+
+    size_t trace_len;
+    uint8_t *trace = read_file(trace_path, &trace_len);
+    if (trace == NULL) {
+        return 1;
+    }
+    dv8_trace_reader_t reader;
+    if (!dv8_trace_reader_init(&reader, trace, trace_len)) {
+        fprintf(stderr, "%s: not a dv8 trace\n", trace_path);
+        return 1;
+    }
+
+    lv_init();
+    lv_tick_set_cb(sim_tick_cb);
+    lv_display_t *display = sim_display_create();
+    sim_display_set_frame_done_cb(frame_done_cb);
+    wall_clock = speed == REPLAY_SPEED_MAX;
+    lvgl_set_clock(replay_clock_us);
+    example_lvgl_demo_ui(display);
+    lv_refr_now(display);
+
+    uint32_t results[DV8_MESSAGE_BAD_PAYLOAD + 1] = {0};
+    uint32_t messages = 0;
+    uint64_t start_us = sim_monotonic_us();
+    dv8_trace_record_t rec;
+    bool have_rec = dv8_trace_next(&reader, &rec);
+
+    if (speed == REPLAY_SPEED_MAX) {
+        // The virtual tick only follows the trace so that blinking stays sane
+        for (; have_rec; have_rec = dv8_trace_next(&reader, &rec)) {
+            sim_time_ms = rec.time_us / 1000;
+            uint64_t arrival_us = sim_monotonic_us();
+            dv8_message_result_t result = dv8_message_handle(rec.topic, rec.topic_len, rec.data, rec.data_len,
+                                                             arrival_us, NULL);
+            results[result]++;
+            messages++;
+
+            if (lvgl_sync_robot_state()) {
+                add_pending(arrival_us);
+                lv_refr_now(display);
+                lost_changes += pending_count;
+                pending_count = 0;
+            }
+        }
+    } else {
+        // Virtual clock latency, one refresh per frame period as on the panel
+        for (uint64_t frame_us = 0; have_rec || pending_count > 0; frame_us += REPLAY_FRAME_MS * 1000) {
+            sim_time_ms = frame_us / 1000;
+            while (have_rec && rec.time_us / speed <= frame_us) {
+                dv8_message_result_t result = dv8_message_handle(rec.topic, rec.topic_len, rec.data, rec.data_len,
+                                                                 rec.time_us / speed, NULL);
+                results[result]++;
+                messages++;
+                if (result == DV8_MESSAGE_CHANGED) {
+                    add_pending(rec.time_us / speed);
+                }
+                have_rec = dv8_trace_next(&reader, &rec);
+            }
+
+            virtual_time_us = frame_us;
+            lvgl_sync_robot_state();
+            lv_timer_handler();
+            // A change to something that isn't on screen never gets a flush
+            lost_changes += pending_count;
+            pending_count = 0;
+        }
+    }
+
+    uint64_t wall_us = sim_monotonic_us() - start_us;
+    fprintf(stderr, "messages: %" PRIu32 " (changed %" PRIu32 ", unchanged %" PRIu32
+            ", refreshed %" PRIu32 ", unknown topic %" PRIu32 ", bad payload %" PRIu32 ")\n", messages,
+            results[DV8_MESSAGE_CHANGED], results[DV8_MESSAGE_UNCHANGED], results[DV8_MESSAGE_REFRESHED],
+            results[DV8_MESSAGE_UNKNOWN_TOPIC], results[DV8_MESSAGE_BAD_PAYLOAD]);
+    fprintf(stderr, "wall time: %.3f s, %.0f messages/s\n", wall_us / 1e6,
+            wall_us ? messages * 1e6 / wall_us : 0.0);
+
+    if (latency_count > 0) {
+        qsort(latencies_us, latency_count, sizeof(*latencies_us), compare_u64);
+        fprintf(stderr, "message to flush us (%s): min %" PRIu64 ", p50 %" PRIu64 ", p99 %" PRIu64
+                ", max %" PRIu64 " over %zu changes, %" PRIu32 " without redraw\n",
+                speed == REPLAY_SPEED_MAX ? "wall clock" : "virtual clock",
+                latencies_us[0], latencies_us[latency_count / 2], latencies_us[latency_count * 99 / 100],
+                latencies_us[latency_count - 1], latency_count, lost_changes);
+    }
+
+    for (int field = 0; field < DV8_FIELD_COUNT; field++) {
+        dv8_latency_summary_t s;
+        dv8_latency_get(field, &s);
+        if (s.count > 0) {
+            fprintf(stderr, "  %-20s n %6" PRIu32 ", min %6" PRIu32 ", p50 %6" PRIu32 ", p99 %6" PRIu32
+                    ", max %6" PRIu32 "\n", dv8_field_info[field].name, s.count, s.min_us, s.p50_us, s.p99_us, s.max_us);
+        }
+    }
+
+    uint32_t applied, skipped;
+    lvgl_get_update_stats(&applied, &skipped);
+    fprintf(stderr, "UI updates applied: %" PRIu32 ", skipped: %" PRIu32 "\n", applied, skipped);
+
+    free(trace);
+    free(latencies_us);
+    if (ppm_path != NULL && !sim_display_dump_ppm(ppm_path)) {
+        return 1;
+    }
+    return 0;
+}
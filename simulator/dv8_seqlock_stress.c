@@ -0,0 +1,219 @@
+/*
+ * Seqlock stress test: one writer thread publishes snapshots as fast as it can while reader
+ * threads copy them out, for the single robot snapshot (dv8_state_publish / dv8_state_read) and
+ * the per-robot ones of fleet mode (dv8_fleet_handle / dv8_fleet_read).
+ *
+ * Every published snapshot is derived from one counter: publish n carries n in every field
+ * (negated, offset or scrambled per field) and in changed_us, so a reader that got half of one
+ * publish and half of another sees fields that disagree. Readers also check that the version
+ * each of them sees never goes backwards, and for dv8_state that it is the counter itself.
+ *
+ * Exits 1 on the first torn or out of order read, otherwise prints how many publishes and reads
+ * went through.
+ *
+ * Usage: dv8_seqlock_stress [--readers N] [--seconds S]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <time.h>
+#include "dv8_fleet.h"
+#include "dv8_state.h"
+#include "dv8_topics.h"
+#include "sim_display.h"
+
+#define STRESS_MAX_READERS  16
+#define STRESS_ROBOTS       4
+// Floats hold every integer up to 2^24 exactly, the counter wraps below that
+#define STRESS_COUNTER_MASK 0xffffffu
+
+typedef struct {
+    unsigned index;
+    uint64_t reads;
+    uint64_t fleet_reads;
+} reader_t;
+
+static unsigned config_readers = 3;
+static unsigned config_seconds = 2;
+static atomic_bool stop;
+static _Atomic(uint64_t) state_publishes;
+static _Atomic(uint64_t) fleet_publishes;
+
+
+static void fail(const char *what, uint64_t a, uint64_t b)
+{
+    fprintf(stderr, "FAIL: %s (%" PRIu64 " vs %" PRIu64 ")\n", what, a, b);
+    exit(1);
+}
+
+// Snapshot number n, every field its own function of n
+static void make_state(uint32_t n, dv8_robot_state_t *state)
+{
+    uint32_t v = n & STRESS_COUNTER_MASK;
+
+    memset(state, 0, sizeof(*state));
+    state->linear_x = v;
+    state->angular_z = -(float)v;
+    state->battery_percentage = STRESS_COUNTER_MASK - v;
+    state->brush_speed = v;
+    state->battery_is_charging = v & 1;
+    state->e_stop = v ^ 0x5a5a5a;
+    state->handbrake = v + 1;
+    state->direct_status = v * 3;
+    state->robot_mode = -(int)v;
+    state->safety_mode = v >> 1;
+    for (int field = 0; field < DV8_FIELD_COUNT; field++) {
+        state->changed_us[field] = (int64_t)n << 20 | field;
+    }
+}
+
+static void check_state(const dv8_robot_state_t *state)
+{
+    uint32_t v = state->brush_speed;
+    dv8_robot_state_t expected;
+
+    make_state(state->version, &expected);
+    if ((state->version & STRESS_COUNTER_MASK) != v) {
+        fail("dv8_state: version and fields from different publishes", state->version, v);
+    }
+    if (dv8_state_diff(state, &expected) != 0
+            || memcmp(state->changed_us, expected.changed_us, sizeof(expected.changed_us)) != 0) {
+        fail("dv8_state: torn snapshot", state->version, v);
+    }
+}
+
+// Fleet snapshots come from cmd_vel messages, linear_x = n, angular_z = -n, changed_us = n
+static void check_fleet(const dv8_robot_state_t *state)
+{
+    int64_t n = state->changed_us[DV8_FIELD_LINEAR_X];
+
+    if (state->linear_x != (float)n || state->angular_z != -(float)n
+            || state->changed_us[DV8_FIELD_ANGULAR_Z] != n) {
+        fail("dv8_fleet: torn snapshot", (uint64_t)n, (uint64_t)state->linear_x);
+    }
+}
+
+static void *writer(void *arg)
+{
+    (void)arg;
+    dv8_robot_state_t state;
+    char topic[64], payload[64];
+    uint32_t n = 0;
+
+    while (!atomic_load_explicit(&stop, memory_order_relaxed)) {
+        // The counter starts at 1 so that the first publish already changes every field
+        n++;
+        make_state(n, &state);
+        if (!dv8_state_publish(&state)) {
+            fail("dv8_state_publish() saw no change", n, 0);
+        }
+        atomic_store_explicit(&state_publishes, n, memory_order_relaxed);
+
+        uint32_t v = n & STRESS_COUNTER_MASK;
+        int topic_len = snprintf(topic, sizeof(topic), DV8_TOPIC_PREFIX "/bot%u/control/cmd_vel", n % STRESS_ROBOTS);
+        int payload_len = snprintf(payload, sizeof(payload), "{\"linear_x\": %u, \"angular_z\": -%u}", v, v);
+        if (dv8_fleet_handle(topic, topic_len, payload, payload_len, v, NULL) != DV8_MESSAGE_CHANGED) {
+            fail("dv8_fleet_handle() did not publish", n, 0);
+        }
+        atomic_fetch_add_explicit(&fleet_publishes, 1, memory_order_relaxed);
+    }
+    return NULL;
+}
+
+static void *reader(void *arg)
+{
+    reader_t *self = arg;
+    uint32_t last_version = 0;
+    uint32_t last_fleet_version[STRESS_ROBOTS] = {0};
+    dv8_robot_state_t state;
+
+    while (!atomic_load_explicit(&stop, memory_order_relaxed)) {
+        uint32_t version = dv8_state_read(&state);
+        if (version != state.version) {
+            fail("dv8_state_read() returned another version than it copied", version, state.version);
+        }
+        if (version < last_version) {
+            fail("dv8_state: version went backwards", last_version, version);
+        }
+        if (version != 0) {
+            check_state(&state);
+        }
+        last_version = version;
+        self->reads++;
+
+        size_t count = dv8_fleet_count();
+        for (size_t i = 0; i < count; i++) {
+            version = dv8_fleet_read(i, &state);
+            if (version < last_fleet_version[i]) {
+                fail("dv8_fleet: version went backwards", last_fleet_version[i], version);
+            }
+            check_fleet(&state);
+            last_fleet_version[i] = version;
+            self->fleet_reads++;
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    bool usage = false;
+
+    for (int i = 1; i < argc && !usage; i++) {
+        if (strcmp(argv[i], "--readers") == 0 && i + 1 < argc) {
+            config_readers = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            config_seconds = strtoul(argv[++i], NULL, 10);
+        } else {
+            usage = true;
+        }
+    }
+    if (usage || config_readers == 0 || config_readers > STRESS_MAX_READERS || config_seconds == 0) {
+        fprintf(stderr, "usage: %s [--readers N (1-%d)] [--seconds S]\n", argv[0], STRESS_MAX_READERS);
+        return 2;
+    }
+
+    dv8_topics_init();
+
+    pthread_t writer_thread;
+    pthread_t reader_threads[STRESS_MAX_READERS];
+    reader_t readers[STRESS_MAX_READERS] = {0};
+    uint64_t start_us = sim_monotonic_us();
+
+    if (pthread_create(&writer_thread, NULL, writer, NULL) != 0) {
+        perror("pthread_create");
+        return 1;
+    }
+    for (unsigned i = 0; i < config_readers; i++) {
+        readers[i].index = i;
+        if (pthread_create(&reader_threads[i], NULL, reader, &readers[i]) != 0) {
+            perror("pthread_create");
+            return 1;
+        }
+    }
+
+    while (sim_monotonic_us() - start_us < config_seconds * 1000000ull) {
+        struct timespec ts = { .tv_nsec = 10 * 1000 * 1000 };
+        nanosleep(&ts, NULL);
+    }
+    atomic_store(&stop, true);
+    pthread_join(writer_thread, NULL);
+
+    uint64_t reads = 0, fleet_reads = 0;
+    for (unsigned i = 0; i < config_readers; i++) {
+        pthread_join(reader_threads[i], NULL);
+        reads += readers[i].reads;
+        fleet_reads += readers[i].fleet_reads;
+    }
+
+    printf("dv8_state: %" PRIu64 " publishes, %" PRIu64 " reads by %u readers, none torn\n",
+           atomic_load(&state_publishes), reads, config_readers);
+    printf("dv8_fleet: %" PRIu64 " publishes to %zu robots, %" PRIu64 " reads, none torn\n",
+           atomic_load(&fleet_publishes), dv8_fleet_count(), fleet_reads);
+    return 0;
+}
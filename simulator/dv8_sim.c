@@ -0,0 +1,397 @@
+/*
+ * Headless host simulator for the DV8 panel.
+ *
+ * Builds the real lvgl_ui.c and robot state layer against LVGL on Linux and renders into a
+ * memory framebuffer instead of the SPI panel. A script of timed robot state changes is played
+ * on a virtual clock, one LVGL frame per LV_DEF_REFR_PERIOD, and every frame that flushed
+ * anything is reported as CSV: frame,time_ms,render_us,flushes,pixels
+ *
+ * Script lines are "<time_ms> <field> <value>", field names as in dv8_field_info,
+ * '#' starts a comment. Times must not decrease. Every event counts as a receipt of its field,
+ * so fields the script stops setting expire after their dv8_stale timeout like on the panel.
+ * "<time_ms> expect <field> <look>" checks the button of the field after the first frame at or
+ * past that time, and exits 1 if it doesn't match. Looks: blinking, steady (not blinking),
+ * stale (labelled "no data"), live (not stale).
+ *
+ * --trend switches to the trend page before the final frame, so --dump-ppm shows the charts.
+ * --no-sprites renders the status buttons every time instead of copying their captured looks
+ * (lvgl_sprite.h); the frames must come out the same, only cheaper with the sprites.
+ * --check-swap renders the areas of every frame a second time, natively with the swap at flush
+ * like a build without lvgl_rgb565_be.h, and exits 1 if any pixel differs from what the frame
+ * sent. The same areas, because LVGL's edges of a transformed layer depend on how it is clipped.
+ * --overlay adds objects on the top layer that draw through the paths those hooks don't cover (an
+ * RGB565 image, additive blending, a rotated object), so --check-swap also covers the fallback.
+ *
+ * Usage: dv8_sim [--all-frames] [--tail-ms N] [--trend] [--no-sprites] [--check-swap] [--overlay]
+ *                [--dump-ppm out.ppm] script.txt
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include "lvgl.h"
+#include "src/core/lv_refr_private.h"
+#include "src/display/lv_display_private.h"
+#include "dv8_history.h"
+#include "dv8_stale.h"
+#include "dv8_state.h"
+#include "lvgl_blink.h"
+#include "lvgl_ui.h"
+#include "lvgl_rgb565_be.h"
+#include "lvgl_sprite.h"
+#include "lvgl_trend.h"
+#include "sim_display.h"
+
+#define SIM_FRAME_MS            LV_DEF_REFR_PERIOD
+#define SIM_MAX_EVENTS          4096
+#define SIM_OVERLAY_IMAGE_SIZE  16
+
+typedef enum {
+    SIM_SET = 0,        // value is the field's new value
+    SIM_EXPECT_BLINKING,
+    SIM_EXPECT_STEADY,
+    SIM_EXPECT_STALE,
+    SIM_EXPECT_LIVE,
+} sim_action_t;
+
+static const char *const expect_names[] = {
+    [SIM_EXPECT_BLINKING] = "blinking",
+    [SIM_EXPECT_STEADY] = "steady",
+    [SIM_EXPECT_STALE] = "stale",
+    [SIM_EXPECT_LIVE] = "live",
+};
+
+typedef struct {
+    uint32_t time_ms;
+    sim_action_t action;
+    dv8_field_t field;
+    double value;
+} sim_event_t;
+
+static sim_event_t events[SIM_MAX_EVENTS];
+static size_t event_count = 0;
+
+static uint32_t sim_time_ms = 0;
+
+// --check-swap: what the last refresh rendered, and the pixels it left
+static lv_area_t frame_areas[LV_INV_BUF_SIZE];
+static uint32_t frame_area_count;
+static uint16_t checked_frame[SIM_LCD_H_RES * SIM_LCD_V_RES];
+
+static uint32_t sim_tick_cb(void)
+{
+    return sim_time_ms;
+}
+
+static int64_t sim_clock_us(void)
+{
+    return (int64_t)sim_time_ms * 1000;
+}
+
+static bool parse_field(const char *name, dv8_field_t *field)
+{
+    for (int i = 0; i < DV8_FIELD_COUNT; i++) {
+        if (strcmp(dv8_field_info[i].name, name) == 0) {
+            *field = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool load_script(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        perror(path);
+        return false;
+    }
+
+    char line[256];
+    int line_no = 0;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        line_no++;
+        char *comment = strchr(line, '#');
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+
+        uint32_t time_ms;
+        char name[64], look[16];
+        double value;
+        int n = sscanf(line, "%" SCNu32 " %63s %lf", &time_ms, name, &value);
+        if (n <= 0) {
+            continue;    // blank line
+        }
+
+        sim_event_t *ev = &events[event_count];
+        ev->action = SIM_SET;
+        if (n == 2 && strcmp(name, "expect") == 0) {
+            n = sscanf(line, "%*" SCNu32 " expect %63s %15s", name, look);
+            for (size_t i = SIM_EXPECT_BLINKING; n == 2 && i < sizeof(expect_names) / sizeof(expect_names[0]); i++) {
+                if (strcmp(look, expect_names[i]) == 0) {
+                    ev->action = i;
+                }
+            }
+            if (n != 2 || ev->action == SIM_SET || !parse_field(name, &ev->field)) {
+                fprintf(stderr, "%s:%d: expected \"<time_ms> expect <field> blinking|steady|stale|live\"\n",
+                        path, line_no);
+                fclose(f);
+                return false;
+            }
+        } else if (n != 3 || !parse_field(name, &ev->field)) {
+            fprintf(stderr, "%s:%d: expected \"<time_ms> <field> <value>\"\n", path, line_no);
+            fclose(f);
+            return false;
+        }
+        if (event_count > 0 && time_ms < events[event_count - 1].time_ms) {
+            fprintf(stderr, "%s:%d: time goes backwards\n", path, line_no);
+            fclose(f);
+            return false;
+        }
+        if (event_count == SIM_MAX_EVENTS) {
+            fprintf(stderr, "%s: more than %d events\n", path, SIM_MAX_EVENTS);
+            fclose(f);
+            return false;
+        }
+        ev->time_ms = time_ms;
+        ev->value = value;
+        event_count++;
+    }
+
+    fclose(f);
+    return true;
+}
+
+// Objects on the top layer that lvgl_rgb565_be.h has to render natively
+static void create_overlay(void)
+{
+    static uint16_t pixels[SIM_OVERLAY_IMAGE_SIZE * SIM_OVERLAY_IMAGE_SIZE];
+    static lv_image_dsc_t image;
+
+    for (int y = 0; y < SIM_OVERLAY_IMAGE_SIZE; y++) {
+        for (int x = 0; x < SIM_OVERLAY_IMAGE_SIZE; x++) {
+            lv_color_t color = lv_color_make(x * 255 / (SIM_OVERLAY_IMAGE_SIZE - 1), y * 255 / (SIM_OVERLAY_IMAGE_SIZE - 1), 96);
+            pixels[y * SIM_OVERLAY_IMAGE_SIZE + x] = lv_color_to_u16(color);
+        }
+    }
+    image.header.magic = LV_IMAGE_HEADER_MAGIC;
+    image.header.cf = LV_COLOR_FORMAT_RGB565;
+    image.header.w = SIM_OVERLAY_IMAGE_SIZE;
+    image.header.h = SIM_OVERLAY_IMAGE_SIZE;
+    image.header.stride = SIM_OVERLAY_IMAGE_SIZE * sizeof(uint16_t);
+    image.data = (const uint8_t *)pixels;
+    image.data_size = sizeof(pixels);
+
+    lv_obj_t *plain = lv_image_create(lv_layer_top());
+    lv_image_set_src(plain, &image);
+    lv_obj_set_pos(plain, 2, 2);
+
+    lv_obj_t *additive = lv_image_create(lv_layer_top());
+    lv_image_set_src(additive, &image);
+    lv_image_set_blend_mode(additive, LV_BLEND_MODE_ADDITIVE);
+    lv_obj_set_pos(additive, 2 + SIM_OVERLAY_IMAGE_SIZE + 4, 2);
+
+    lv_obj_t *rotated = lv_obj_create(lv_layer_top());
+    lv_obj_set_size(rotated, 20, 10);
+    lv_obj_set_pos(rotated, 2 + 2 * (SIM_OVERLAY_IMAGE_SIZE + 4), 6);
+    lv_obj_set_style_bg_color(rotated, lv_color_make(200, 60, 30), 0);
+    lv_obj_set_style_transform_rotation(rotated, 300, 0);
+}
+
+// An expect line against the button as the last frame left it
+static bool check_look(const sim_event_t *ev)
+{
+    lv_obj_t *btn = lvgl_field_button(ev->field);
+    bool blinking = btn != NULL && lvgl_blink_is_running(btn);
+    bool stale = btn != NULL && strstr(lv_label_get_text(lv_obj_get_child(btn, 0)), "no data") != NULL;
+    bool ok = btn != NULL && (ev->action == SIM_EXPECT_BLINKING ? blinking :
+                              ev->action == SIM_EXPECT_STEADY ? !blinking :
+                              ev->action == SIM_EXPECT_STALE ? stale : !stale);
+    if (!ok) {
+        fprintf(stderr, "FAIL: %" PRIu32 " ms: %s is not %s\n", sim_time_ms, dv8_field_info[ev->field].name,
+                expect_names[ev->action]);
+    }
+    return ok;
+}
+
+static void record_areas_cb(lv_event_t *e)
+{
+    lv_display_t *disp = lv_event_get_target(e);
+    frame_area_count = 0;
+    for (uint32_t i = 0; i < disp->inv_p; i++) {
+        if (!disp->inv_area_joined[i]) {
+            frame_areas[frame_area_count++] = disp->inv_areas[i];
+        }
+    }
+}
+
+// Render the last frame's areas again without the big-endian hooks and compare the result
+static bool check_swap(lv_display_t *display, uint32_t frame)
+{
+    lv_area_t areas[LV_INV_BUF_SIZE];
+    uint32_t count = frame_area_count;
+
+    memcpy(areas, frame_areas, count * sizeof(areas[0]));
+    memcpy(checked_frame, sim_display_framebuffer(), sizeof(checked_frame));
+    lvgl_rgb565_be_set_enabled(false);
+    for (uint32_t i = 0; i < count; i++) {
+        lv_inv_area(display, &areas[i]);
+    }
+    lv_refr_now(display);
+    lvgl_rgb565_be_set_enabled(true);
+    sim_display_take_stats();
+
+    const uint16_t *native = sim_display_framebuffer();
+    for (int i = 0; i < SIM_LCD_H_RES * SIM_LCD_V_RES; i++) {
+        if (native[i] != checked_frame[i]) {
+            fprintf(stderr, "FAIL: frame %" PRIu32 ", pixel %d,%d: %04x sent, %04x rendered natively\n",
+                    frame, i % SIM_LCD_H_RES, i / SIM_LCD_H_RES, checked_frame[i], native[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    bool all_frames = false;
+    bool trend = false;
+    bool sprites = true;
+    bool swap_check = false;
+    bool overlay = false;
+    uint32_t tail_ms = 1000;
+    const char *ppm_path = NULL;
+    const char *script_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--all-frames") == 0) {
+            all_frames = true;
+        } else if (strcmp(argv[i], "--trend") == 0) {
+            trend = true;
+        } else if (strcmp(argv[i], "--no-sprites") == 0) {
+            sprites = false;
+        } else if (strcmp(argv[i], "--check-swap") == 0) {
+            swap_check = true;
+        } else if (strcmp(argv[i], "--overlay") == 0) {
+            overlay = true;
+        } else if (strcmp(argv[i], "--tail-ms") == 0 && i + 1 < argc) {
+            tail_ms = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--dump-ppm") == 0 && i + 1 < argc) {
+            ppm_path = argv[++i];
+        } else if (script_path == NULL && argv[i][0] != '-') {
+            script_path = argv[i];
+        } else {
+            script_path = NULL;
+            break;
+        }
+    }
+    if (script_path == NULL) {
+        fprintf(stderr, "usage: %s [--all-frames] [--tail-ms N] [--trend] [--no-sprites] [--check-swap] [--overlay]"
+                " [--dump-ppm out.ppm] script.txt\n", argv[0]);
+        return 2;
+    }
+    if (!load_script(script_path)) {
+        return 1;
+    }
+
+    lv_init();
+    lv_tick_set_cb(sim_tick_cb);
+    lv_display_t *display = sim_display_create();
+    lvgl_sprite_set_enabled(sprites);
+    lvgl_set_clock(sim_clock_us);
+    example_lvgl_demo_ui(display);
+    lvgl_trend_ui(display, sim_clock_us);
+    if (overlay) {
+        create_overlay();
+    }
+    if (swap_check) {
+        lv_display_add_event_cb(display, record_areas_cb, LV_EVENT_RENDER_START, NULL);
+    }
+
+    dv8_robot_state_t robot_state;
+    dv8_state_read(&robot_state);
+
+    uint32_t end_ms = (event_count > 0 ? events[event_count - 1].time_ms : 0) + tail_ms;
+    uint32_t frames = 0, rendered_frames = 0, checked_frames = 0;
+    uint64_t total_render_us = 0, max_render_us = 0, total_pixels = 0;
+    size_t next_event = 0, next_check = 0;
+
+    printf("frame,time_ms,render_us,flushes,pixels\n");
+    for (sim_time_ms = 0; sim_time_ms <= end_ms; sim_time_ms += SIM_FRAME_MS) {
+        while (next_event < event_count && events[next_event].time_ms <= sim_time_ms) {
+            if (events[next_event].action != SIM_SET) {
+                next_event++;
+                continue;
+            }
+            dv8_state_set_field(&robot_state, events[next_event].field, events[next_event].value);
+            dv8_stale_touch(DV8_FIELD_BIT(events[next_event].field), sim_clock_us());
+            dv8_history_add(events[next_event].field, events[next_event].value, sim_clock_us());
+            next_event++;
+        }
+        dv8_state_publish(&robot_state);
+
+        sim_display_take_stats();
+        uint64_t start_us = sim_monotonic_us();
+
+        lvgl_sync_robot_state();
+        lv_timer_handler();
+
+        uint64_t render_us = sim_monotonic_us() - start_us;
+        sim_frame_stats_t frame = sim_display_take_stats();
+        frames++;
+        if (frame.flushes > 0) {
+            rendered_frames++;
+            total_render_us += render_us;
+            total_pixels += frame.pixels;
+            if (render_us > max_render_us) {
+                max_render_us = render_us;
+            }
+        }
+        if (frame.flushes > 0 || all_frames) {
+            printf("%" PRIu32 ",%" PRIu32 ",%" PRIu64 ",%" PRIu32 ",%" PRIu32 "\n",
+                   frames - 1, sim_time_ms, render_us, frame.flushes, frame.pixels);
+        }
+        for (; next_check < next_event; next_check++) {
+            if (events[next_check].action != SIM_SET && !check_look(&events[next_check])) {
+                return 1;
+            }
+        }
+        if (swap_check && frame.flushes > 0) {
+            if (!check_swap(display, frames - 1)) {
+                return 1;
+            }
+            checked_frames++;
+        }
+    }
+
+    uint32_t applied, skipped;
+    lvgl_get_update_stats(&applied, &skipped);
+    fprintf(stderr, "frames: %" PRIu32 ", rendered: %" PRIu32 ", pixels: %" PRIu64 "\n",
+            frames, rendered_frames, total_pixels);
+    fprintf(stderr, "render us: avg %" PRIu64 ", max %" PRIu64 "\n",
+            rendered_frames ? total_render_us / rendered_frames : 0, max_render_us);
+    fprintf(stderr, "UI updates applied: %" PRIu32 ", skipped: %" PRIu32 "\n", applied, skipped);
+    lvgl_sprite_stats_t sprite_stats;
+    lvgl_sprite_get_stats(&sprite_stats);
+    fprintf(stderr, "sprites: %" PRIu32 " draws copied, %" PRIu32 " rendered, %" PRIu32 " captured, %" PRIu32
+            " evicted, %" PRIu32 " looks in %" PRIu32 " of %" PRIu32 " bytes\n", sprite_stats.hits,
+            sprite_stats.misses + sprite_stats.bypassed, sprite_stats.captures, sprite_stats.evictions,
+            sprite_stats.looks, sprite_stats.bytes, sprite_stats.pool_bytes);
+    fprintf(stderr, "byte order: %" PRIu32 " refreshes rendered natively", lvgl_rgb565_be_get_fallbacks());
+    if (swap_check) {
+        fprintf(stderr, ", %" PRIu32 " frames identical to the native render", checked_frames);
+    }
+    fprintf(stderr, "\n");
+
+    if (trend) {
+        lvgl_trend_show(true);
+        lv_refr_now(display);
+    }
+    if (ppm_path != NULL && !sim_display_dump_ppm(ppm_path)) {
+        return 1;
+    }
+    return 0;
+}
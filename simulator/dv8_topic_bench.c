@@ -0,0 +1,206 @@
+/*
+ * Topic dispatch benchmark: replays the topics of recorded MQTT traffic through dv8_topic_lookup()
+ * in their recorded order and reports the time per message, next to the linear scan over
+ * dv8_topics it replaced.
+ *
+ * The topic mix comes from
+ *   a trace (main/dv8_trace.h), as written by the flash recorder or dv8_replay --record
+ *   a text file with one message per line, topic first, e.g. the output of
+ *     mosquitto_sub -v -t '/robot/#'
+ *   without a file, every dv8_topics entry once plus the off-tree topics a <prefix>/# subscription
+ *   also delivers (the panel's own diagnostics, other robot topics), a stand-in for a recording
+ *
+ * Every lookup is checked against the linear scan, a mismatch exits 1.
+ *
+ * Usage: dv8_topic_bench [--iterations N] [trace.dv8t | topics.txt]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include "dv8_topics.h"
+#include "dv8_trace.h"
+#include "sim_display.h"
+
+#define BENCH_DEFAULT_MESSAGES  2000000     // lookups per decoder, the mix is repeated up to this
+#define BENCH_MAX_TOPIC_LEN     256
+
+typedef struct {
+    const char *topic;
+    size_t topic_len;
+} bench_topic_t;
+
+static const char *const default_off_tree[] = {
+    DV8_TOPIC_PREFIX "/ui/metrics",
+    DV8_TOPIC_PREFIX "/ui/latency",
+    DV8_TOPIC_PREFIX "/state/odometry",
+    DV8_TOPIC_PREFIX "/control/cmd_vel/stamped",
+    DV8_TOPIC_PREFIX "/diagnostics",
+};
+
+static bench_topic_t *topics;
+static size_t topic_count, topic_capacity;
+
+
+static void add_topic(const char *topic, size_t topic_len)
+{
+    if (topic_count == topic_capacity) {
+        topic_capacity = topic_capacity ? topic_capacity * 2 : 256;
+        topics = realloc(topics, topic_capacity * sizeof(*topics));
+        if (topics == NULL) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    topics[topic_count++] = (bench_topic_t) { topic, topic_len };
+}
+
+// The lookup dv8_topic_lookup() replaced: compare against every topic in turn
+static const dv8_topic_t *linear_lookup(const char *topic, size_t topic_len)
+{
+    for (size_t i = 0; i < dv8_topic_count; i++) {
+        if (dv8_topics[i].topic_len == topic_len && memcmp(dv8_topics[i].topic, topic, topic_len) == 0) {
+            return &dv8_topics[i];
+        }
+    }
+    return NULL;
+}
+
+static char *read_file(const char *path, size_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *buf = malloc(size > 0 ? size : 1);
+    if (buf == NULL || fread(buf, 1, size, f) != (size_t)size) {
+        perror(path);
+        fclose(f);
+        free(buf);
+        return NULL;
+    }
+    fclose(f);
+    *len = size;
+    return buf;
+}
+
+// Topics point into `buf`, which stays allocated for the whole run
+static bool load_topics(const char *path)
+{
+    size_t len;
+    char *buf = read_file(path, &len);
+    if (buf == NULL) {
+        return false;
+    }
+
+    dv8_trace_reader_t reader;
+    if (dv8_trace_reader_init(&reader, (const uint8_t *)buf, len)) {
+        dv8_trace_record_t record;
+        while (dv8_trace_next(&reader, &record)) {
+            add_topic(record.topic, record.topic_len);
+        }
+        return true;
+    }
+
+    // Text, the topic is the first word of each line
+    for (char *line = buf; line < buf + len;) {
+        char *end = memchr(line, '\n', buf + len - line);
+        if (end == NULL) {
+            end = buf + len;
+        }
+        size_t topic_len = strcspn(line, " \t\r\n");
+        if (topic_len > (size_t)(end - line)) {
+            topic_len = end - line;
+        }
+        if (topic_len > 0 && line[0] != '#') {
+            add_topic(line, topic_len);
+        }
+        line = end + 1;
+    }
+    return true;
+}
+
+typedef const dv8_topic_t *(*lookup_fn_t)(const char *topic, size_t topic_len);
+
+static double time_lookups(lookup_fn_t lookup, unsigned rounds, size_t *found)
+{
+    size_t hits = 0;
+
+    uint64_t start_us = sim_monotonic_us();
+    for (unsigned round = 0; round < rounds; round++) {
+        for (size_t i = 0; i < topic_count; i++) {
+            hits += lookup(topics[i].topic, topics[i].topic_len) != NULL;
+        }
+    }
+    uint64_t elapsed_us = sim_monotonic_us() - start_us;
+
+    // Also keeps the compiler from dropping the loop
+    *found = hits / rounds;
+    return elapsed_us * 1000.0 / ((double)rounds * topic_count);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long messages = BENCH_DEFAULT_MESSAGES;
+    const char *path = NULL;
+    bool usage = false;
+
+    for (int i = 1; i < argc && !usage; i++) {
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            messages = strtoul(argv[++i], NULL, 10);
+        } else if (path == NULL && argv[i][0] != '-') {
+            path = argv[i];
+        } else {
+            usage = true;
+        }
+    }
+    if (usage || messages == 0) {
+        fprintf(stderr, "usage: %s [--iterations N] [trace.dv8t | topics.txt]\n", argv[0]);
+        return 2;
+    }
+
+    dv8_topics_init();
+    if (path != NULL) {
+        if (!load_topics(path)) {
+            return 1;
+        }
+    } else {
+        for (size_t i = 0; i < dv8_topic_count; i++) {
+            add_topic(dv8_topics[i].topic, dv8_topics[i].topic_len);
+        }
+        for (size_t i = 0; i < sizeof(default_off_tree) / sizeof(default_off_tree[0]); i++) {
+            add_topic(default_off_tree[i], strlen(default_off_tree[i]));
+        }
+    }
+    if (topic_count == 0) {
+        fprintf(stderr, "%s: no messages\n", path);
+        return 1;
+    }
+
+    for (size_t i = 0; i < topic_count; i++) {
+        if (dv8_topic_lookup(topics[i].topic, topics[i].topic_len) != linear_lookup(topics[i].topic, topics[i].topic_len)) {
+            fprintf(stderr, "FAIL: dv8_topic_lookup(\"%.*s\") disagrees with the linear scan\n",
+                    (int)(topics[i].topic_len < BENCH_MAX_TOPIC_LEN ? topics[i].topic_len : BENCH_MAX_TOPIC_LEN),
+                    topics[i].topic);
+            return 1;
+        }
+    }
+
+    unsigned rounds = (messages + topic_count - 1) / topic_count;
+    size_t found, linear_found;
+    double trie_ns = time_lookups(dv8_topic_lookup, rounds, &found);
+    double linear_ns = time_lookups(linear_lookup, rounds, &linear_found);
+
+    printf("mix: %zu messages from %s, %zu to known topics, %zu to others\n", topic_count,
+           path != NULL ? path : "the built-in list", found, topic_count - found);
+    printf("%-20s %10s\n", "lookup", "ns/msg");
+    printf("%-20s %10.1f\n", "dv8_topic_lookup", trie_ns);
+    printf("%-20s %10.1f\n", "linear scan", linear_ns);
+    return linear_found == found ? 0 : 1;
+}
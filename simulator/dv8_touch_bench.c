@@ -0,0 +1,496 @@
+/*
+ * Touch input benchmark on a virtual clock: a mock STMPE610 on a mock SPI bus shared with the
+ * panel, feeding LVGL through
+ *   irq      dv8_touch + lvgl_touch: interrupt, FIFO drain, median/IIR filter, event-mode indev
+ *   polled   what esp_lcd_touch_stmpe610 does when LVGL's read timer polls it every
+ *            LV_DEF_INDEV_READ_PERIOD: FIFO status, every sample, FIFO reset, averaged
+ *
+ * A scripted finger taps the buttons of a grid (noisy samples with the odd spike, like a
+ * resistive panel) and drags now and then, while the panel flushes --stripes stripes of
+ * 20 lines every frame. The bus is modelled the way the ESP-IDF SPI master shares it: the
+ * touch controller's polling transactions wait for the LCD stripe on the wire to finish, and
+ * the LCD's next queued stripe waits for them. dv8_touch acquires the bus for a service burst
+ * instead, and gives it back before a transaction whenever a stripe is waiting, so a stripe
+ * never waits for more than one touch transaction on either path.
+ *
+ * Per mode, to stdout:
+ *   taps, taps that clicked the button aimed at, touch-to-event latency (finger down to
+ *   LV_EVENT_PRESSED, finger up to LV_EVENT_RELEASED) p50/p99/max, touch SPI transactions and
+ *   bus occupancy, and how long LCD stripes were held up by touch transactions
+ *
+ * Exits 1 if dv8_touch held a stripe up longer than the polled path ever did.
+ *
+ * Usage: dv8_touch_bench [--taps N] [--stripes N] [--seed N]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include "lvgl.h"
+#include "dv8_touch.h"
+#include "lvgl_touch.h"
+#include "sim_display.h"
+
+// SPI2 as spi_lcd_main.c sets it up
+#define BENCH_LCD_CLOCK_HZ      (20 * 1000 * 1000)
+#define BENCH_TOUCH_CLOCK_HZ    (1 * 1000 * 1000)
+#define BENCH_TRANS_OVERHEAD_US 15          // CS, driver and ISR per transaction
+#define BENCH_STRIPE_BYTES      (SIM_LCD_H_RES * SIM_LVGL_DRAW_BUF_LINES * 2)
+#define BENCH_STRIPE_US         ((int64_t)BENCH_STRIPE_BYTES * 8 * 1000000 / BENCH_LCD_CLOCK_HZ + BENCH_TRANS_OVERHEAD_US)
+#define BENCH_TOUCH_TRANS_US    (16 * 1000000 / BENCH_TOUCH_CLOCK_HZ + BENCH_TRANS_OVERHEAD_US)
+#define BENCH_FRAME_US          (LV_DEF_REFR_PERIOD * 1000)
+
+// STMPE610 as configured by esp_lcd_touch_stmpe610: 4 sample average, 1 ms delay, 5 ms settle
+#define MOCK_FIRST_SAMPLE_US    6000
+#define MOCK_SAMPLE_US          5000
+#define MOCK_FIFO_DEPTH         128
+#define MOCK_NOISE              12          // raw counts, +-
+#define MOCK_SPIKE_PERCENT      3
+#define MOCK_RAW_MIN            150
+#define MOCK_RAW_MAX            3800
+
+#define BENCH_STEP_US           100
+#define BENCH_GRID_COLS         2
+#define BENCH_GRID_ROWS         3
+#define BENCH_MAX_TAPS          1000
+
+typedef enum { MODE_IRQ, MODE_POLLED } bench_mode_t;
+
+static int64_t now_us;
+
+// Bus: LCD stripes queued at frame start, run back to back
+static unsigned lcd_stripes_per_frame = SIM_LCD_V_RES / SIM_LVGL_DRAW_BUF_LINES;
+static int64_t lcd_next_frame_us;
+static unsigned lcd_pending;
+static int64_t lcd_next_start_us;       // when the next pending stripe can go
+static int64_t lcd_busy_until_us;
+static int64_t lcd_stall_us, lcd_max_stall_us;
+static bool touch_holding;             // between dv8_touch's bus.begin and bus.end
+static uint32_t touch_transactions;
+static int64_t touch_bus_us;
+
+// Mock controller
+typedef struct { uint16_t x, y; } raw_sample_t;
+static bool finger_down;
+static uint16_t finger_x, finger_y;     // pixels
+static int64_t next_sample_us;
+static raw_sample_t fifo[MOCK_FIFO_DEPTH];
+static unsigned fifo_len, fifo_byte;
+static uint8_t int_sta, int_en;
+static bool irq_pending;
+static int64_t irq_us;
+
+// Script and results
+typedef struct {
+    int64_t down_us, up_us;
+    uint16_t x, y, end_x, end_y;        // drags move from x, y to end_x, end_y
+    int target;
+} tap_t;
+static tap_t taps[BENCH_MAX_TAPS];
+static unsigned tap_count, tap_current;
+static lv_obj_t *buttons[BENCH_GRID_COLS * BENCH_GRID_ROWS];
+static int64_t press_latency_us[BENCH_MAX_TAPS], release_latency_us[BENCH_MAX_TAPS];
+static unsigned press_count, release_count, hits;
+
+
+static int64_t bench_clock_us(void)
+{
+    return now_us;
+}
+
+static uint32_t bench_tick_cb(void)
+{
+    return (uint32_t)(now_us / 1000);
+}
+
+static void lcd_run(int64_t until_us)
+{
+    while (lcd_pending > 0 && lcd_next_start_us <= until_us) {
+        lcd_busy_until_us = lcd_next_start_us + BENCH_STRIPE_US;
+        lcd_next_start_us = lcd_busy_until_us;
+        lcd_pending--;
+    }
+}
+
+static void lcd_frame(void)
+{
+    while (now_us >= lcd_next_frame_us) {
+        lcd_run(lcd_next_frame_us);
+        if (lcd_pending == 0) {
+            lcd_next_start_us = lcd_next_frame_us;
+        }
+        lcd_pending += lcd_stripes_per_frame;
+        lcd_next_frame_us += BENCH_FRAME_US;
+    }
+}
+
+// The bus is the touch controller's from now on: wait for the stripe on the wire
+static void bus_take(void)
+{
+    lcd_frame();
+    lcd_run(now_us);
+    now_us = now_us > lcd_busy_until_us ? now_us : lcd_busy_until_us;
+}
+
+// ...and the LCD's next stripe goes no earlier than now
+static void bus_give(void)
+{
+    if (lcd_pending > 0 && lcd_next_start_us < now_us) {
+        int64_t stall_us = now_us - lcd_next_start_us;
+        lcd_stall_us += stall_us;
+        lcd_max_stall_us = stall_us > lcd_max_stall_us ? stall_us : lcd_max_stall_us;
+        lcd_next_start_us = now_us;
+    }
+}
+
+// One touch controller transaction: after the stripe on the wire, ahead of the queued ones
+static void bus_transaction(void)
+{
+    if (!touch_holding) {
+        bus_take();
+    }
+    now_us += BENCH_TOUCH_TRANS_US;
+    touch_transactions++;
+    touch_bus_us += BENCH_TOUCH_TRANS_US;
+    if (!touch_holding) {
+        bus_give();
+    }
+}
+
+static void mock_begin(void *ctx)
+{
+    bus_take();
+    touch_holding = true;
+}
+
+static void mock_end(void *ctx)
+{
+    touch_holding = false;
+    bus_give();
+}
+
+// A stripe is queued and due, it would wait for whoever holds the bus
+static bool mock_contended(void *ctx)
+{
+    lcd_frame();
+    return lcd_pending > 0 && lcd_next_start_us <= now_us;
+}
+
+static uint16_t to_raw(uint16_t px, uint16_t res)
+{
+    int noise = rand() % (2 * MOCK_NOISE + 1) - MOCK_NOISE;
+    if (rand() % 100 < MOCK_SPIKE_PERCENT) {
+        noise = rand() % 2 ? 600 : -600;
+    }
+    int raw = MOCK_RAW_MIN + px * (MOCK_RAW_MAX - MOCK_RAW_MIN) / (res - 1) + noise;
+    return raw < 0 ? 0 : raw > 4095 ? 4095 : raw;
+}
+
+static void mock_raise(uint8_t bits)
+{
+    // Edge triggered: only the first pending status bit pulls the line
+    if (int_sta == 0 && (bits & int_en)) {
+        irq_pending = true;
+        irq_us = now_us;
+    }
+    int_sta |= bits & int_en;
+}
+
+// Finger and sampling up to now
+static void mock_advance(void)
+{
+    const tap_t *tap = tap_current < tap_count ? &taps[tap_current] : NULL;
+
+    if (!finger_down && tap != NULL && now_us >= tap->down_us) {
+        finger_down = true;
+        next_sample_us = tap->down_us + MOCK_FIRST_SAMPLE_US;
+        mock_raise(0x01);
+    }
+    while (finger_down && now_us >= next_sample_us && next_sample_us < tap->up_us) {
+        int64_t t = next_sample_us - tap->down_us, span = tap->up_us - tap->down_us;
+        finger_x = tap->x + (int)(tap->end_x - tap->x) * t / span;
+        finger_y = tap->y + (int)(tap->end_y - tap->y) * t / span;
+        if (fifo_len < MOCK_FIFO_DEPTH) {
+            fifo[fifo_len++] = (raw_sample_t) { to_raw(finger_x, SIM_LCD_H_RES), to_raw(finger_y, SIM_LCD_V_RES) };
+        }
+        mock_raise(0x02);
+        next_sample_us += MOCK_SAMPLE_US;
+    }
+    if (finger_down && now_us >= tap->up_us) {
+        finger_down = false;
+        tap_current++;
+        mock_raise(0x01);
+    }
+}
+
+static int mock_read(void *ctx, uint8_t reg, uint8_t *value)
+{
+    bus_transaction();
+    mock_advance();
+    switch (reg) {
+    case 0x00:
+        *value = 0x08;      // chip ID 0x0811
+        break;
+    case 0x01:
+        *value = 0x11;
+        break;
+    case 0x0B:
+        *value = int_sta;
+        break;
+    case 0x40:
+        *value = finger_down ? 0x81 : 0x01;
+        break;
+    case 0x4B:
+        *value = fifo_len == 0 ? 0x20 : 0x00;
+        break;
+    case 0x4C:
+        *value = fifo_len;
+        break;
+    case 0x57: {
+        // 12-bit x, 12-bit y, 8-bit z, a byte per read
+        raw_sample_t s = fifo_len > 0 ? fifo[0] : (raw_sample_t) { 0, 0 };
+        uint8_t bytes[4] = { s.x >> 4, (uint8_t)(s.x << 4 | s.y >> 8), (uint8_t)s.y, 0x40 };
+        *value = bytes[fifo_byte++];
+        if (fifo_byte == 4) {
+            fifo_byte = 0;
+            if (fifo_len > 0) {
+                memmove(fifo, fifo + 1, --fifo_len * sizeof(fifo[0]));
+            }
+        }
+        break;
+    }
+    default:
+        *value = 0;
+        break;
+    }
+    return 0;
+}
+
+static int mock_write(void *ctx, uint8_t reg, uint8_t value)
+{
+    bus_transaction();
+    mock_advance();
+    if (reg == 0x0B) {
+        int_sta &= ~value;
+    } else if (reg == 0x0A) {
+        int_en = value;
+    } else if (reg == 0x4B && (value & 0x01)) {
+        fifo_len = 0;
+        fifo_byte = 0;
+    }
+    return 0;
+}
+
+// esp_lcd_touch_stmpe610_read_data() + get_xy(), as LVGL's read timer would call them
+static void polled_read_cb(lv_indev_t *indev, lv_indev_data_t *data)
+{
+    static lv_point_t last;
+    uint8_t sta, cnt;
+    mock_read(NULL, 0x4B, &sta);
+    data->point = last;
+    data->state = LV_INDEV_STATE_RELEASED;
+    if ((sta & 0x20) || (mock_read(NULL, 0x4C, &cnt), cnt == 0)) {
+        return;
+    }
+    uint32_t x = 0, y = 0;
+    for (unsigned i = 0; i < cnt; i++) {
+        uint8_t buf[4];
+        for (unsigned b = 0; b < 4; b++) {
+            mock_read(NULL, 0x57, &buf[b]);
+        }
+        x += (uint16_t)(buf[0] << 4 | buf[1] >> 4);
+        y += (uint16_t)((buf[1] & 0x0F) << 8 | buf[2]);
+    }
+    mock_write(NULL, 0x4B, 0x01);
+    mock_write(NULL, 0x4B, 0x00);
+    mock_write(NULL, 0x0B, 0xFF);
+    last.x = (LV_CLAMP(MOCK_RAW_MIN, (int)(x / cnt), MOCK_RAW_MAX) - MOCK_RAW_MIN) * SIM_LCD_H_RES / (MOCK_RAW_MAX - MOCK_RAW_MIN);
+    last.y = (LV_CLAMP(MOCK_RAW_MIN, (int)(y / cnt), MOCK_RAW_MAX) - MOCK_RAW_MIN) * SIM_LCD_V_RES / (MOCK_RAW_MAX - MOCK_RAW_MIN);
+    data->point = last;
+    data->state = LV_INDEV_STATE_PRESSED;
+}
+
+static void button_event_cb(lv_event_t *e)
+{
+    int index = (int)(intptr_t)lv_event_get_user_data(e);
+    // The tap being scored, also right after its finger went up
+    unsigned t = finger_down ? tap_current : tap_current - 1;
+    if (t >= tap_count) {
+        return;
+    }
+    switch (lv_event_get_code(e)) {
+    case LV_EVENT_PRESSED:
+        press_latency_us[press_count++] = now_us - taps[t].down_us;
+        break;
+    case LV_EVENT_RELEASED:
+        release_latency_us[release_count++] = now_us - taps[t].up_us;
+        break;
+    case LV_EVENT_CLICKED:
+        hits += index == taps[t].target;
+        break;
+    default:
+        break;
+    }
+}
+
+static void make_script(unsigned count)
+{
+    uint16_t w = SIM_LCD_H_RES / BENCH_GRID_COLS, h = SIM_LCD_V_RES / BENCH_GRID_ROWS;
+    int64_t t = 200000;
+    tap_count = count;
+    for (unsigned i = 0; i < count; i++) {
+        tap_t *tap = &taps[i];
+        tap->target = rand() % (BENCH_GRID_COLS * BENCH_GRID_ROWS);
+        // Well inside the button, a drag every 5th time stays inside it too
+        tap->x = (tap->target % BENCH_GRID_COLS) * w + w / 4 + rand() % (w / 2);
+        tap->y = (tap->target / BENCH_GRID_COLS) * h + h / 4 + rand() % (h / 2);
+        tap->end_x = tap->x;
+        tap->end_y = tap->y;
+        if (i % 5 == 4) {
+            tap->end_x = (tap->target % BENCH_GRID_COLS) * w + w / 4 + rand() % (w / 2);
+        }
+        tap->down_us = t;
+        tap->up_us = t + 60000 + rand() % 120000;
+        t = tap->up_us + 150000 + rand() % 250000;
+    }
+}
+
+static int cmp_us(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void print_latency(const char *what, int64_t *values, unsigned count)
+{
+    if (count == 0) {
+        printf("  %-8s none\n", what);
+        return;
+    }
+    qsort(values, count, sizeof(values[0]), cmp_us);
+    printf("  %-8s p50 %6.1f ms  p99 %6.1f ms  max %6.1f ms  (%u)\n", what, values[count / 2] / 1000.0,
+           values[(count * 99) / 100] / 1000.0, values[count - 1] / 1000.0, count);
+}
+
+// Returns the longest an LCD stripe waited for the touch controller
+static int64_t run(bench_mode_t mode, unsigned count, unsigned seed)
+{
+    srand(seed);
+    make_script(count);
+    now_us = 0;
+    lcd_next_frame_us = 0;
+    lcd_pending = 0;
+    lcd_busy_until_us = lcd_next_start_us = 0;
+    lcd_stall_us = lcd_max_stall_us = 0;
+    touch_transactions = 0;
+    touch_bus_us = 0;
+    finger_down = false;
+    fifo_len = fifo_byte = 0;
+    int_sta = 0;
+    int_en = 0x01;      // as esp_lcd_touch_stmpe610 leaves it
+    irq_pending = false;
+    tap_current = 0;
+    press_count = release_count = hits = 0;
+
+    lv_indev_t *indev;
+    if (mode == MODE_IRQ) {
+        dv8_touch_init(&(dv8_touch_bus_t) { mock_read, mock_write, mock_begin, mock_end, mock_contended, NULL },
+                       SIM_LCD_H_RES, SIM_LCD_V_RES, bench_clock_us);
+        if (!dv8_touch_configure()) {
+            fprintf(stderr, "dv8_touch_configure failed\n");
+            exit(1);
+        }
+        indev = lvgl_touch_create(lv_display_get_default());
+    } else {
+        indev = lv_indev_create();
+        lv_indev_set_type(indev, LV_INDEV_TYPE_POINTER);
+        lv_indev_set_read_cb(indev, polled_read_cb);
+    }
+    uint32_t start_transactions = touch_transactions;
+
+    int64_t end_us = taps[count - 1].up_us + 500000;
+    int64_t next_lvgl_us = 0;
+    while (now_us < end_us) {
+        lcd_frame();
+        mock_advance();
+        if (irq_pending && mode == MODE_IRQ) {
+            // Touch task, then the LVGL task it posts LVGL_CMD_TOUCH to
+            irq_pending = false;
+            if (dv8_touch_service(irq_us)) {
+                lvgl_touch_read();
+            }
+        }
+        if (now_us >= next_lvgl_us) {
+            lv_timer_handler();
+            next_lvgl_us = now_us + 1000;
+        }
+        now_us += BENCH_STEP_US;
+    }
+    lv_indev_delete(indev);
+
+    int64_t lcd_bus_us = (int64_t)(end_us / BENCH_FRAME_US) * lcd_stripes_per_frame * BENCH_STRIPE_US;
+    printf("%s: %u taps, %u clicked the button aimed at\n", mode == MODE_IRQ ? "irq" : "polled", count, hits);
+    print_latency("press", press_latency_us, press_count);
+    print_latency("release", release_latency_us, release_count);
+    printf("  touch SPI %" PRIu32 " transactions, %.1f ms on the bus (%.2f%%, LCD %.1f%%)\n",
+           touch_transactions - start_transactions, touch_bus_us / 1000.0, touch_bus_us * 100.0 / end_us,
+           lcd_bus_us * 100.0 / end_us);
+    printf("  LCD stripes held up %.1f ms in total, %" PRId64 " us at most\n", lcd_stall_us / 1000.0, lcd_max_stall_us);
+    if (mode == MODE_IRQ) {
+        dv8_touch_stats_t s;
+        dv8_touch_get_stats(&s);
+        printf("  dv8_touch: %" PRIu32 " interrupts, %" PRIu32 " samples, %" PRIu32 " reset unread, %" PRIu32
+               " events, %" PRIu32 " overflows, %" PRIu32 " yields\n", s.irqs, s.samples, s.discarded, s.events,
+               s.overflows, s.yields);
+    }
+    return lcd_max_stall_us;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned count = 100, seed = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--taps") == 0 && i + 1 < argc) {
+            count = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--stripes") == 0 && i + 1 < argc) {
+            lcd_stripes_per_frame = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoul(argv[++i], NULL, 10);
+        } else {
+            count = 0;
+            break;
+        }
+    }
+    if (count == 0 || count > BENCH_MAX_TAPS) {
+        fprintf(stderr, "usage: %s [--taps 1..%u] [--stripes N] [--seed N]\n", argv[0], BENCH_MAX_TAPS);
+        return 2;
+    }
+
+    lv_init();
+    lv_tick_set_cb(bench_tick_cb);
+    sim_display_create();
+
+    lv_obj_t *scr = lv_screen_active();
+    lv_obj_set_style_pad_all(scr, 0, 0);
+    for (int i = 0; i < BENCH_GRID_COLS * BENCH_GRID_ROWS; i++) {
+        lv_obj_t *btn = lv_button_create(scr);
+        lv_obj_set_size(btn, SIM_LCD_H_RES / BENCH_GRID_COLS, SIM_LCD_V_RES / BENCH_GRID_ROWS);
+        lv_obj_set_pos(btn, (i % BENCH_GRID_COLS) * SIM_LCD_H_RES / BENCH_GRID_COLS,
+                       (i / BENCH_GRID_COLS) * SIM_LCD_V_RES / BENCH_GRID_ROWS);
+        lv_obj_set_style_radius(btn, 0, 0);
+        lv_obj_remove_flag(btn, LV_OBJ_FLAG_SCROLL_ON_FOCUS);
+        lv_obj_add_event_cb(btn, button_event_cb, LV_EVENT_ALL, (void *)(intptr_t)i);
+        buttons[i] = btn;
+    }
+
+    printf("panel: %u stripes of %u us per %d ms frame\n", lcd_stripes_per_frame, (unsigned)BENCH_STRIPE_US, LV_DEF_REFR_PERIOD);
+    int64_t irq_stall_us = run(MODE_IRQ, count, seed);
+    int64_t polled_stall_us = run(MODE_POLLED, count, seed);
+    if (irq_stall_us > polled_stall_us) {
+        printf("FAIL: irq held an LCD stripe up %" PRId64 " us, polled %" PRId64 " us\n", irq_stall_us, polled_stall_us);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,69 @@
+/**
+ * @file lv_conf.h
+ * LVGL configuration for the host simulator.
+ *
+ * Mirrors the CONFIG_LV_* values in ../sdkconfig so the panel renders the same
+ * way it does on the ESP32. Anything not set here takes the LVGL default.
+ */
+
+#ifndef LV_CONF_H
+#define LV_CONF_H
+
+/*Color settings*/
+#define LV_COLOR_DEPTH 16
+
+/*Memory settings*/
+#define LV_USE_STDLIB_MALLOC    LV_STDLIB_BUILTIN
+#define LV_USE_STDLIB_STRING    LV_STDLIB_BUILTIN
+#define LV_USE_STDLIB_SPRINTF   LV_STDLIB_BUILTIN
+#define LV_MEM_SIZE (64 * 1024U)
+
+/*HAL settings*/
+#define LV_DEF_REFR_PERIOD  33
+#define LV_DPI_DEF 130
+
+/*Operating system*/
+#define LV_USE_OS   LV_OS_NONE
+
+/*Rendering*/
+#define LV_DRAW_BUF_STRIDE_ALIGN 1
+#define LV_DRAW_BUF_ALIGN 4
+#define LV_DRAW_LAYER_SIMPLE_BUF_SIZE (24 * 1024)
+#define LV_USE_DRAW_SW 1
+#define LV_DRAW_SW_DRAW_UNIT_CNT 1
+#define LV_DRAW_SW_COMPLEX 1
+#define LV_DRAW_SW_SHADOW_CACHE_SIZE 0
+#define LV_DRAW_SW_CIRCLE_CACHE_SIZE 4
+/*Big-endian RGB565 like the panel build. Resolved against this directory*/
+#define LV_USE_DRAW_SW_ASM LV_DRAW_SW_ASM_CUSTOM
+#define LV_DRAW_SW_ASM_CUSTOM_INCLUDE "../main/lvgl_rgb565_be.h"
+
+/*Logging and asserts*/
+#define LV_USE_LOG 0
+#define LV_USE_ASSERT_NULL 1
+#define LV_USE_ASSERT_MALLOC 1
+
+/*Caches*/
+#define LV_CACHE_DEF_SIZE 0
+#define LV_IMAGE_HEADER_CACHE_DEF_CNT 0
+#define LV_GRADIENT_MAX_STOPS 2
+
+/*Fonts*/
+#define LV_FONT_MONTSERRAT_8 1
+#define LV_FONT_MONTSERRAT_10 1
+#define LV_FONT_MONTSERRAT_12 1
+#define LV_FONT_MONTSERRAT_14 1
+#define LV_FONT_DEFAULT &lv_font_montserrat_14
+
+/*Widgets and extras*/
+#define LV_LABEL_TEXT_SELECTION 1
+#define LV_LABEL_LONG_TXT_HINT 1
+#define LV_USE_THEME_DEFAULT 1
+#define LV_THEME_DEFAULT_GROW 1
+#define LV_THEME_DEFAULT_TRANSITION_TIME 80
+#define LV_USE_FLEX 1
+#define LV_USE_GRID 1
+#define LV_USE_SYSMON 1
+#define LV_USE_OBSERVER 1
+
+#endif /*LV_CONF_H*/
@@ -0,0 +1,21 @@
+/*
+ * The CONFIG_DV8_* values the platform independent part of main/ reads, for the host build.
+ * Mirrors the defaults in main/Kconfig.projbuild; the ESP-IDF build generates the real one.
+ */
+
+#ifndef SDKCONFIG_H
+#define SDKCONFIG_H
+
+#define CONFIG_DV8_TOPIC_PREFIX "/robot"
+#define CONFIG_DV8_HISTORY_COLUMN_MS 1000
+#define CONFIG_DV8_STATUS_PAGE_MS 15000
+#define CONFIG_DV8_TREND_PAGE_MS 5000
+#define CONFIG_DV8_FLEET_MODE 1      // only adds the fleet modules, the tools pick their UI
+#define CONFIG_DV8_FLEET_CAPACITY 256
+#define CONFIG_DV8_FLEET_PAGE_MS 4000
+#define CONFIG_DV8_STALE_STATE_TIMEOUT_MS 5000
+#define CONFIG_DV8_STALE_BATTERY_TIMEOUT_MS 30000
+#define CONFIG_DV8_REFR_MAX_PERIOD_MS 100
+#define CONFIG_DV8_SPRITE_CACHE_KB 32
+
+#endif
@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "sim_display.h"
+#include "lvgl_rgb565_be.h"
+
+static uint16_t framebuffer[SIM_LCD_H_RES * SIM_LCD_V_RES];
+static sim_frame_stats_t frame_stats;
+static sim_frame_done_cb_t frame_done_cb;
+
+
+uint64_t sim_monotonic_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void sim_flush_cb(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map)
+{
+    const uint16_t *src = (const uint16_t *)px_map;
+    int32_t w = lv_area_get_width(area);
+
+    // Like flush_cb, the framebuffer gets the panel's byte order either way
+    if (!lvgl_rgb565_be_active) {
+        lv_draw_sw_rgb565_swap(px_map, lv_area_get_size(area));
+    }
+
+    for (int32_t y = area->y1; y <= area->y2; y++) {
+        memcpy(&framebuffer[y * SIM_LCD_H_RES + area->x1], src, w * sizeof(uint16_t));
+        src += w;
+    }
+
+    frame_stats.flushes++;
+    frame_stats.pixels += lv_area_get_size(area);
+    bool last = lv_display_flush_is_last(disp);
+    lv_display_flush_ready(disp);
+    if (last && frame_done_cb != NULL) {
+        frame_done_cb();
+    }
+}
+
+lv_display_t *sim_display_create(void)
+{
+    // Same theme as app_main
+    lv_color_t primary = lv_color_make(100, 180, 30);
+    lv_color_t secondary = lv_color_make(75, 108, 116);
+    lv_theme_t *theme = lv_theme_default_init(NULL, primary, secondary, true, &lv_font_montserrat_10);
+    lv_disp_set_theme(NULL, theme);
+
+    lv_display_t *display = lv_display_create(SIM_LCD_H_RES, SIM_LCD_V_RES);
+
+    static uint16_t buf1[SIM_LCD_H_RES * SIM_LVGL_DRAW_BUF_LINES];
+    static uint16_t buf2[SIM_LCD_H_RES * SIM_LVGL_DRAW_BUF_LINES];
+    lv_display_set_buffers(display, buf1, buf2, sizeof(buf1), LV_DISPLAY_RENDER_MODE_PARTIAL);
+    lv_display_set_color_format(display, LV_COLOR_FORMAT_RGB565);
+    lv_display_set_flush_cb(display, sim_flush_cb);
+    lvgl_rgb565_be_attach(display);
+    return display;
+}
+
+void sim_display_set_frame_done_cb(sim_frame_done_cb_t cb)
+{
+    frame_done_cb = cb;
+}
+
+sim_frame_stats_t sim_display_take_stats(void)
+{
+    sim_frame_stats_t stats = frame_stats;
+    memset(&frame_stats, 0, sizeof(frame_stats));
+    return stats;
+}
+
+const uint16_t *sim_display_framebuffer(void)
+{
+    return framebuffer;
+}
+
+// The panel is wired BGR, so swap R and B back to get what the glass shows. The framebuffer
+// holds what went over SPI, i.e. big-endian pixels.
+bool sim_display_dump_ppm(const char *path)
+{
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        perror(path);
+        return false;
+    }
+
+    fprintf(f, "P6\n%d %d\n255\n", SIM_LCD_H_RES, SIM_LCD_V_RES);
+    for (int i = 0; i < SIM_LCD_H_RES * SIM_LCD_V_RES; i++) {
+        uint16_t px = (uint16_t)((framebuffer[i] >> 8) | (framebuffer[i] << 8));
+        uint8_t rgb[3] = {
+            (px & 0x1F) << 3,
+            ((px >> 5) & 0x3F) << 2,
+            (px >> 11) << 3,
+        };
+        fwrite(rgb, 1, sizeof(rgb), f);
+    }
+
+    fclose(f);
+    return true;
+}
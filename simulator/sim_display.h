@@ -0,0 +1,32 @@
+#ifndef SIM_DISPLAY_H
+#define SIM_DISPLAY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "lvgl.h"
+
+// Same panel geometry and draw buffers as spi_lcd_main.c with the ILI9341
+#define SIM_LCD_H_RES           128
+#define SIM_LCD_V_RES           160
+#define SIM_LVGL_DRAW_BUF_LINES 20
+
+typedef struct {
+    uint32_t flushes;
+    uint32_t pixels;
+} sim_frame_stats_t;
+
+// Called after the last flush of a refresh, i.e. when the whole frame reached the "glass"
+typedef void (*sim_frame_done_cb_t)(void);
+
+// Memory framebuffer display with the app_main theme, lv_init() must have been called
+extern lv_display_t *sim_display_create(void);
+extern void sim_display_set_frame_done_cb(sim_frame_done_cb_t cb);
+// Flushes since the last call, then starts counting again
+extern sim_frame_stats_t sim_display_take_stats(void);
+// What went to the panel so far, SIM_LCD_H_RES * SIM_LCD_V_RES big-endian pixels
+extern const uint16_t *sim_display_framebuffer(void);
+extern bool sim_display_dump_ppm(const char *path);
+
+extern uint64_t sim_monotonic_us(void);
+
+#endif